@@ -131,6 +131,15 @@ ifndef CUSTOM_MATRIX
 	SRC += $(QUANTUM_DIR)/matrix.c
 endif
 
+DEBOUNCE_TYPE ?= sym_g
+VALID_DEBOUNCE_TYPES := sym_g asym_eager_defer_pk eager_pr custom
+ifeq ($(filter $(strip $(DEBOUNCE_TYPE)),$(VALID_DEBOUNCE_TYPES)),)
+    $(error DEBOUNCE_TYPE="$(DEBOUNCE_TYPE)" is not a valid debounce algorithm)
+endif
+ifneq ($(strip $(DEBOUNCE_TYPE)), custom)
+	SRC += $(QUANTUM_DIR)/debounce/$(strip $(DEBOUNCE_TYPE)).c
+endif
+
 ifeq ($(strip $(API_SYSEX_ENABLE)), yes)
 	OPT_DEFS += -DAPI_SYSEX_ENABLE
 	SRC += $(QUANTUM_DIR)/api/api_sysex.c
@@ -173,7 +182,11 @@ endif
 
 ifeq ($(strip $(RGBLIGHT_ENABLE)), yes)
 	OPT_DEFS += -DRGBLIGHT_ENABLE
+ifeq ($(PLATFORM),CHIBIOS)
+	SRC += $(QUANTUM_DIR)/ws2812_chibios.c
+else
 	SRC += $(QUANTUM_DIR)/light_ws2812.c
+endif
 	SRC += $(QUANTUM_DIR)/rgblight.c
 endif
 
@@ -194,6 +207,18 @@ ifeq ($(strip $(SERIAL_LINK_ENABLE)), yes)
 	VAPTH += $(SERIAL_PATH)
 endif
 
+ifeq ($(strip $(SPLIT_KEYBOARD)), yes)
+	OPT_DEFS += -DSPLIT_KEYBOARD
+	SRC += $(SPLIT_DIR)/split_util.c
+	SRC += $(SPLIT_DIR)/split_protocol.c
+	SRC += $(SPLIT_DIR)/transport.c
+	SRC += $(SPLIT_DIR)/i2c.c
+	SRC += $(SPLIT_DIR)/serial.c
+	SRC += $(SPLIT_DIR)/serial_usart.c
+	SRC += $(SPLIT_DIR)/serial_icp.c
+	SRC += $(SPLIT_DIR)/serial_frame.c
+endif
+
 ifneq ($(strip $(VARIABLE_TRACE)),)
 	SRC += $(QUANTUM_DIR)/variable_trace.c
 	OPT_DEFS += -DNUM_TRACED_VARIABLES=$(strip $(VARIABLE_TRACE))
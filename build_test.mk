@@ -42,11 +42,17 @@ all: elf
 VPATH += $(COMMON_VPATH)
 
 include $(TMK_PATH)/common.mk
+include $(QUANTUM_PATH)/debounce/tests/rules.mk
 include $(QUANTUM_PATH)/serial_link/tests/rules.mk
+include $(QUANTUM_PATH)/split/tests/rules.mk
+include $(QUANTUM_PATH)/visualizer/tests/rules.mk
+include $(QUANTUM_PATH)/tests/rules.mk
+include $(TMK_PATH)/common/tests/rules.mk
 
 $(TEST_OBJ)/$(TEST)_SRC := $($(TEST)_SRC)
 $(TEST_OBJ)/$(TEST)_INC := $($(TEST)_INC) $(VPATH) $(GTEST_INC)
 $(TEST_OBJ)/$(TEST)_DEFS := $($(TEST)_DEFS)
+$(TEST_OBJ)/$(TEST)_CONFIG := $($(TEST)_CONFIG)
 
 include $(TMK_PATH)/native.mk
 include $(TMK_PATH)/rules.mk
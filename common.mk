@@ -17,6 +17,9 @@ SERIAL_SRC := $(wildcard $(SERIAL_PATH)/protocol/*.c)
 SERIAL_SRC += $(wildcard $(SERIAL_PATH)/system/*.c)
 SERIAL_DEFS += -DSERIAL_LINK_ENABLE
 
+SPLIT_DIR := $(QUANTUM_DIR)/split
+SPLIT_PATH := $(QUANTUM_PATH)/split
+
 COMMON_VPATH := $(TOP_DIR)
 COMMON_VPATH += $(TMK_PATH)
 COMMON_VPATH += $(QUANTUM_PATH)
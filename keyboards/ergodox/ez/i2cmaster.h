@@ -174,5 +174,50 @@ extern unsigned char i2c_read(unsigned char ack);
 #define i2c_read(ack)  (ack) ? i2c_readAck() : i2c_readNak(); 
 
 
+/**
+ @brief    interrupt driven transaction
+
+ Writes tx_len bytes from tx, then, after a repeated start, reads rx_len
+ bytes into rx. Either part may be empty. The transaction and its buffers
+ must stay valid until i2c_wait() returns for it.
+ */
+typedef struct {
+    unsigned char address;      /**< device address with I2C_WRITE */
+    const unsigned char *tx;
+    unsigned char tx_len;
+    unsigned char *rx;
+    unsigned char rx_len;
+    volatile unsigned char status;
+} i2c_transaction_t;
+
+#define I2C_DONE    0
+#define I2C_PENDING 1
+#define I2C_FAILED  2
+
+/** transactions that can be queued at once, must be a power of two */
+#ifndef I2C_QUEUE_SIZE
+#define I2C_QUEUE_SIZE 4
+#endif
+
+/**
+ @brief    queue a transaction, it starts as soon as the bus is free
+ @return   0 queued<br>
+           1 queue full
+ */
+extern unsigned char i2c_queue(i2c_transaction_t *transaction);
+
+/**
+ @brief    wait until a queued transaction is finished
+ @return   0 transaction done<br>
+           1 transaction failed
+ */
+extern unsigned char i2c_wait(i2c_transaction_t *transaction);
+
+/**
+ @brief    the blocking functions above may only be used while this is 0
+ */
+extern unsigned char i2c_busy(void);
+
+
 /**@}*/
 #endif
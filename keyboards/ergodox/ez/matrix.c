@@ -59,16 +59,42 @@ static uint8_t debouncing = DEBOUNCE;
 static matrix_row_t matrix[MATRIX_ROWS];
 static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
-static matrix_row_t read_cols(uint8_t row);
+static matrix_row_t read_cols(void);
 static void init_cols(void);
 static void unselect_rows(void);
 static void select_row(uint8_t row);
 
 static uint8_t mcp23018_reset_loop;
 
+/* MCP23018 rows are scanned with queued TWI transactions while the teensy
+ * rows are read. Selecting a row leaves the expander's address pointer on
+ * GPIOB (sequential mode), so the column read is a bare read.
+ *
+ * Between scans all MCP23018 rows are driven low. While no key on that
+ * half is down, a single GPIOB read per scan shows that nothing changed
+ * and the row by row scan is skipped.
+ */
+#define MCP23018_ROWS 7
+#define MCP23018_ALL_ROWS (0xFF & ~((1<<MCP23018_ROWS) - 1))
+#define MCP23018_COLS_MASK 0b00111111
+
+static uint8_t mcp23018_select_data[MCP23018_ROWS + 1][2];
+static uint8_t mcp23018_cols[MCP23018_ROWS];
+static const uint8_t mcp23018_gpiob = GPIOB;
+static uint8_t mcp23018_idle_cols;
+static i2c_transaction_t mcp23018_select[2];
+static i2c_transaction_t mcp23018_read[MCP23018_ROWS];
+static i2c_transaction_t mcp23018_idle_read = {
+    .address = I2C_ADDR_WRITE,
+    .tx = &mcp23018_gpiob, .tx_len = 1,
+    .rx = &mcp23018_idle_cols, .rx_len = 1,
+};
+static bool mcp23018_idle;
+
 #ifdef DEBUG_MATRIX_SCAN_RATE
 uint32_t matrix_timer;
 uint32_t matrix_scan_count;
+uint32_t matrix_idle_scan_count;
 #endif
 
 
@@ -119,6 +145,7 @@ void matrix_init(void)
 #ifdef DEBUG_MATRIX_SCAN_RATE
     matrix_timer = timer_read32();
     matrix_scan_count = 0;
+    matrix_idle_scan_count = 0;
 #endif
 
     matrix_init_quantum();
@@ -140,10 +167,85 @@ void matrix_power_up(void) {
 #ifdef DEBUG_MATRIX_SCAN_RATE
     matrix_timer = timer_read32();
     matrix_scan_count = 0;
+    matrix_idle_scan_count = 0;
 #endif
 
 }
 
+static void store_row(uint8_t row, matrix_row_t cols)
+{
+    if (matrix_debouncing[row] != cols) {
+        matrix_debouncing[row] = cols;
+        if (debouncing) {
+            debug("bounce!: "); debug_hex(debouncing); debug("\n");
+        }
+        debouncing = DEBOUNCE;
+    }
+}
+
+static bool queue_mcp23018_select(uint8_t row)
+{
+    i2c_transaction_t *select = &mcp23018_select[row & 1];
+    select->tx = mcp23018_select_data[row];
+    return !i2c_queue(select);
+}
+
+/* Scan the MCP23018 rows, the teensy rows or both. Row i of the left half
+ * is read while row i + 7 is scanned on the teensy, which also gives the
+ * expander's outputs the time they need to settle.
+ */
+static void scan_rows(bool left, bool right)
+{
+    if (left && !queue_mcp23018_select(0)) {
+        mcp23018_status = 1;
+        left = false;
+    }
+
+    for (uint8_t i = 0; i < MCP23018_ROWS; i++) {
+        if (left && i2c_wait(&mcp23018_select[i & 1])) {
+            mcp23018_status = 1;
+            left = false;
+        }
+        if (right) {
+            select_row(i + MCP23018_ROWS);
+            wait_us(30);  // without this wait read unstable value.
+            store_row(i + MCP23018_ROWS, read_cols());
+            unselect_rows();
+        } else if (left) {
+            wait_us(30);
+        }
+        if (left) {
+            // the last select drives all rows again for the idle check
+            if (i2c_queue(&mcp23018_read[i]) || !queue_mcp23018_select(i + 1)) {
+                mcp23018_status = 1;
+                left = false;
+            }
+        }
+    }
+
+    // let queued transactions finish even after a failure, they use our buffers
+    for (uint8_t i = 0; i < MCP23018_ROWS; i++) {
+        if (mcp23018_read[i].status == I2C_PENDING) {
+            mcp23018_status |= i2c_wait(&mcp23018_read[i]);
+        }
+    }
+    while (i2c_busy());
+    if (!left || mcp23018_status) {
+        return;
+    }
+    if (i2c_wait(&mcp23018_select[MCP23018_ROWS & 1])) {
+        mcp23018_status = 1;
+        return;
+    }
+    bool idle = true;
+    for (uint8_t i = 0; i < MCP23018_ROWS; i++) {
+        matrix_row_t cols = ~mcp23018_cols[i] & MCP23018_COLS_MASK;
+        store_row(i, cols);
+        idle &= !cols;
+    }
+    mcp23018_idle = idle;
+}
+
 uint8_t matrix_scan(void)
 {
     if (mcp23018_status) { // if there was an error
@@ -168,25 +270,36 @@ uint8_t matrix_scan(void)
     if (TIMER_DIFF_32(timer_now, matrix_timer)>1000) {
         print("matrix scan frequency: ");
         pdec(matrix_scan_count);
-        print("\n");
+        print(" (left idle: ");
+        pdec(matrix_idle_scan_count);
+        print(")\n");
 
         matrix_timer = timer_now;
         matrix_scan_count = 0;
+        matrix_idle_scan_count = 0;
     }
 #endif
 
-    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        select_row(i);
-        wait_us(30);  // without this wait read unstable value.
-        matrix_row_t cols = read_cols(i);
-        if (matrix_debouncing[i] != cols) {
-            matrix_debouncing[i] = cols;
-            if (debouncing) {
-                debug("bounce!: "); debug_hex(debouncing); debug("\n");
-            }
-            debouncing = DEBOUNCE;
+    if (!mcp23018_status && mcp23018_idle) {
+        mcp23018_status = i2c_queue(&mcp23018_idle_read);
+        scan_rows(false, true);
+        mcp23018_status |= i2c_wait(&mcp23018_idle_read);
+        if (!mcp23018_status && !(~mcp23018_idle_cols & MCP23018_COLS_MASK)) {
+#ifdef DEBUG_MATRIX_SCAN_RATE
+            matrix_idle_scan_count++;
+#endif
+        } else {
+            mcp23018_idle = false;
+            scan_rows(!mcp23018_status, false);
+        }
+    } else {
+        scan_rows(!mcp23018_status, true);
+    }
+    if (mcp23018_status) {
+        mcp23018_idle = false;
+        for (uint8_t i = 0; i < MCP23018_ROWS; i++) {
+            store_row(i, 0);
         }
-        unselect_rows();
     }
 
     if (debouncing) {
@@ -255,7 +368,21 @@ uint8_t matrix_key_count(void)
 static void  init_cols(void)
 {
     // init on mcp23018
-    // not needed, already done as part of init_mcp23018()
+    // pins are already set up as part of init_mcp23018()
+    for (uint8_t row = 0; row <= MCP23018_ROWS; row++) {
+        mcp23018_select_data[row][0] = GPIOA;
+        mcp23018_select_data[row][1] = (row < MCP23018_ROWS) ? 0xFF & ~(1<<row) : MCP23018_ALL_ROWS;
+    }
+    for (uint8_t row = 0; row < MCP23018_ROWS; row++) {
+        mcp23018_read[row].address = I2C_ADDR_WRITE;
+        mcp23018_read[row].rx = &mcp23018_cols[row];
+        mcp23018_read[row].rx_len = 1;
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        mcp23018_select[i].address = I2C_ADDR_WRITE;
+        mcp23018_select[i].tx_len = 2;
+    }
+    mcp23018_idle = false;
 
     // init on teensy
     // Input with pull-up(DDR:0, PORT:1)
@@ -263,32 +390,16 @@ static void  init_cols(void)
     PORTF |=  (1<<7 | 1<<6 | 1<<5 | 1<<4 | 1<<1 | 1<<0);
 }
 
-static matrix_row_t read_cols(uint8_t row)
+static matrix_row_t read_cols(void)
 {
-    if (row < 7) {
-        if (mcp23018_status) { // if there was an error
-            return 0;
-        } else {
-            uint8_t data = 0;
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOB);             if (mcp23018_status) goto out;
-            mcp23018_status = i2c_start(I2C_ADDR_READ);     if (mcp23018_status) goto out;
-            data = i2c_readNak();
-            data = ~data;
-        out:
-            i2c_stop();
-            return data;
-        }
-    } else {
-        // read from teensy
-        return
-            (PINF&(1<<0) ? 0 : (1<<0)) |
-            (PINF&(1<<1) ? 0 : (1<<1)) |
-            (PINF&(1<<4) ? 0 : (1<<2)) |
-            (PINF&(1<<5) ? 0 : (1<<3)) |
-            (PINF&(1<<6) ? 0 : (1<<4)) |
-            (PINF&(1<<7) ? 0 : (1<<5)) ;
-    }
+    // read from teensy, the MCP23018 columns are read in scan_rows()
+    return
+        (PINF&(1<<0) ? 0 : (1<<0)) |
+        (PINF&(1<<1) ? 0 : (1<<1)) |
+        (PINF&(1<<4) ? 0 : (1<<2)) |
+        (PINF&(1<<5) ? 0 : (1<<3)) |
+        (PINF&(1<<6) ? 0 : (1<<4)) |
+        (PINF&(1<<7) ? 0 : (1<<5)) ;
 }
 
 /* Row pin configuration
@@ -303,19 +414,8 @@ static matrix_row_t read_cols(uint8_t row)
  */
 static void unselect_rows(void)
 {
-    // unselect on mcp23018
-    if (mcp23018_status) { // if there was an error
-        // do nothing
-    } else {
-        // set all rows hi-Z : 1
-        mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-        mcp23018_status = i2c_write(GPIOA);             if (mcp23018_status) goto out;
-        mcp23018_status = i2c_write( 0xFF
-                              & ~(0<<7)
-                          );                            if (mcp23018_status) goto out;
-    out:
-        i2c_stop();
-    }
+    // MCP23018 rows are selected by scan_rows(), which leaves all of them
+    // driven low for the idle check
 
     // unselect on teensy
     // Hi-Z(DDR:0, PORT:0) to unselect
@@ -329,54 +429,37 @@ static void unselect_rows(void)
 
 static void select_row(uint8_t row)
 {
-    if (row < 7) {
-        // select on mcp23018
-        if (mcp23018_status) { // if there was an error
-            // do nothing
-        } else {
-            // set active row low  : 0
-            // set other rows hi-Z : 1
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);        if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOA);                 if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write( 0xFF & ~(1<<row)
-                                  & ~(0<<7)
-                              );                                if (mcp23018_status) goto out;
-        out:
-            i2c_stop();
-        }
-    } else {
-        // select on teensy
-        // Output low(DDR:1, PORT:0) to select
-        switch (row) {
-            case 7:
-                DDRB  |= (1<<0);
-                PORTB &= ~(1<<0);
-                break;
-            case 8:
-                DDRB  |= (1<<1);
-                PORTB &= ~(1<<1);
-                break;
-            case 9:
-                DDRB  |= (1<<2);
-                PORTB &= ~(1<<2);
-                break;
-            case 10:
-                DDRB  |= (1<<3);
-                PORTB &= ~(1<<3);
-                break;
-            case 11:
-                DDRD  |= (1<<2);
-                PORTD &= ~(1<<3);
-                break;
-            case 12:
-                DDRD  |= (1<<3);
-                PORTD &= ~(1<<3);
-                break;
-            case 13:
-                DDRC  |= (1<<6);
-                PORTC &= ~(1<<6);
-                break;
-        }
+    // select on teensy
+    // Output low(DDR:1, PORT:0) to select
+    switch (row) {
+        case 7:
+            DDRB  |= (1<<0);
+            PORTB &= ~(1<<0);
+            break;
+        case 8:
+            DDRB  |= (1<<1);
+            PORTB &= ~(1<<1);
+            break;
+        case 9:
+            DDRB  |= (1<<2);
+            PORTB &= ~(1<<2);
+            break;
+        case 10:
+            DDRB  |= (1<<3);
+            PORTB &= ~(1<<3);
+            break;
+        case 11:
+            DDRD  |= (1<<2);
+            PORTD &= ~(1<<3);
+            break;
+        case 12:
+            DDRD  |= (1<<3);
+            PORTD &= ~(1<<3);
+            break;
+        case 13:
+            DDRC  |= (1<<6);
+            PORTC &= ~(1<<6);
+            break;
     }
 }
 
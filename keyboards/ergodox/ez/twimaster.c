@@ -8,6 +8,8 @@
 **************************************************************************/
 #include <inttypes.h>
 #include <compat/twi.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 
 #include <i2cmaster.h>
 
@@ -206,3 +208,125 @@ unsigned char i2c_readNak(void)
     return TWDR;
 
 }/* i2c_readNak */
+
+
+/*************************************************************************
+ Interrupt driven transactions
+
+ The TWI interrupt walks through the queued transactions one bus event at
+ a time, so the CPU is free while bytes are on the wire. A STOP and the
+ START of the next transaction are issued together.
+*************************************************************************/
+#if (I2C_QUEUE_SIZE & (I2C_QUEUE_SIZE - 1))
+#error "I2C_QUEUE_SIZE must be a power of two"
+#endif
+#define I2C_QUEUE_MASK (I2C_QUEUE_SIZE - 1)
+
+static i2c_transaction_t *i2c_transactions[I2C_QUEUE_SIZE];
+static volatile uint8_t i2c_head;
+static volatile uint8_t i2c_tail;
+static uint8_t i2c_tx_index;
+static uint8_t i2c_rx_index;
+
+static void i2c_finish(i2c_transaction_t *transaction, uint8_t status)
+{
+	transaction->status = status;
+	i2c_tail++;
+	i2c_tx_index = 0;
+	i2c_rx_index = 0;
+	if (i2c_head != i2c_tail) {
+		TWCR = (1<<TWINT) | (1<<TWSTO) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+	} else {
+		TWCR = (1<<TWINT) | (1<<TWSTO) | (1<<TWEN);
+	}
+}
+
+ISR(TWI_vect)
+{
+	i2c_transaction_t *transaction = i2c_transactions[i2c_tail & I2C_QUEUE_MASK];
+
+	switch (TW_STATUS & 0xF8) {
+	case TW_START:
+	case TW_REP_START:
+		TWDR = (i2c_tx_index < transaction->tx_len) ? transaction->address : (transaction->address | I2C_READ);
+		TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+		break;
+
+	case TW_MT_SLA_ACK:
+	case TW_MT_DATA_ACK:
+		if (i2c_tx_index < transaction->tx_len) {
+			TWDR = transaction->tx[i2c_tx_index++];
+			TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+		} else if (transaction->rx_len) {
+			TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+		} else {
+			i2c_finish(transaction, I2C_DONE);
+		}
+		break;
+
+	case TW_MR_DATA_ACK:
+		transaction->rx[i2c_rx_index++] = TWDR;
+		/* fall through */
+	case TW_MR_SLA_ACK:
+		/* acknowledge every byte but the last one */
+		if (i2c_rx_index + 1 < transaction->rx_len) {
+			TWCR = (1<<TWINT) | (1<<TWEA) | (1<<TWEN) | (1<<TWIE);
+		} else {
+			TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+		}
+		break;
+
+	case TW_MR_DATA_NACK:
+		transaction->rx[i2c_rx_index++] = TWDR;
+		i2c_finish(transaction, I2C_DONE);
+		break;
+
+	default:
+		/* NACK, lost arbitration or bus error */
+		i2c_finish(transaction, I2C_FAILED);
+		break;
+	}
+}
+
+
+unsigned char i2c_queue(i2c_transaction_t *transaction)
+{
+	if (!transaction->tx_len && !transaction->rx_len) {
+		transaction->status = I2C_DONE;
+		return 0;
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if ((uint8_t)(i2c_head - i2c_tail) == I2C_QUEUE_SIZE) {
+			return 1;
+		}
+		transaction->status = I2C_PENDING;
+		i2c_transactions[i2c_head++ & I2C_QUEUE_MASK] = transaction;
+		if ((uint8_t)(i2c_head - i2c_tail) == 1) {
+			// wait for the STOP of a blocking transfer before starting
+			while (TWCR & (1<<TWSTO));
+			TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+		}
+	}
+	return 0;
+
+}/* i2c_queue */
+
+
+unsigned char i2c_wait(i2c_transaction_t *transaction)
+{
+	while (transaction->status == I2C_PENDING);
+
+	// make sure received bytes are read after the status
+	__asm__ __volatile__ ("" ::: "memory");
+
+	return transaction->status != I2C_DONE;
+
+}/* i2c_wait */
+
+
+unsigned char i2c_busy(void)
+{
+	return i2c_head != i2c_tail;
+
+}/* i2c_busy */
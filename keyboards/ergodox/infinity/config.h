@@ -54,6 +54,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // The visualizer needs gfx thread priorities
 #define VISUALIZER_THREAD_PRIORITY (NORMAL_PRIORITY - 2)
 
+// The IS31FL3731C has six frames left over for hardware LED animations
+#ifndef EMULATOR
+#define LED_FRAME_BANKS 6
+#endif
+
 /*
  * Feature disable options
  *  These options are also useful to firmware size reduction.
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "src/gdisp/gdisp_driver.h"
 
 #include "board_IS31FL3731C.h"
+#include "led_autoplay.h"
 
 /*===========================================================================*/
 /* Driver local definitions.                                                 */
@@ -96,6 +97,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define IS31_PWM_SIZE 0x90
 
 #define IS31_LED_MASK_SIZE 0x12
+#define IS31_FRAMES 8
+// The frames after the two used for double buffering are the banks for
+// hardware animations
+#define IS31_FIRST_BANK 2
 #define IS31_SCREEN_WIDTH 16
 
 #define IS31
@@ -140,6 +145,11 @@ typedef struct{
     uint8_t write_buffer[IS31_FRAME_SIZE];
     uint8_t frame_buffer[GDISP_SCREEN_HEIGHT * GDISP_SCREEN_WIDTH];
     uint8_t page;
+    // The PWM registers that changed since each of the two frames was last
+    // written, dirty_first > dirty_last when none did
+    uint8_t dirty_first[2];
+    uint8_t dirty_last[2];
+    bool_t autoplay;
 }__attribute__((__packed__)) PrivData;
 
 // Some common routines and macros
@@ -170,6 +180,56 @@ static GFXINLINE void write_ram(GDisplay *g, uint8_t page, uint16_t offset, uint
     write_data(g, (uint8_t*)PRIV(g), length + 1);
 }
 
+// Writes the PWM registers first to last from the write buffer
+static GFXINLINE void write_pwm(GDisplay *g, uint8_t page, uint8_t first, uint8_t last) {
+    // The register address has to go right in front of the data, so it
+    // borrows the byte before it
+    uint8_t* start = first ? &PRIV(g)->write_buffer[first - 1] : &PRIV(g)->write_buffer_offset;
+    uint8_t saved = *start;
+    *start = IS31_PWM_REG + first;
+    write_page(g, page);
+    write_data(g, start, last - first + 2);
+    *start = saved;
+}
+
+// 26 ms * 2^i, the longest one that isn't longer than ms
+static uint8_t breath_time(uint16_t ms) {
+    uint8_t i = 0;
+    while (i < 7 && (26u << (i + 1)) <= ms)
+        i++;
+    return i;
+}
+
+static void start_autoplay(GDisplay *g, const led_autoplay_t* autoplay) {
+    // In steps of 11 ms, where 0 stands for 64 of them
+    uint16_t delay = (autoplay->frame_time + 5) / 11;
+    if (delay < 1)
+        delay = 1;
+    if (delay > 64)
+        delay = 64;
+    // 0 frames means all eight, 0 loops means forever
+    write_register(g, IS31_FUNCTIONREG, IS31_REG_AUTOPLAYCTRL1,
+                   (autoplay->loops & 7) << 4 | (autoplay->num_frames & 7));
+    write_register(g, IS31_FUNCTIONREG, IS31_REG_AUTOPLAYCTRL2, delay & 0x3F);
+    if (autoplay->breathe_time) {
+        uint8_t time = breath_time(autoplay->breathe_time);
+        write_register(g, IS31_FUNCTIONREG, IS31_REG_BREATHCTRL1, time << 4 | time);
+        write_register(g, IS31_FUNCTIONREG, IS31_REG_BREATHCTRL2, IS31_REG_BREATHCTRL2_ENABLE);
+    }
+    write_register(g, IS31_FUNCTIONREG, IS31_REG_CONFIG,
+                   IS31_REG_CONFIG_AUTOPLAYMODE | (IS31_FIRST_BANK + autoplay->first_bank));
+    PRIV(g)->autoplay = true;
+    // The frames were only drawn to be stored, the picture frames get them
+    // when something else is drawn
+    g->flags &= ~GDISP_FLG_NEEDFLUSH;
+}
+
+static void stop_autoplay(GDisplay *g) {
+    write_register(g, IS31_FUNCTIONREG, IS31_REG_BREATHCTRL2, 0);
+    write_register(g, IS31_FUNCTIONREG, IS31_REG_CONFIG, IS31_REG_CONFIG_PICTUREMODE);
+    PRIV(g)->autoplay = false;
+}
+
 LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 	// The private area is the display surface.
 	g->priv = gfxAlloc(sizeof(PrivData));
@@ -199,6 +259,13 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
         gfxSleepMilliseconds(1);
     }
 
+    // the PWM registers of both frames now match the empty frame buffer
+    __builtin_memset(PRIV(g)->write_buffer, 0, IS31_PWM_SIZE);
+    for(uint8_t i=0; i<2; i++) {
+        PRIV(g)->dirty_first[i] = IS31_PWM_SIZE;
+        PRIV(g)->dirty_last[i] = 0;
+    }
+
     // software shutdown disable (i.e. turn stuff on)
     write_register(g, IS31_FUNCTIONREG, IS31_REG_SHUTDOWN, IS31_REG_SHUTDOWN_ON);
     gfxSleepMilliseconds(10);
@@ -224,20 +291,19 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 
 		PRIV(g)->page++;
 		PRIV(g)->page %= 2;
-		// TODO: some smarter algorithm for this
-		// We should run only one physical page at a time
-		// This way we don't need to send so much data, and
-		// we could use slightly less memory
-		uint8_t* src = PRIV(g)->frame_buffer;
-		for (int y=0;y<GDISP_SCREEN_HEIGHT;y++) {
-		    for (int x=0;x<GDISP_SCREEN_WIDTH;x++) {
-		        PRIV(g)->write_buffer[get_led_address(g, x, y)]=cie[*src];
-		        ++src;
-		    }
+		// The write buffer is kept up to date by draw_pixel, only the
+		// registers that changed since this frame was last shown are sent
+		uint8_t page = PRIV(g)->page;
+		if (PRIV(g)->dirty_first[page] <= PRIV(g)->dirty_last[page]) {
+		    write_pwm(g, page, PRIV(g)->dirty_first[page], PRIV(g)->dirty_last[page]);
+		    PRIV(g)->dirty_first[page] = IS31_PWM_SIZE;
+		    PRIV(g)->dirty_last[page] = 0;
+		    gfxSleepMilliseconds(1);
 		}
-        write_ram(g, PRIV(g)->page, IS31_PWM_REG, IS31_PWM_SIZE);
-        gfxSleepMilliseconds(1);
         write_register(g, IS31_FUNCTIONREG, IS31_REG_PICTDISP, PRIV(g)->page);
+		// Drawing ends a hardware animation
+		if (PRIV(g)->autoplay)
+		    stop_autoplay(g);
 
 		g->flags &= ~GDISP_FLG_NEEDFLUSH;
 	}
@@ -258,7 +324,20 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 			y = g->p.y;
 			break;
 		}
-		PRIV(g)->frame_buffer[y * GDISP_SCREEN_WIDTH + x] = gdispColor2Native(g->p.color);
+		uint8_t* pixel = &PRIV(g)->frame_buffer[y * GDISP_SCREEN_WIDTH + x];
+		uint8_t value = gdispColor2Native(g->p.color);
+		// Redrawing a pixel with the color it has is not a change
+		if (*pixel == value)
+			return;
+		*pixel = value;
+		uint8_t address = get_led_address(g, x, y);
+		PRIV(g)->write_buffer[address] = cie[value];
+		for (int i=0;i<2;i++) {
+		    if (address < PRIV(g)->dirty_first[i])
+		        PRIV(g)->dirty_first[i] = address;
+		    if (address > PRIV(g)->dirty_last[i])
+		        PRIV(g)->dirty_last[i] = address;
+		}
 		g->flags |= GDISP_FLG_NEEDFLUSH;
 	}
 #endif
@@ -326,6 +405,24 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 
 		case GDISP_CONTROL_CONTRAST:
 			return;
+
+		case GDISP_CONTROL_LED_STORE_FRAME:
+			if ((unsigned)g->p.ptr >= IS31_FRAMES - IS31_FIRST_BANK)
+				return;
+			write_pwm(g, IS31_FIRST_BANK + (unsigned)g->p.ptr, 0, IS31_PWM_SIZE - 1);
+			gfxSleepMilliseconds(1);
+			return;
+
+		case GDISP_CONTROL_LED_AUTOPLAY:
+			if (g->p.ptr) {
+				start_autoplay(g, (const led_autoplay_t*)g->p.ptr);
+			}
+			else if (PRIV(g)->autoplay) {
+				// Shows what was drawn last, which stops the animation
+				g->flags |= GDISP_FLG_NEEDFLUSH;
+				gdisp_lld_flush(g);
+			}
+			return;
 		}
 	}
 #endif // GDISP_NEED_CONTROL
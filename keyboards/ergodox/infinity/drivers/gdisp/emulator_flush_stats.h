@@ -0,0 +1,16 @@
+#ifndef EMULATOR_FLUSH_STATS_H
+#define EMULATOR_FLUSH_STATS_H
+
+#include <stdint.h>
+
+// What the flushes of the emulated displays would have sent to the real
+// controllers, flushes without changes send nothing and are not counted
+typedef struct {
+    uint32_t flushes;
+    uint32_t bytes;
+} emulator_flush_stats_t;
+
+emulator_flush_stats_t emulator_lcd_flush_stats(void);
+emulator_flush_stats_t emulator_led_flush_stats(void);
+
+#endif
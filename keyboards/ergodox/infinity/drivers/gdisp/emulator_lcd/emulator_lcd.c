@@ -1,4 +1,5 @@
 #define GDISP_DRIVER_VMT		    	GDISPVMT_EMULATOR_LCD_ERGODOX
+#define GDISP_HARDWARE_FLUSH			TRUE
 #define GDISP_HARDWARE_DRAWPIXEL		TRUE
 #define GDISP_HARDWARE_PIXELREAD		TRUE
 #define GDISP_HARDWARE_CONTROL			TRUE
@@ -8,3 +9,69 @@
 #define ROTATE_180_IS_FLIP
 
 #include "emulator/emulator_driver_impl.h"
+#include "drivers/gdisp/emulator_flush_stats.h"
+
+// Counts what the ST7565 driver sends: the changed columns of each page,
+// for the one of its two buffers that is written next
+#define PAGES (GDISP_SCREEN_HEIGHT / 8)
+
+static color_t flushed[GDISP_SCREEN_HEIGHT][GDISP_SCREEN_WIDTH];
+static uint8_t dirty_first[2][PAGES];
+static uint8_t dirty_last[2][PAGES];
+static bool_t buffer2;
+static bool_t flushed_once;
+static emulator_flush_stats_t stats;
+
+LLDSPEC void gdisp_lld_flush(GDisplay *g) {
+	bool_t changed = !flushed_once;
+	if (!flushed_once) {
+		// the controller RAM starts out unknown
+		for (unsigned b = 0; b < 2; b++) {
+			for (unsigned p = 0; p < PAGES; p++) {
+				dirty_first[b][p] = 0;
+				dirty_last[b][p] = GDISP_SCREEN_WIDTH - 1;
+			}
+		}
+		flushed_once = TRUE;
+	}
+	coord_t x = g->p.x;
+	coord_t y = g->p.y;
+	for (g->p.y = 0; g->p.y < GDISP_SCREEN_HEIGHT; g->p.y++) {
+		for (g->p.x = 0; g->p.x < GDISP_SCREEN_WIDTH; g->p.x++) {
+			color_t color = gdisp_lld_get_pixel_color(g);
+			if (color == flushed[g->p.y][g->p.x])
+				continue;
+			flushed[g->p.y][g->p.x] = color;
+			changed = TRUE;
+			unsigned page = g->p.y / 8;
+			for (unsigned b = 0; b < 2; b++) {
+				if (g->p.x < dirty_first[b][page])
+					dirty_first[b][page] = g->p.x;
+				if (g->p.x > dirty_last[b][page])
+					dirty_last[b][page] = g->p.x;
+			}
+		}
+	}
+	g->p.x = x;
+	g->p.y = y;
+	if (!changed)
+		return;
+
+	unsigned b = buffer2 ? 1 : 0;
+	for (unsigned p = 0; p < PAGES; p++) {
+		if (dirty_first[b][p] > dirty_last[b][p])
+			continue;
+		// page, two column bytes, read-modify-write, then the data
+		stats.bytes += 4 + dirty_last[b][p] - dirty_first[b][p] + 1;
+		dirty_first[b][p] = GDISP_SCREEN_WIDTH;
+		dirty_last[b][p] = 0;
+	}
+	// the start line switches to the new buffer
+	stats.bytes += 1;
+	stats.flushes++;
+	buffer2 = !buffer2;
+}
+
+emulator_flush_stats_t emulator_lcd_flush_stats(void) {
+	return stats;
+}
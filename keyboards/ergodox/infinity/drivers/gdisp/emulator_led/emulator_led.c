@@ -1,10 +1,62 @@
 #define GDISP_DRIVER_VMT			    GDISPVMT_EMULATOR_LED_ERGODOX
+#define GDISP_HARDWARE_FLUSH			TRUE
 #define GDISP_HARDWARE_DRAWPIXEL		TRUE
 #define GDISP_HARDWARE_PIXELREAD		TRUE
 #define GDISP_HARDWARE_CONTROL			TRUE
-#define GDISP_LLD_PIXELFORMAT			GDISP_PIXELFORMAT_MONO
+#define GDISP_LLD_PIXELFORMAT			GDISP_PIXELFORMAT_GRAY256
 #define GDISP_SCREEN_WIDTH		        7
 #define GDISP_SCREEN_HEIGHT		        7
 #define ROTATE_180_IS_FLIP
 
 #include "emulator/emulator_driver_impl.h"
+#include "drivers/gdisp/emulator_flush_stats.h"
+
+// Counts what the IS31FL3731C driver sends: the range of changed PWM
+// registers, for the one of its two frames that is shown next. The
+// registers are taken to follow the pixels row by row.
+#define PIXELS (GDISP_SCREEN_WIDTH * GDISP_SCREEN_HEIGHT)
+
+static color_t flushed[PIXELS];
+static uint8_t dirty_first[2] = {PIXELS, PIXELS};
+static uint8_t dirty_last[2];
+static uint8_t frame;
+static emulator_flush_stats_t stats;
+
+LLDSPEC void gdisp_lld_flush(GDisplay *g) {
+	bool_t changed = FALSE;
+	coord_t x = g->p.x;
+	coord_t y = g->p.y;
+	for (g->p.y = 0; g->p.y < GDISP_SCREEN_HEIGHT; g->p.y++) {
+		for (g->p.x = 0; g->p.x < GDISP_SCREEN_WIDTH; g->p.x++) {
+			uint8_t address = g->p.y * GDISP_SCREEN_WIDTH + g->p.x;
+			color_t color = gdisp_lld_get_pixel_color(g);
+			if (color == flushed[address])
+				continue;
+			flushed[address] = color;
+			changed = TRUE;
+			for (unsigned f = 0; f < 2; f++) {
+				if (address < dirty_first[f])
+					dirty_first[f] = address;
+				if (address > dirty_last[f])
+					dirty_last[f] = address;
+			}
+		}
+	}
+	g->p.x = x;
+	g->p.y = y;
+	if (!changed)
+		return;
+
+	uint8_t next = frame ^ 1;
+	// frame select, register address and data, then the picture
+	// display register on the function page
+	stats.bytes += 2 + 1 + dirty_last[next] - dirty_first[next] + 1 + 4;
+	stats.flushes++;
+	dirty_first[next] = PIXELS;
+	dirty_last[next] = 0;
+	frame = next;
+}
+
+emulator_flush_stats_t emulator_led_flush_stats(void) {
+	return stats;
+}
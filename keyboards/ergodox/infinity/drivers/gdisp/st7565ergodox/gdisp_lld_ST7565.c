@@ -56,8 +56,19 @@
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#define GDISP_PAGES (GDISP_SCREEN_HEIGHT / 8)
+
+// The columns of a page that changed since it was last sent, first > last
+// when none did
+typedef struct{
+    uint8_t first;
+    uint8_t last;
+}DirtyColumns;
+
 typedef struct{
     bool_t buffer2;
+    // One set for each of the two buffers in the controller RAM
+    DirtyColumns dirty[2][GDISP_PAGES];
     uint8_t ram[GDISP_SCREEN_HEIGHT * GDISP_SCREEN_WIDTH / 8];
 }PrivData;
 
@@ -74,6 +85,16 @@ typedef struct{
 #define xyaddr(x, y)		((x) + ((y)>>3)*GDISP_SCREEN_WIDTH)
 #define xybit(y)			(1<<((y)&7))
 
+static void set_dirty(GDisplay* g, unsigned x, unsigned page) {
+	for (unsigned b = 0; b < 2; b++) {
+		DirtyColumns* d = &PRIV(g)->dirty[b][page];
+		if (x < d->first)
+			d->first = x;
+		if (x > d->last)
+			d->last = x;
+	}
+}
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -89,6 +110,14 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 	// The private area is the display surface.
 	g->priv = gfxAlloc(sizeof(PrivData));
 	PRIV(g)->buffer2 = false;
+	// Nothing is known about the controller RAM yet
+	for (unsigned p = 0; p < GDISP_PAGES; p++) {
+		for (unsigned b = 0; b < 2; b++) {
+			PRIV(g)->dirty[b][p].first = 0;
+			PRIV(g)->dirty[b][p].last = GDISP_SCREEN_WIDTH - 1;
+		}
+	}
+	g->flags |= GDISP_FLG_NEEDFLUSH;
 
 	// Initialise the board interface
 	init_board(g);
@@ -155,14 +184,23 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 		if (!(g->flags & GDISP_FLG_NEEDFLUSH))
 			return;
 
+		// Only the columns that changed since this buffer was last
+		// written are sent
 		acquire_bus(g);
 		unsigned dstOffset = (PRIV(g)->buffer2 ? 4 : 0);
-		for (p = 0; p < 4; p++) {
+		DirtyColumns* dirty = PRIV(g)->dirty[PRIV(g)->buffer2 ? 1 : 0];
+		for (p = 0; p < GDISP_PAGES; p++) {
+			unsigned first = dirty[p].first;
+			unsigned last = dirty[p].last;
+			if (first > last)
+				continue;
 			write_cmd(g, ST7565_PAGE | (p + dstOffset));
-			write_cmd(g, ST7565_COLUMN_MSB | 0);
-			write_cmd(g, ST7565_COLUMN_LSB | 0);
+			write_cmd(g, ST7565_COLUMN_MSB | (first >> 4));
+			write_cmd(g, ST7565_COLUMN_LSB | (first & 0xF));
 			write_cmd(g, ST7565_RMW);
-			write_data(g, RAM(g) + (p*GDISP_SCREEN_WIDTH), GDISP_SCREEN_WIDTH);
+			write_data(g, RAM(g) + (p*GDISP_SCREEN_WIDTH) + first, last - first + 1);
+			dirty[p].first = GDISP_SCREEN_WIDTH;
+			dirty[p].last = 0;
 		}
 		unsigned line = (PRIV(g)->buffer2 ? 32 : 0);
         write_cmd(g, ST7565_START_LINE | line);
@@ -196,11 +234,18 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
 			y = g->p.x;
 			break;
 		}
+		uint8_t* ram = &RAM(g)[xyaddr(x, y)];
+		uint8_t value;
 		if (gdispColor2Native(g->p.color) != Black)
-			RAM(g)[xyaddr(x, y)] |= xybit(y);
+			value = *ram | xybit(y);
 		else
-			RAM(g)[xyaddr(x, y)] &= ~xybit(y);
-		g->flags |= GDISP_FLG_NEEDFLUSH;
+			value = *ram & ~xybit(y);
+		// Redrawing a pixel with the color it has is not a change
+		if (value != *ram) {
+			*ram = value;
+			set_dirty(g, x, y >> 3);
+			g->flags |= GDISP_FLG_NEEDFLUSH;
+		}
 	}
 #endif
 
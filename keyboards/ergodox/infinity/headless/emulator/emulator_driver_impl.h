@@ -0,0 +1,75 @@
+// The part of the emulator display drivers that is shared between the LCD
+// and the LED display, for running without a window. The pixels only live
+// in memory, where gdispGGetPixelColor() reads them back. They are stored
+// the way the real controllers keep them, so the LCD is one bit per pixel
+// and the LEDs have 256 levels.
+//
+// The including driver defines the screen size, the pixel format and the
+// flush, which counts what the real driver would have sent.
+
+#include "gfx.h"
+#include "src/gdisp/gdisp_driver.h"
+
+#ifndef GDISP_INITIAL_CONTRAST
+	#define GDISP_INITIAL_CONTRAST	50
+#endif
+#ifndef GDISP_INITIAL_BACKLIGHT
+	#define GDISP_INITIAL_BACKLIGHT	100
+#endif
+
+static color_t emulator_pixels[GDISP_SCREEN_HEIGHT][GDISP_SCREEN_WIDTH];
+
+static color_t *emulator_pixel(GDisplay *g) {
+	coord_t x = g->p.x;
+	coord_t y = g->p.y;
+	if (g->g.Orientation == GDISP_ROTATE_180) {
+		// On the real drivers turning the display only mirrors the columns
+		x = GDISP_SCREEN_WIDTH - 1 - x;
+#ifndef ROTATE_180_IS_FLIP
+		y = GDISP_SCREEN_HEIGHT - 1 - y;
+#endif
+	}
+	return &emulator_pixels[y][x];
+}
+
+LLDSPEC bool_t gdisp_lld_init(GDisplay *g) {
+	g->g.Width = GDISP_SCREEN_WIDTH;
+	g->g.Height = GDISP_SCREEN_HEIGHT;
+	g->g.Orientation = GDISP_ROTATE_0;
+	g->g.Powermode = powerOn;
+	g->g.Backlight = GDISP_INITIAL_BACKLIGHT;
+	g->g.Contrast = GDISP_INITIAL_CONTRAST;
+	return TRUE;
+}
+
+LLDSPEC void gdisp_lld_draw_pixel(GDisplay *g) {
+#if GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_MONO
+	*emulator_pixel(g) = gdispColor2Native(g->p.color) != Black ? White : Black;
+#else
+	*emulator_pixel(g) = gdispNative2Color(gdispColor2Native(g->p.color));
+#endif
+}
+
+LLDSPEC color_t gdisp_lld_get_pixel_color(GDisplay *g) {
+	return *emulator_pixel(g);
+}
+
+LLDSPEC void gdisp_lld_control(GDisplay *g) {
+	switch(g->p.x) {
+	case GDISP_CONTROL_POWER:
+		g->g.Powermode = (powermode_t)g->p.ptr;
+		return;
+	case GDISP_CONTROL_ORIENTATION:
+		// The visualizer only turns the displays upside down
+		if ((orientation_t)g->p.ptr != GDISP_ROTATE_0 && (orientation_t)g->p.ptr != GDISP_ROTATE_180)
+			return;
+		g->g.Orientation = (orientation_t)g->p.ptr;
+		return;
+	case GDISP_CONTROL_BACKLIGHT:
+		g->g.Backlight = (unsigned)g->p.ptr;
+		return;
+	case GDISP_CONTROL_CONTRAST:
+		g->g.Contrast = (unsigned)g->p.ptr;
+		return;
+	}
+}
@@ -0,0 +1,234 @@
+// Runs the visualizer against the emulator display drivers without a window,
+// and reports what every frame cost: the time the visualizer thread spent
+// drawing it, and the bytes the real LCD and LED drivers would have sent.
+//
+//   visualizer_bench [-o frame_dir] [script]
+//
+// With -o every frame that changed a display is written to frame_dir as
+// NNNNN_lcd.ppm and NNNNN_led.ppm, the LCD tinted by the backlight color.
+//
+// The script has one command per line, # starts a comment:
+//
+//   layer 0x6      sets layer_state
+//   default 0x1    sets default_layer_state
+//   leds 0x2       sets the host LEDs
+//   suspend        suspends the keyboard
+//   resume         wakes it up again
+//   wait 500       lets the visualizer run for that many milliseconds
+//
+// The visualizer runs in real time, the built in script takes about
+// 20 seconds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "visualizer.h"
+#include "lcd_backlight.h"
+#include "drivers/gdisp/emulator_flush_stats.h"
+
+static const char* default_script[] = {
+    "wait 7000",
+    "layer 0x2",
+    "wait 1000",
+    "layer 0x0",
+    "wait 100",
+    "layer 0x2",
+    "wait 3000",
+    "leds 0x2",
+    "wait 500",
+    "layer 0x6",
+    "default 0x1",
+    "wait 3000",
+    "suspend",
+    "wait 1000",
+    "resume",
+    "wait 4000",
+};
+
+static const char* frame_dir;
+
+static uint8_t backlight[3];
+
+static uint64_t start_time;
+static uint64_t wakeup_time;
+static uint32_t frame_number;
+static emulator_flush_stats_t last_lcd;
+static emulator_flush_stats_t last_led;
+
+static gfxMutex totals_mutex;
+static uint32_t total_frames;
+static uint64_t total_render;
+static uint64_t max_render;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void lcd_backlight_hal_init(void) {
+}
+
+void lcd_backlight_hal_color(uint16_t r, uint16_t g, uint16_t b) {
+    backlight[0] = r >> 8;
+    backlight[1] = g >> 8;
+    backlight[2] = b >> 8;
+}
+
+// The visualizer thread sleeps here between frames, see -Wl,--wrap in the
+// Makefile. A frame starts when it wakes up.
+GEvent* __real_geventEventWait(GListener* pl, delaytime_t timeout);
+
+GEvent* __wrap_geventEventWait(GListener* pl, delaytime_t timeout) {
+    GEvent* event = __real_geventEventWait(pl, timeout);
+    wakeup_time = now_ns();
+    return event;
+}
+
+static void write_ppm(GDisplay* display, const char* name, bool tint) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%05u_%s.ppm", frame_dir, frame_number, name);
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+    coord_t width = gdispGGetWidth(display);
+    coord_t height = gdispGGetHeight(display);
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (coord_t y = 0; y < height; y++) {
+        for (coord_t x = 0; x < width; x++) {
+            color_t color = gdispGGetPixelColor(display, x, y);
+            uint8_t rgb[3] = {RED_OF(color), GREEN_OF(color), BLUE_OF(color)};
+            if (tint) {
+                for (int i = 0; i < 3; i++) {
+                    rgb[i] = rgb[i] * backlight[i] / 255;
+                }
+            }
+            fwrite(rgb, 1, 3, file);
+        }
+    }
+    fclose(file);
+}
+
+// Called by the visualizer thread after every frame
+void draw_emulator(void) {
+    uint64_t render = now_ns() - wakeup_time;
+    emulator_flush_stats_t lcd = emulator_lcd_flush_stats();
+    emulator_flush_stats_t led = emulator_led_flush_stats();
+    uint32_t lcd_bytes = lcd.bytes - last_lcd.bytes;
+    uint32_t led_bytes = led.bytes - last_led.bytes;
+    last_lcd = lcd;
+    last_led = led;
+
+    printf("%8u ms  frame %5u  render %6u us  lcd %5u bytes  led %4u bytes\n",
+           (unsigned)((wakeup_time - start_time) / 1000000), frame_number, (unsigned)(render / 1000),
+           lcd_bytes, led_bytes);
+    if (frame_dir && (lcd_bytes || led_bytes)) {
+        write_ppm(LCD_DISPLAY, "lcd", true);
+        write_ppm(LED_DISPLAY, "led", false);
+    }
+    frame_number++;
+
+    gfxMutexEnter(&totals_mutex);
+    total_frames++;
+    total_render += render;
+    if (render > max_render) {
+        max_render = render;
+    }
+    gfxMutexExit(&totals_mutex);
+}
+
+static uint32_t default_layer_state;
+static uint32_t layer_state;
+static uint32_t leds;
+
+static void run_command(const char* line, int line_number) {
+    char command[16];
+    long value = 0;
+    int fields = sscanf(line, " %15s %li", command, &value);
+    if (fields < 1 || command[0] == '#') {
+        return;
+    }
+    if (strcmp(command, "layer") == 0 && fields == 2) {
+        layer_state = value;
+    }
+    else if (strcmp(command, "default") == 0 && fields == 2) {
+        default_layer_state = value;
+    }
+    else if (strcmp(command, "leds") == 0 && fields == 2) {
+        leds = value;
+    }
+    else if (strcmp(command, "suspend") == 0) {
+        visualizer_suspend();
+        return;
+    }
+    else if (strcmp(command, "resume") == 0) {
+        visualizer_resume();
+        return;
+    }
+    else if (strcmp(command, "wait") == 0 && fields == 2) {
+        gfxSleepMilliseconds(value);
+        return;
+    }
+    else {
+        fprintf(stderr, "line %d: can't parse '%s'\n", line_number, line);
+        exit(1);
+    }
+    visualizer_update(default_layer_state, layer_state, leds);
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        if (opt == 'o') {
+            frame_dir = optarg;
+        }
+        else {
+            fprintf(stderr, "usage: %s [-o frame_dir] [script]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    gfxMutexInit(&totals_mutex);
+    // The first frame is not woken up, and also pays for starting up
+    start_time = now_ns();
+    wakeup_time = start_time;
+    visualizer_init();
+    visualizer_update(default_layer_state, layer_state, leds);
+
+    if (optind < argc) {
+        FILE* script = fopen(argv[optind], "r");
+        if (!script) {
+            perror(argv[optind]);
+            return 1;
+        }
+        char line[128];
+        int line_number = 1;
+        while (fgets(line, sizeof(line), script)) {
+            line[strcspn(line, "\r\n")] = 0;
+            run_command(line, line_number++);
+        }
+        fclose(script);
+    }
+    else {
+        for (unsigned i = 0; i < sizeof(default_script) / sizeof(default_script[0]); i++) {
+            run_command(default_script[i], i + 1);
+        }
+    }
+
+    gfxMutexEnter(&totals_mutex);
+    emulator_flush_stats_t lcd = emulator_lcd_flush_stats();
+    emulator_flush_stats_t led = emulator_led_flush_stats();
+    printf("frames %u  render mean %u us max %u us\n", total_frames,
+           (unsigned)(total_frames ? total_render / total_frames / 1000 : 0),
+           (unsigned)(max_render / 1000));
+    printf("lcd %u bytes in %u flushes  led %u bytes in %u flushes\n",
+           lcd.bytes, lcd.flushes, led.bytes, led.flushes);
+    gfxMutexExit(&totals_mutex);
+    return 0;
+}
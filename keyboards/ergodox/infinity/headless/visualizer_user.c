@@ -0,0 +1,92 @@
+// A visualizer that keeps both displays busy, for the benchmark. It follows
+// quantum/visualizer/example_integration, and runs the LED test on the
+// LED display. Set VISUALIZER_USER to render a keymap's visualizer instead.
+
+#include "visualizer.h"
+#include "led_test.h"
+
+static const char* welcome_text[] = {"QMK", "Infinity Ergodox"};
+
+static bool display_welcome(keyframe_animation_t* animation, visualizer_state_t* state) {
+    (void)animation;
+    gdispClear(White);
+    gdispDrawString(0, 3, welcome_text[0], state->font_dejavusansbold12, Black);
+    gdispDrawString(0, 15, welcome_text[1], state->font_dejavusansbold12, Black);
+    gdispFlush();
+    return false;
+}
+
+static keyframe_animation_t startup_animation = {
+    .num_frames = 4,
+    .loop = false,
+    .frame_lengths = {0, gfxMillisecondsToTicks(1000), gfxMillisecondsToTicks(5000), 0},
+    .frame_functions = {display_welcome, keyframe_animate_backlight_color, keyframe_no_operation, enable_visualization},
+};
+
+static keyframe_animation_t color_animation = {
+    .num_frames = 2,
+    .loop = false,
+    .frame_lengths = {gfxMillisecondsToTicks(200), gfxMillisecondsToTicks(500)},
+    .frame_functions = {keyframe_no_operation, keyframe_animate_backlight_color},
+};
+
+static keyframe_animation_t lcd_animation = {
+    .num_frames = 2,
+    .loop = true,
+    .frame_lengths = {gfxMillisecondsToTicks(2000), gfxMillisecondsToTicks(2000)},
+    .frame_functions = {keyframe_display_layer_text, keyframe_display_layer_bitmap},
+};
+
+static keyframe_animation_t suspend_animation = {
+    .num_frames = 3,
+    .loop = false,
+    .frame_lengths = {0, gfxMillisecondsToTicks(1000), 0},
+    .frame_functions = {keyframe_display_layer_text, keyframe_animate_backlight_color, keyframe_disable_lcd_and_backlight},
+};
+
+static keyframe_animation_t resume_animation = {
+    .num_frames = 5,
+    .loop = false,
+    .frame_lengths = {0, 0, gfxMillisecondsToTicks(1000), gfxMillisecondsToTicks(1000), 0},
+    .frame_functions = {keyframe_enable_lcd_and_backlight, display_welcome, keyframe_animate_backlight_color, keyframe_no_operation, enable_visualization},
+};
+
+void initialize_user_visualizer(visualizer_state_t* state) {
+    lcd_backlight_brightness(0x50);
+    state->current_lcd_color = LCD_COLOR(0x00, 0x00, 0xFF);
+    state->target_lcd_color = LCD_COLOR(0x10, 0xFF, 0xFF);
+    start_keyframe_animation(&startup_animation);
+    start_keyframe_animation(&led_test_animation);
+}
+
+void update_user_visualizer_state(visualizer_state_t* state) {
+    if (state->status.layer & 0x4) {
+        state->target_lcd_color = LCD_COLOR(0xC0, 0xB0, 0xFF);
+        state->layer_text = "Layer 3";
+    }
+    else if (state->status.layer & 0x2) {
+        state->target_lcd_color = LCD_COLOR(0xA0, 0xB0, 0xFF);
+        state->layer_text = "Layer 2";
+    }
+    else {
+        state->target_lcd_color = LCD_COLOR(0x50, 0xB0, 0xFF);
+        state->layer_text = "Layer 1";
+    }
+    start_keyframe_animation(&lcd_animation);
+    start_keyframe_animation(&color_animation);
+}
+
+void user_visualizer_suspend(visualizer_state_t* state) {
+    state->layer_text = "Suspending...";
+    uint8_t hue = LCD_HUE(state->current_lcd_color);
+    uint8_t sat = LCD_SAT(state->current_lcd_color);
+    state->target_lcd_color = LCD_COLOR(hue, sat, 0);
+    start_keyframe_animation(&suspend_animation);
+}
+
+void user_visualizer_resume(visualizer_state_t* state) {
+    state->current_lcd_color = LCD_COLOR(0x00, 0x00, 0x00);
+    state->target_lcd_color = LCD_COLOR(0x10, 0xFF, 0xFF);
+    start_keyframe_animation(&resume_animation);
+    start_keyframe_animation(&led_test_animation);
+}
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "print.h"
 #include "debug.h"
 #include "matrix.h"
+#include "debounce.h"
 
 
 /*
@@ -37,8 +38,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
 static matrix_row_t matrix_debouncing[LOCAL_MATRIX_ROWS];
-static bool debouncing = false;
-static uint16_t debouncing_time = 0;
+
+#ifndef MATRIX_IO_DELAY
+#   define MATRIX_IO_DELAY 20
+#endif
 
 
 void matrix_init(void)
@@ -63,12 +66,14 @@ void matrix_init(void)
 
     memset(matrix, 0, MATRIX_ROWS);
     memset(matrix_debouncing, 0, LOCAL_MATRIX_ROWS);
+    debounce_init(LOCAL_MATRIX_ROWS);
 
     matrix_init_quantum();
 }
 
 uint8_t matrix_scan(void)
 {
+    bool changed = false;
     for (int row = 0; row < LOCAL_MATRIX_ROWS; row++) {
         matrix_row_t data = 0;
 
@@ -90,7 +95,7 @@ uint8_t matrix_scan(void)
         // the keyboard might freeze, or there might not be enough
         // processing power to update the LCD screen properly.
         // 20us, or two ticks at 100000Hz seems to be OK
-        wait_us(20);
+        wait_us(MATRIX_IO_DELAY);
 
         // read col data: { PTD1, PTD4, PTD5, PTD6, PTD7 }
         data = ((palReadPort(GPIOD) & 0xF0) >> 3) |
@@ -111,8 +116,7 @@ uint8_t matrix_scan(void)
 
         if (matrix_debouncing[row] != data) {
             matrix_debouncing[row] = data;
-            debouncing = true;
-            debouncing_time = timer_read();
+            changed = true;
         }
     }
 
@@ -123,12 +127,7 @@ uint8_t matrix_scan(void)
     }
 #endif
 
-    if (debouncing && timer_elapsed(debouncing_time) > DEBOUNCE) {
-        for (int row = 0; row < LOCAL_MATRIX_ROWS; row++) {
-            matrix[offset + row] = matrix_debouncing[row];
-        }
-        debouncing = false;
-    }
+    debounce(matrix_debouncing, matrix + offset, LOCAL_MATRIX_ROWS, changed);
     matrix_scan_quantum();
     return 1;
 }
@@ -28,23 +28,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
-#include "split_util.h"
+#include "split/split_util.h"
+#include "split/transport.h"
 #include "pro_micro.h"
 #include "config.h"
+#include "debounce.h"
 
-#ifdef USE_I2C
-#  include "i2c.h"
-#else // USE_SERIAL
-#  include "serial.h"
-#endif
+#define ERROR_DISCONNECT_COUNT 5
 
-#ifndef DEBOUNCE
-#  define DEBOUNCE	5
+#ifndef MATRIX_IO_DELAY
+#  define MATRIX_IO_DELAY 30
 #endif
 
-#define ERROR_DISCONNECT_COUNT 5
-
-static uint8_t debouncing = DEBOUNCE;
 static const int ROWS_PER_HAND = MATRIX_ROWS/2;
 static uint8_t error_count = 0;
 
@@ -117,6 +112,8 @@ void matrix_init(void)
         matrix_debouncing[i] = 0;
     }
 
+    debounce_init(ROWS_PER_HAND);
+
     matrix_init_quantum();
 }
 
@@ -124,91 +121,31 @@ uint8_t _matrix_scan(void)
 {
     // Right hand is stored after the left in the matirx so, we need to offset it
     int offset = isLeftHand ? 0 : (ROWS_PER_HAND);
+    bool changed = false;
 
     for (uint8_t i = 0; i < ROWS_PER_HAND; i++) {
         select_row(i);
-        _delay_us(30);  // without this wait read unstable value.
+        _delay_us(MATRIX_IO_DELAY);  // without this wait read unstable value.
         matrix_row_t cols = read_cols();
         if (matrix_debouncing[i+offset] != cols) {
             matrix_debouncing[i+offset] = cols;
-            debouncing = DEBOUNCE;
+            changed = true;
         }
         unselect_rows();
     }
 
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
-        } else {
-            for (uint8_t i = 0; i < ROWS_PER_HAND; i++) {
-                matrix[i+offset] = matrix_debouncing[i+offset];
-            }
-        }
-    }
+    debounce(matrix_debouncing + offset, matrix + offset, ROWS_PER_HAND, changed);
 
     return 1;
 }
 
-#ifdef USE_I2C
-
-// Get rows from other half over i2c
-int i2c_transaction(void) {
-    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
-
-    int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
-    if (err) goto i2c_error;
-
-    // start of matrix stored at 0x00
-    err = i2c_master_write(0x00);
-    if (err) goto i2c_error;
-
-    // Start read
-    err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_READ);
-    if (err) goto i2c_error;
-
-    if (!err) {
-        int i;
-        for (i = 0; i < ROWS_PER_HAND-1; ++i) {
-            matrix[slaveOffset+i] = i2c_master_read(I2C_ACK);
-        }
-        matrix[slaveOffset+i] = i2c_master_read(I2C_NACK);
-        i2c_master_stop();
-    } else {
-i2c_error: // the cable is disconnceted, or something else went wrong
-        i2c_reset_state();
-        return err;
-    }
-
-    return 0;
-}
-
-#else // USE_SERIAL
-
-int serial_transaction(void) {
-    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
-
-    if (serial_update_buffers()) {
-        return 1;
-    }
-
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        matrix[slaveOffset+i] = serial_slave_buffer[i];
-    }
-    return 0;
-}
-#endif
-
 uint8_t matrix_scan(void)
 {
     int ret = _matrix_scan();
+    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
 
-
-
-#ifdef USE_I2C
-    if( i2c_transaction() ) {
-#else // USE_SERIAL
-    if( serial_transaction() ) {
-#endif
+    // get rows from other half
+    if( !transport_master(matrix + slaveOffset) ) {
         // turn on the indicator led when halves are disconnected
         TXLED1;
 
@@ -216,10 +153,10 @@ uint8_t matrix_scan(void)
 
         if (error_count > ERROR_DISCONNECT_COUNT) {
             // reset other half if disconnected
-            int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
             for (int i = 0; i < ROWS_PER_HAND; ++i) {
                 matrix[slaveOffset+i] = 0;
             }
+            transport_master_reset();
         }
     } else {
         // turn off the indicator led on no error
@@ -237,21 +174,12 @@ void matrix_slave_scan(void) {
 
     int offset = (isLeftHand) ? 0 : (MATRIX_ROWS / 2);
 
-#ifdef USE_I2C
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        /* i2c_slave_buffer[i] = matrix[offset+i]; */
-        i2c_slave_buffer[i] = matrix[offset+i];
-    }
-#else // USE_SERIAL
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        serial_slave_buffer[i] = matrix[offset+i];
-    }
-#endif
+    transport_slave(matrix + offset);
 }
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
+    if (debounce_active()) return false;
     return true;
 }
 
@@ -275,6 +203,7 @@ void matrix_print(void)
         pbin_reverse16(matrix_get_row(row));
         print("\n");
     }
+    transport_print_stats();
 }
 
 uint8_t matrix_key_count(void)
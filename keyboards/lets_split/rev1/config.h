@@ -46,6 +46,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #  define USE_SERIAL
 #endif
 
+// Serial PHY, the bit-banged one on D0 is used if neither is defined
+// #define SERIAL_PHY_USART
+// #define SERIAL_PHY_ICP
+
 // #define EE_HANDS
 
 #define I2C_MASTER_LEFT
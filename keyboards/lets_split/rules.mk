@@ -1,7 +1,4 @@
-SRC += matrix.c \
-	   i2c.c \
-	   split_util.c \
-	   serial.c
+SRC += matrix.c
 
 # MCU name
 #MCU = at90usb1287
@@ -73,3 +70,4 @@ USE_I2C ?= yes
 SLEEP_LED_ENABLE ?= no    # Breathing sleep LED during USB suspend
 
 CUSTOM_MATRIX = yes
+SPLIT_KEYBOARD = yes
@@ -0,0 +1,47 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+
+/* Debounce time in milliseconds, set 0 if debouncing isn't needed.
+ * DEBOUNCE is accepted as well for older keyboard configs. */
+#ifndef DEBOUNCING_DELAY
+#   ifdef DEBOUNCE
+#       define DEBOUNCING_DELAY DEBOUNCE
+#   else
+#       define DEBOUNCING_DELAY 5
+#   endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The debounce algorithm is selected at build time with DEBOUNCE_TYPE in
+ * rules.mk:
+ *   sym_g               - symmetric, global: the whole matrix is updated once
+ *                         no key changed for DEBOUNCING_DELAY (default)
+ *   asym_eager_defer_pk - per key: presses are reported at once and then
+ *                         locked, releases are reported once the key has been
+ *                         up for DEBOUNCING_DELAY
+ *   eager_pr            - per row: a changed row is reported at once and
+ *                         then locked for DEBOUNCING_DELAY
+ *   custom              - no algorithm is compiled, the keyboard brings its own
+ *
+ * A matrix scanner reads into raw[] and calls debounce() once per scan, with
+ * changed set when raw[] differs from the previous scan. cooked[] is the
+ * debounced matrix that matrix_get_row() should return. Split keyboards pass
+ * only the rows of the local half.
+ */
+void debounce_init(uint8_t num_rows);
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed);
+/* true while a change is still waiting to be reported */
+bool debounce_active(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
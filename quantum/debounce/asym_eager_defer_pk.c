@@ -0,0 +1,121 @@
+/*
+ * Asymmetric per-key debouncing: eager on press, deferred on release
+ *
+ * A press is reported on the first scan that sees it, after which the key is
+ * locked for DEBOUNCING_DELAY so contact bounce can't produce a release.
+ * A release is only reported once the key has read as up for DEBOUNCING_DELAY
+ * without interruption. Every key keeps its own counter, so activity on one
+ * key never delays another.
+ *
+ * Counters hold the remaining milliseconds, the top bit marks a pending
+ * release. They are only walked while at least one of them is running.
+ */
+#include "debounce.h"
+#include "timer.h"
+
+#if (DEBOUNCING_DELAY > 0)
+
+#if (DEBOUNCING_DELAY > 127)
+#   error "DEBOUNCING_DELAY must be 127 or less for asym_eager_defer_pk"
+#endif
+
+#define COUNTER_RELEASING 0x80
+#define COUNTER_MASK      0x7F
+
+static uint8_t counters[MATRIX_ROWS * MATRIX_COLS];
+static bool counters_active = false;
+static uint16_t last_time;
+
+void debounce_init(uint8_t num_rows)
+{
+    for (uint16_t i = 0; i < num_rows * MATRIX_COLS; i++) {
+        counters[i] = 0;
+    }
+    counters_active = false;
+    last_time = timer_read();
+}
+
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed)
+{
+    uint16_t now = timer_read();
+    uint16_t elapsed = TIMER_DIFF_16(now, last_time);
+    last_time = now;
+
+    if (!changed && !counters_active) {
+        return;
+    }
+
+    bool active = false;
+    uint8_t *counter = counters;
+    for (uint8_t row = 0; row < num_rows; row++) {
+        matrix_row_t raw_row = raw[row];
+        matrix_row_t cooked_row = cooked[row];
+        for (uint8_t col = 0; col < MATRIX_COLS; col++, counter++) {
+            uint8_t state = *counter;
+            matrix_row_t col_bit = (matrix_row_t)1 << col;
+            if (!state && !((raw_row ^ cooked_row) & col_bit)) {
+                continue;
+            }
+
+            uint8_t remaining = state & COUNTER_MASK;
+            remaining = remaining > elapsed ? remaining - elapsed : 0;
+
+            if (!((raw_row ^ cooked_row) & col_bit)) {
+                // Raw agrees with the reported state, a pending release
+                // turned out to be a bounce.
+                state = (state & COUNTER_RELEASING) ? 0 : remaining;
+            } else if (raw_row & col_bit) {
+                // Pressed, report it right away unless still locked
+                if (!remaining) {
+                    cooked_row |= col_bit;
+                    remaining = DEBOUNCING_DELAY;
+                }
+                state = remaining;
+            } else if (state & COUNTER_RELEASING) {
+                if (remaining) {
+                    state = COUNTER_RELEASING | remaining;
+                } else {
+                    cooked_row &= ~col_bit;
+                    state = 0;
+                }
+            } else {
+                // Released, start the deferral once the press lock is over
+                state = remaining ? remaining : (COUNTER_RELEASING | DEBOUNCING_DELAY);
+            }
+
+            *counter = state;
+            if (state) {
+                active = true;
+            }
+        }
+        cooked[row] = cooked_row;
+    }
+    counters_active = active;
+}
+
+bool debounce_active(void)
+{
+    return counters_active;
+}
+
+#else
+
+void debounce_init(uint8_t num_rows)
+{
+}
+
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed)
+{
+    if (changed) {
+        for (uint8_t i = 0; i < num_rows; i++) {
+            cooked[i] = raw[i];
+        }
+    }
+}
+
+bool debounce_active(void)
+{
+    return false;
+}
+
+#endif
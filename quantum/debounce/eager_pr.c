@@ -0,0 +1,83 @@
+/*
+ * Eager per-row debouncing
+ *
+ * A changed row is reported on the first scan that sees it, then locked for
+ * DEBOUNCING_DELAY so bounces on that row are ignored. Other rows are not
+ * affected. Needs one counter per row instead of one per key.
+ */
+#include "debounce.h"
+#include "timer.h"
+
+#if (DEBOUNCING_DELAY > 0)
+
+#if (DEBOUNCING_DELAY > 255)
+#   error "DEBOUNCING_DELAY must be 255 or less for eager_pr"
+#endif
+
+static uint8_t counters[MATRIX_ROWS];
+static bool counters_active = false;
+static uint16_t last_time;
+
+void debounce_init(uint8_t num_rows)
+{
+    for (uint8_t i = 0; i < num_rows; i++) {
+        counters[i] = 0;
+    }
+    counters_active = false;
+    last_time = timer_read();
+}
+
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed)
+{
+    uint16_t now = timer_read();
+    uint16_t elapsed = TIMER_DIFF_16(now, last_time);
+    last_time = now;
+
+    if (!changed && !counters_active) {
+        return;
+    }
+
+    bool active = false;
+    for (uint8_t row = 0; row < num_rows; row++) {
+        uint8_t remaining = counters[row];
+        if (remaining) {
+            remaining = remaining > elapsed ? remaining - elapsed : 0;
+        }
+        if (!remaining && raw[row] != cooked[row]) {
+            cooked[row] = raw[row];
+            remaining = DEBOUNCING_DELAY;
+        }
+        counters[row] = remaining;
+        if (remaining) {
+            active = true;
+        }
+    }
+    counters_active = active;
+}
+
+bool debounce_active(void)
+{
+    return counters_active;
+}
+
+#else
+
+void debounce_init(uint8_t num_rows)
+{
+}
+
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed)
+{
+    if (changed) {
+        for (uint8_t i = 0; i < num_rows; i++) {
+            cooked[i] = raw[i];
+        }
+    }
+}
+
+bool debounce_active(void)
+{
+    return false;
+}
+
+#endif
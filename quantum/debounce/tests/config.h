@@ -0,0 +1,12 @@
+/* Config the debounce algorithms are tested with, the timer is faked in
+ * debounce_tests.cpp
+ */
+#ifndef DEBOUNCE_TEST_CONFIG_H
+#define DEBOUNCE_TEST_CONFIG_H
+
+#define MATRIX_ROWS 4
+#define MATRIX_COLS 8
+
+#define DEBOUNCING_DELAY 5
+
+#endif
@@ -0,0 +1,169 @@
+#include "gtest/gtest.h"
+#include <cstring>
+#include <string>
+#include <vector>
+extern "C" {
+#include "debounce.h"
+#include "timer.h"
+}
+
+/* Fake timer, the tests move it one ms per scan */
+static uint16_t fake_time;
+
+extern "C" {
+uint16_t timer_read(void) { return fake_time; }
+uint16_t timer_elapsed(uint16_t last) { return TIMER_DIFF_16(fake_time, last); }
+}
+
+struct KeyTrace {
+    uint8_t row;
+    uint8_t col;
+    /* one character per scan, '1' while the switch is closed */
+    std::string raw;
+};
+
+class Debounce : public testing::Test {
+public:
+    Debounce() {
+        fake_time = 0;
+        memset(raw, 0, sizeof(raw));
+        memset(cooked, 0, sizeof(cooked));
+        debounce_init(MATRIX_ROWS);
+    }
+
+    /* Scans once per ms for as long as the longest trace, the shorter ones
+     * hold their last state. Returns what the debounced matrix showed for
+     * each key at each scan, in the same form as the traces.
+     */
+    std::vector<std::string> run(const std::vector<KeyTrace>& keys) {
+        size_t length = 0;
+        for (const KeyTrace& key : keys) {
+            length = std::max(length, key.raw.size());
+        }
+        std::vector<std::string> result(keys.size());
+        for (size_t t = 0; t < length; t++) {
+            fake_time++;
+            matrix_row_t previous[MATRIX_ROWS];
+            memcpy(previous, raw, sizeof(raw));
+            for (const KeyTrace& key : keys) {
+                char state = t < key.raw.size() ? key.raw[t] : key.raw.back();
+                matrix_row_t bit = (matrix_row_t)1 << key.col;
+                raw[key.row] = state == '1' ? raw[key.row] | bit : raw[key.row] & ~bit;
+            }
+            debounce(raw, cooked, MATRIX_ROWS, memcmp(previous, raw, sizeof(raw)) != 0);
+            for (size_t i = 0; i < keys.size(); i++) {
+                result[i] += cooked[keys[i].row] & ((matrix_row_t)1 << keys[i].col) ? '1' : '0';
+            }
+        }
+        return result;
+    }
+
+    std::string run(uint8_t row, uint8_t col, const std::string& trace) {
+        return run({ { row, col, trace } })[0];
+    }
+
+    matrix_row_t raw[MATRIX_ROWS];
+    matrix_row_t cooked[MATRIX_ROWS];
+};
+
+TEST_F(Debounce, goes_idle_once_the_matrix_settles) {
+    run(0, 0, "1111111111111111");
+    EXPECT_FALSE(debounce_active());
+    run(0, 0, "0000000000000000");
+    EXPECT_FALSE(debounce_active());
+    EXPECT_EQ(cooked[0], 0);
+}
+
+#if defined(DEBOUNCE_TEST_SYM_G)
+TEST_F(Debounce, reports_a_press_after_the_delay) {
+    EXPECT_EQ(run(0, 0, "1111111111"),
+                        "0000001111");
+}
+
+TEST_F(Debounce, waits_for_the_bouncing_to_stop) {
+    EXPECT_EQ(run(0, 0, "1010111111111"),
+                        "0000000000111");
+    EXPECT_EQ(run(0, 0, "0101000000000"),
+                        "1111111111000");
+}
+
+TEST_F(Debounce, delays_every_key_while_any_key_changes) {
+    std::vector<std::string> cooked = run({
+        { 0, 0, "1111111111111" },
+        { 2, 5, "0001111111111" },
+    });
+    EXPECT_EQ(cooked[0], "0000000001111");
+    EXPECT_EQ(cooked[1], "0000000001111");
+}
+#elif defined(DEBOUNCE_TEST_EAGER_PR)
+TEST_F(Debounce, reports_a_press_at_once) {
+    EXPECT_EQ(run(0, 0, "1111111111"),
+                        "1111111111");
+}
+
+TEST_F(Debounce, ignores_bounces_while_the_row_is_locked) {
+    EXPECT_EQ(run(0, 0, "1010111111"),
+                        "1111111111");
+    EXPECT_EQ(run(0, 0, "0101000000"),
+                        "0000000000");
+}
+
+TEST_F(Debounce, takes_what_the_row_reads_when_the_lock_ends) {
+    EXPECT_EQ(run(0, 0, "1010100000"),
+                        "1111100000");
+}
+
+TEST_F(Debounce, locks_the_other_keys_of_the_row) {
+    std::vector<std::string> cooked = run({
+        { 0, 0, "1111111111" },
+        { 0, 7, "0011111111" },
+    });
+    EXPECT_EQ(cooked[0], "1111111111");
+    EXPECT_EQ(cooked[1], "0000011111");
+}
+
+TEST_F(Debounce, leaves_the_other_rows_alone) {
+    std::vector<std::string> cooked = run({
+        { 0, 0, "1111111111" },
+        { 3, 0, "0011111111" },
+    });
+    EXPECT_EQ(cooked[0], "1111111111");
+    EXPECT_EQ(cooked[1], "0011111111");
+}
+#elif defined(DEBOUNCE_TEST_ASYM_EAGER_DEFER_PK)
+TEST_F(Debounce, reports_a_press_at_once) {
+    EXPECT_EQ(run(0, 0, "1111111111"),
+                        "1111111111");
+}
+
+TEST_F(Debounce, ignores_bounces_after_a_press) {
+    EXPECT_EQ(run(0, 0, "1010111111"),
+                        "1111111111");
+}
+
+TEST_F(Debounce, reports_a_release_after_the_delay) {
+    EXPECT_EQ(run(0, 0, "11111111110000000000"),
+                        "11111111111111100000");
+}
+
+TEST_F(Debounce, restarts_the_release_delay_on_a_bounce) {
+    EXPECT_EQ(run(0, 0, "1111111111010000000000"),
+                        "1111111111111111100000");
+}
+
+TEST_F(Debounce, holds_a_press_shorter_than_the_lock) {
+    EXPECT_EQ(run(0, 0, "1100000000000"),
+                        "1111111111000");
+}
+
+TEST_F(Debounce, debounces_every_key_on_its_own) {
+    std::vector<std::string> cooked = run({
+        { 0, 0, "1111111111000000000" },
+        { 0, 1, "0010101111111111111" },
+        { 1, 0, "0000000001111111111" },
+    });
+    EXPECT_EQ(cooked[0], "1111111111111110000");
+    EXPECT_EQ(cooked[1], "0011111111111111111");
+    EXPECT_EQ(cooked[2], "0000000001111111111");
+}
+#endif
@@ -0,0 +1,22 @@
+DEBOUNCE_TEST_PATH := $(QUANTUM_PATH)/debounce/tests
+
+debounce_sym_g_SRC := \
+	$(DEBOUNCE_TEST_PATH)/debounce_tests.cpp \
+	$(QUANTUM_PATH)/debounce/sym_g.c
+debounce_sym_g_INC := $(TMK_PATH)/common
+debounce_sym_g_CONFIG := $(DEBOUNCE_TEST_PATH)/config.h
+debounce_sym_g_DEFS := -DDEBOUNCE_TEST_SYM_G
+
+debounce_eager_pr_SRC := \
+	$(DEBOUNCE_TEST_PATH)/debounce_tests.cpp \
+	$(QUANTUM_PATH)/debounce/eager_pr.c
+debounce_eager_pr_INC := $(TMK_PATH)/common
+debounce_eager_pr_CONFIG := $(DEBOUNCE_TEST_PATH)/config.h
+debounce_eager_pr_DEFS := -DDEBOUNCE_TEST_EAGER_PR
+
+debounce_asym_eager_defer_pk_SRC := \
+	$(DEBOUNCE_TEST_PATH)/debounce_tests.cpp \
+	$(QUANTUM_PATH)/debounce/asym_eager_defer_pk.c
+debounce_asym_eager_defer_pk_INC := $(TMK_PATH)/common
+debounce_asym_eager_defer_pk_CONFIG := $(DEBOUNCE_TEST_PATH)/config.h
+debounce_asym_eager_defer_pk_DEFS := -DDEBOUNCE_TEST_ASYM_EAGER_DEFER_PK
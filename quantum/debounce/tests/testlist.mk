@@ -0,0 +1,4 @@
+TEST_LIST +=\
+	debounce_sym_g\
+	debounce_eager_pr\
+	debounce_asym_eager_defer_pk
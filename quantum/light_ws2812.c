@@ -15,6 +15,35 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include "debug.h"
+#include "print.h"
+#include "timer.h"
+
+#ifdef WS2812_CHUNK_LEDS
+  #ifndef WS2812_LATCH_US
+    // Common WS2812 and WS2812B parts latch after 6-9us low, even though
+    // the datasheets ask for 50us. Only raise this for parts that are
+    // guaranteed to hold out longer, 50 for a 50us reset.
+    #define WS2812_LATCH_US 6
+  #endif
+  // Breaks are timed with Timer0 and can read up to a tick short, so a
+  // break that reads zero ticks has to be safe
+  #if WS2812_LATCH_US * (F_CPU / 1000000) <= TIMER_PRESCALER
+    #error "Timer0 ticks are too coarse to time WS2812_LATCH_US"
+  #endif
+  #ifndef WS2812_CHUNK_RETRIES
+    #define WS2812_CHUNK_RETRIES 2
+  #endif
+  #ifdef RGBW
+    #define WS2812_CHUNK_BYTES (WS2812_CHUNK_LEDS * 4)
+  #else
+    #define WS2812_CHUNK_BYTES (WS2812_CHUNK_LEDS * 3)
+  #endif
+
+// Kept by tmk_core/common/avr/timer.c
+extern volatile uint32_t timer_count;
+#endif
+
+static ws2812_stats_t stats;
 
 #ifdef RGBW_BB_TWI
 
@@ -251,17 +280,38 @@ void ws2812_sendarray(uint8_t *data,uint16_t datlen)
 #define w_nop8  w_nop4 w_nop4
 #define w_nop16 w_nop8 w_nop8
 
-void inline ws2812_sendarray_mask(uint8_t *data,uint16_t datlen,uint8_t maskhi)
+// Time it takes to send the bytes, every byte takes the same
+static uint16_t ws2812_bytes_us(uint16_t bytes)
 {
-  uint8_t curbyte,ctr,masklo;
-  uint8_t sreg_prev;
+  return ((uint32_t)bytes * 8 * w_totalcycles + F_CPU / 2000000) / (F_CPU / 1000000);
+}
 
-  // masklo  =~maskhi&ws2812_PORTREG;
-  // maskhi |=        ws2812_PORTREG;
-  masklo  =~maskhi&_SFR_IO8((RGB_DI_PIN >> 4) + 2);
-  maskhi |=        _SFR_IO8((RGB_DI_PIN >> 4) + 2);
-  sreg_prev=SREG;
-  cli();
+#ifdef WS2812_CHUNK_LEDS
+// The low byte of the millisecond count and Timer0, the interrupts have
+// to be off. A timer interrupt that is pending is counted as if it had run.
+static uint16_t ws2812_timestamp(void)
+{
+  uint8_t raw = TIMER_RAW;
+  uint8_t count = *(volatile uint8_t *)&timer_count;
+  if ((TIFR0 & _BV(OCF0A)) && raw < TIMER_RAW_TOP / 2) {
+    count++;
+  }
+  return ((uint16_t)count << 8) | raw;
+}
+
+// CPU cycles since the timestamp, with the resolution of Timer0
+static uint32_t ws2812_cycles_since(uint16_t timestamp)
+{
+  uint16_t now = ws2812_timestamp();
+  uint8_t ms = (now >> 8) - (timestamp >> 8);
+  int16_t ticks = (int16_t)(now & 0xFF) - (int16_t)(timestamp & 0xFF);
+  return ((uint32_t)ms * (TIMER_RAW_TOP + 1) + ticks) * TIMER_PRESCALER;
+}
+#endif
+
+static void ws2812_send_bytes(uint8_t *data,uint16_t datlen,uint8_t maskhi,uint8_t masklo)
+{
+  uint8_t curbyte,ctr;
 
   while (datlen--) {
     curbyte=(*data++);
@@ -326,6 +376,84 @@ w_nop16
     :	"r" (curbyte), "I" (_SFR_IO_ADDR(_SFR_IO8((RGB_DI_PIN >> 4) + 2))), "r" (maskhi), "r" (masklo)
     );
   }
+}
+
+void inline ws2812_sendarray_mask(uint8_t *data,uint16_t datlen,uint8_t maskhi)
+{
+  uint8_t masklo;
+  uint8_t sreg_prev;
+  uint16_t irq_off_us;
+
+  // masklo  =~maskhi&ws2812_PORTREG;
+  // maskhi |=        ws2812_PORTREG;
+  masklo  =~maskhi&_SFR_IO8((RGB_DI_PIN >> 4) + 2);
+  maskhi |=        _SFR_IO8((RGB_DI_PIN >> 4) + 2);
+  sreg_prev=SREG;
+  cli();
+
+#ifdef WS2812_CHUNK_LEDS
+  uint8_t *first = data;
+  uint16_t total = datlen;
+  uint16_t chunk, off_us = 0, before;
+  uint8_t restarts = 0;
+
+  irq_off_us = 0;
+  while (datlen) {
+    chunk = datlen < WS2812_CHUNK_BYTES ? datlen : WS2812_CHUNK_BYTES;
+    ws2812_send_bytes(data, chunk, maskhi, masklo);
+    data += chunk;
+    datlen -= chunk;
+    off_us += ws2812_bytes_us(chunk);
+    if (datlen == 0 || restarts == WS2812_CHUNK_RETRIES) {
+      // Out of retries, the rest goes without a break
+      continue;
+    }
+    if (off_us > irq_off_us) {
+      irq_off_us = off_us;
+    }
+    off_us = 0;
+
+    // The data line stays low, the interrupts that came in run now
+    before = ws2812_timestamp();
+    SREG = sreg_prev;
+    asm volatile("nop");
+    cli();
+    // The break may have been up to a tick longer than it reads
+    if (ws2812_cycles_since(before) + TIMER_PRESCALER >= (uint32_t)WS2812_LATCH_US * (F_CPU / 1000000)) {
+      // The strip has latched, and takes the next byte for the first LED
+      data = first;
+      datlen = total;
+      restarts++;
+      stats.restarts++;
+    }
+  }
+  if (off_us > irq_off_us) {
+    irq_off_us = off_us;
+  }
+#else
+  ws2812_send_bytes(data, datlen, maskhi, masklo);
+  irq_off_us = ws2812_bytes_us(datlen);
+#endif
 
   SREG=sreg_prev;
+
+  stats.frames++;
+  stats.last_irq_off_us = irq_off_us;
+  if (irq_off_us > stats.max_irq_off_us) {
+    stats.max_irq_off_us = irq_off_us;
+  }
+}
+
+ws2812_stats_t ws2812_stats(void)
+{
+  return stats;
+}
+
+void ws2812_print_stats(void)
+{
+  print("ws2812: frames "); print_dec(stats.frames);
+  print(" restarts "); print_dec(stats.restarts);
+  print(" irq off "); print_dec(stats.last_irq_off_us);
+  print(" us max "); print_dec(stats.max_irq_off_us);
+  print(" us\n");
 }
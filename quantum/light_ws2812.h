@@ -13,8 +13,11 @@
 #ifndef LIGHT_WS2812_H_
 #define LIGHT_WS2812_H_
 
+#include <stdint.h>
+#if defined(__AVR__)
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#endif
 //#include "ws2812_config.h"
 //#include "i2cmaster.h"
 
@@ -64,6 +67,29 @@ void ws2812_setleds_rgbw(LED_TYPE *ledarray, uint16_t number_of_leds);
 void ws2812_sendarray     (uint8_t *array,uint16_t length);
 void ws2812_sendarray_mask(uint8_t *array,uint16_t length, uint8_t pinmask);
 
+/*
+ * Interrupt statistics
+ *
+ * The AVR driver bit bangs with the interrupts off. With WS2812_CHUNK_LEDS
+ * defined it only sends that many LEDs at a time, and lets the interrupts
+ * run in between. When they might have run longer than WS2812_LATCH_US,
+ * 6us unless the parts are known to hold out longer, the strip may have
+ * latched, and the frame is sent again from the first LED, at most
+ * WS2812_CHUNK_RETRIES times. The ChibiOS driver sends from DMA, and
+ * never turns the interrupts off.
+ */
+
+typedef struct {
+  uint16_t frames;
+  uint16_t restarts;
+  // Longest stretch with the interrupts off in the last frame, and in any frame
+  uint16_t last_irq_off_us;
+  uint16_t max_irq_off_us;
+} ws2812_stats_t;
+
+ws2812_stats_t ws2812_stats(void);
+void ws2812_print_stats(void);
+
 
 /*
  * Internal defines
@@ -26,17 +26,45 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "matrix.h"
 #include "timer.h"
+#include "debounce.h"
+#ifdef MATRIX_SETTLE_CALIBRATION
+#include "eeconfig.h"
+#endif
 
+/* Time in us for a selected line to settle before the sense ports are read.
+ *
+ * MATRIX_SELECT_PIPELINE selects the next line as soon as the current one is
+ * read, so decoding overlaps with the next settle time and MATRIX_IO_DELAY can
+ * be lowered accordingly.
+ *
+ * MATRIX_SETTLE_CALIBRATION measures how fast the select and sense lines are
+ * pulled back up on the first boot and stores the settle time in eeconfig.
+ * The measurement can't see a select line loaded by held keys, so it only ever
+ * raises the settle time above MATRIX_IO_DELAY, which stays the verified safe
+ * floor, up to MATRIX_SETTLE_MAX for boards with slow lines.
+ */
+#ifndef MATRIX_IO_DELAY
+#   define MATRIX_IO_DELAY 30
+#endif
 
-/* Set 0 if debouncing isn't needed */
-
-#ifndef DEBOUNCING_DELAY
-#   define DEBOUNCING_DELAY 5
+#ifdef MATRIX_SETTLE_CALIBRATION
+#ifndef MATRIX_SETTLE_MAX
+#   define MATRIX_SETTLE_MAX 100
 #endif
+#if MATRIX_SETTLE_MAX < MATRIX_IO_DELAY || MATRIX_SETTLE_MAX > 255
+#   error "MATRIX_SETTLE_MAX must be between MATRIX_IO_DELAY and 255"
+#endif
+
+static uint8_t matrix_io_delay_us = MATRIX_IO_DELAY;
 
-#if (DEBOUNCING_DELAY > 0)
-    static uint16_t debouncing_time;
-    static bool debouncing = false;
+static void matrix_io_delay(void)
+{
+    for (uint8_t i = matrix_io_delay_us; i; i--) {
+        wait_us(1);
+    }
+}
+#else
+#   define matrix_io_delay() wait_us(MATRIX_IO_DELAY)
 #endif
 
 #if (MATRIX_COLS <= 8)
@@ -66,9 +94,36 @@ static const uint8_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
 
-static matrix_row_t matrix_raw[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
+static matrix_row_t raw_matrix[MATRIX_ROWS];
 
+/* Sense lines (cols for COL2ROW, rows for ROW2COL) are grouped by port, so a
+ * select costs one PINx read per port instead of one per line. The groups
+ * are built from the pin tables in matrix_init.
+ */
+#define MAX_SENSE_PORTS 6 // PINA - PINF
+
+#if (DIODE_DIRECTION == COL2ROW)
+#   define SENSE_LINES MATRIX_COLS
+#   define sense_pins col_pins
+#   define SELECT_LINES MATRIX_ROWS
+#   define select_pins row_pins
+#else
+#   define SENSE_LINES MATRIX_ROWS
+#   define sense_pins row_pins
+#   define SELECT_LINES MATRIX_COLS
+#   define select_pins col_pins
+#endif
+
+static uint8_t sense_port_count;
+static uint8_t sense_ports[MAX_SENSE_PORTS];
+static uint8_t sense_slot[SENSE_LINES];
+static uint8_t sense_mask[SENSE_LINES];
+
+static void init_sense_ports(void);
+static void read_sense_ports(uint8_t port_state[]);
+#ifdef MATRIX_SETTLE_CALIBRATION
+static void calibrate_io_delay(void);
+#endif
 
 #if (DIODE_DIRECTION == COL2ROW)
     static void init_cols(void);
@@ -155,6 +210,7 @@ void matrix_init(void) {
     #endif
 
     // initialize row and col
+    init_sense_ports();
 #if (DIODE_DIRECTION == COL2ROW)
     unselect_rows();
     init_cols();
@@ -162,64 +218,44 @@ void matrix_init(void) {
     unselect_cols();
     init_rows();
 #endif
+#ifdef MATRIX_SETTLE_CALIBRATION
+    calibrate_io_delay();
+#endif
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) {
         matrix[i] = 0;
-        matrix_raw[i] = 0;
-        matrix_debouncing[i] = 0;
+        raw_matrix[i] = 0;
     }
 
+    debounce_init(MATRIX_ROWS);
+
     matrix_init_quantum();
 }
 
 uint8_t matrix_scan(void)
 {
+    bool changed = false;
 
 #if (DIODE_DIRECTION == COL2ROW)
-
     // Set row, read cols
+#ifdef MATRIX_SELECT_PIPELINE
+    select_row(0);
+#endif
     for (uint8_t current_row = 0; current_row < MATRIX_ROWS; current_row++) {
-#       if (DEBOUNCING_DELAY > 0)
-            bool matrix_changed = read_cols_on_row(matrix_debouncing, current_row);
-
-            if (matrix_changed) {
-                debouncing = true;
-                debouncing_time = timer_read();
-            }
-
-#       else
-            read_cols_on_row(matrix, current_row);
-#       endif
-
+        changed |= read_cols_on_row(raw_matrix, current_row);
     }
-
 #else // ROW2COL
-
     // Set col, read rows
+#ifdef MATRIX_SELECT_PIPELINE
+    select_col(0);
+#endif
     for (uint8_t current_col = 0; current_col < MATRIX_COLS; current_col++) {
-#       if (DEBOUNCING_DELAY > 0)
-            bool matrix_changed = read_rows_on_col(matrix_debouncing, current_col);
-            if (matrix_changed) {
-                debouncing = true;
-                debouncing_time = timer_read();
-            }
-#       else
-             read_rows_on_col(matrix, current_col);
-#       endif
-
+        changed |= read_rows_on_col(raw_matrix, current_col);
     }
-
 #endif
 
-#   if (DEBOUNCING_DELAY > 0)
-        if (debouncing && (timer_elapsed(debouncing_time) > DEBOUNCING_DELAY)) {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-            debouncing = false;
-        }
-#   endif
+    debounce(raw_matrix, matrix, MATRIX_ROWS, changed);
 
     matrix_scan_quantum();
     return 1;
@@ -227,9 +263,7 @@ uint8_t matrix_scan(void)
 
 bool matrix_is_modified(void)
 {
-#if (DEBOUNCING_DELAY > 0)
-    if (debouncing) return false;
-#endif
+    if (debounce_active()) return false;
     return true;
 }
 
@@ -272,6 +306,80 @@ uint8_t matrix_key_count(void)
 }
 
 
+static void init_sense_ports(void)
+{
+    sense_port_count = 0;
+    for (uint8_t x = 0; x < SENSE_LINES; x++) {
+        uint8_t port = sense_pins[x] >> 4;
+        uint8_t slot = 0;
+        while (slot < sense_port_count && sense_ports[slot] != port) {
+            slot++;
+        }
+        if (slot == sense_port_count) {
+            sense_ports[sense_port_count++] = port;
+        }
+        sense_slot[x] = slot;
+        sense_mask[x] = _BV(sense_pins[x] & 0xF);
+    }
+}
+
+// Read every sense port once, a set bit means the line is pulled low
+static void read_sense_ports(uint8_t port_state[])
+{
+    for (uint8_t slot = 0; slot < sense_port_count; slot++) {
+        port_state[slot] = ~_SFR_IO8(sense_ports[slot]);
+    }
+}
+
+#ifdef MATRIX_SETTLE_CALIBRATION
+
+/* A line that was pulled low needs time to get back up through the weak
+ * internal pull-up. Reading the next line before that shows up as a ghost
+ * key. Both kinds of line are driven low and released here, which is all
+ * that can be done without keys held down.
+ */
+static uint8_t measure_rise_time(const uint8_t pins[], uint8_t count)
+{
+    uint8_t worst = 0;
+    for (uint8_t x = 0; x < count; x++) {
+        uint8_t pin = pins[x];
+        for (uint8_t i = 0; i < 4; i++) {
+            _SFR_IO8((pin >> 4) + 2) &= ~_BV(pin & 0xF); // LOW
+            _SFR_IO8((pin >> 4) + 1) |=  _BV(pin & 0xF); // OUT
+            wait_us(1);
+            _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF); // IN
+            _SFR_IO8((pin >> 4) + 2) |=  _BV(pin & 0xF); // HI
+
+            uint8_t rise_time = 0;
+            while (!(_SFR_IO8(pin >> 4) & _BV(pin & 0xF)) && rise_time < MATRIX_SETTLE_MAX) {
+                wait_us(1);
+                rise_time++;
+            }
+            if (rise_time > worst) {
+                worst = rise_time;
+            }
+        }
+    }
+    return worst;
+}
+
+static void calibrate_io_delay(void)
+{
+    uint8_t settle = eeconfig_read_matrix_settle();
+    if (settle < MATRIX_IO_DELAY || settle > MATRIX_SETTLE_MAX) {
+        uint8_t sense = measure_rise_time(sense_pins, SENSE_LINES);
+        uint8_t select = measure_rise_time(select_pins, SELECT_LINES);
+        // Twice the slowest rise time for margin, never below the safe floor
+        uint16_t measured = (uint16_t)(sense > select ? sense : select) * 2 + 1;
+        settle = measured < MATRIX_IO_DELAY ? MATRIX_IO_DELAY
+               : measured > MATRIX_SETTLE_MAX ? MATRIX_SETTLE_MAX : measured;
+        eeconfig_update_matrix_settle(settle);
+    }
+    matrix_io_delay_us = settle;
+    dprintf("matrix settle time: %dus\n", settle);
+}
+
+#endif
 
 #if (DIODE_DIRECTION == COL2ROW)
 
@@ -288,29 +396,37 @@ static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row)
 {
     // Store last value of row prior to reading
     matrix_row_t last_row_value = current_matrix[current_row];
-
-    // Clear data in matrix row
-    current_matrix[current_row] = 0;
+    matrix_row_t row_value = 0;
+    uint8_t port_state[MAX_SENSE_PORTS];
 
     // Select row and wait for row selecton to stabilize
+#ifndef MATRIX_SELECT_PIPELINE
     select_row(current_row);
-    wait_us(30);
-
-    // For each col...
-    for(uint8_t col_index = 0; col_index < MATRIX_COLS; col_index++) {
+#endif
+    matrix_io_delay();
 
-        // Select the col pin to read (active low)
-        uint8_t pin = col_pins[col_index];
-        uint8_t pin_state = (_SFR_IO8(pin >> 4) & _BV(pin & 0xF));
-
-        // Populate the matrix row with the state of the col pin
-        current_matrix[current_row] |=  pin_state ? 0 : (ROW_SHIFTER << col_index);
-    }
+    // Read all col ports at once (active low)
+    read_sense_ports(port_state);
 
     // Unselect row
     unselect_row(current_row);
+#ifdef MATRIX_SELECT_PIPELINE
+    // Next row settles while this one is decoded
+    if (current_row + 1 < MATRIX_ROWS) {
+        select_row(current_row + 1);
+    }
+#endif
 
-    return (last_row_value != current_matrix[current_row]);
+    // Populate the matrix row with the state of the col pins
+    matrix_row_t col_bit = ROW_SHIFTER;
+    for(uint8_t col_index = 0; col_index < MATRIX_COLS; col_index++, col_bit <<= 1) {
+        if (port_state[sense_slot[col_index]] & sense_mask[col_index]) {
+            row_value |= col_bit;
+        }
+    }
+    current_matrix[current_row] = row_value;
+
+    return (last_row_value != row_value);
 }
 
 static void select_row(uint8_t row)
@@ -350,10 +466,25 @@ static void init_rows(void)
 static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col)
 {
     bool matrix_changed = false;
+    uint8_t port_state[MAX_SENSE_PORTS];
 
     // Select col and wait for col selecton to stabilize
+#ifndef MATRIX_SELECT_PIPELINE
     select_col(current_col);
-    wait_us(30);
+#endif
+    matrix_io_delay();
+
+    // Read all row ports at once (active low)
+    read_sense_ports(port_state);
+
+    // Unselect col
+    unselect_col(current_col);
+#ifdef MATRIX_SELECT_PIPELINE
+    // Next col settles while this one is decoded
+    if (current_col + 1 < MATRIX_COLS) {
+        select_col(current_col + 1);
+    }
+#endif
 
     // For each row...
     for(uint8_t row_index = 0; row_index < MATRIX_ROWS; row_index++)
@@ -363,7 +494,7 @@ static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col)
         matrix_row_t last_row_value = current_matrix[row_index];
 
         // Check row pin state
-        if ((_SFR_IO8(row_pins[row_index] >> 4) & _BV(row_pins[row_index] & 0xF)) == 0)
+        if (port_state[sense_slot[row_index]] & sense_mask[row_index])
         {
             // Pin LO, set col bit
             current_matrix[row_index] |= (ROW_SHIFTER << current_col);
@@ -381,9 +512,6 @@ static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col)
         }
     }
 
-    // Unselect col
-    unselect_col(current_col);
-
     return matrix_changed;
 }
 
@@ -1,6 +1,6 @@
-#include <avr/eeprom.h>
-#include <avr/interrupt.h>
-#include <util/delay.h>
+#include <string.h>
+#include "eeprom.h"
+#include "wait.h"
 #include "progmem.h"
 #include "timer.h"
 #include "rgblight.h"
@@ -56,6 +56,17 @@ const uint8_t RGBLED_BREATHING_TABLE[] PROGMEM = {
   10, 9, 7, 6, 5, 5, 4, 3, 2, 2, 1, 1, 1, 0, 0, 0
 };
 
+// HUE_FRACTION[h] is h / 60 as a 0.16 fixed point number, rounded up. For
+// every 8-bit x, (x * HUE_FRACTION[h]) >> 16 is exactly x * h / 60.
+const uint16_t HUE_FRACTION[] PROGMEM = {
+  0, 1093, 2185, 3277, 4370, 5462, 6554, 7646, 8739, 9831,
+  10923, 12015, 13108, 14200, 15292, 16384, 17477, 18569, 19661, 20754,
+  21846, 22938, 24030, 25123, 26215, 27307, 28399, 29492, 30584, 31676,
+  32768, 33861, 34953, 36045, 37138, 38230, 39322, 40414, 41507, 42599,
+  43691, 44783, 45876, 46968, 48060, 49152, 50245, 51337, 52429, 53522,
+  54614, 55706, 56798, 57891, 58983, 60075, 61167, 62260, 63352, 64444,
+};
+
 __attribute__ ((weak))
 const uint8_t RGBLED_BREATHING_INTERVALS[] PROGMEM = {30, 20, 10, 5};
 __attribute__ ((weak))
@@ -74,8 +85,16 @@ LED_TYPE led[RGBLED_NUM];
 uint8_t rgblight_inited = 0;
 bool rgblight_timer_enabled = false;
 
+#ifdef RGBLIGHT_FRAME_CACHE
+// The frame last sent to the strip, rgblight_set() doesn't send it again.
+// It costs 3 bytes of RAM per LED, so boards opt in.
+static LED_TYPE sent_led[RGBLED_NUM];
+static bool sent_led_valid = false;
+#endif
+
 void sethsv(uint16_t hue, uint8_t sat, uint8_t val, LED_TYPE *led1) {
   uint8_t r = 0, g = 0, b = 0, base, color;
+  uint8_t sector = 0;
 
   if (sat == 0) { // Acromatic color (gray). Hue doesn't mind.
     r = val;
@@ -83,9 +102,15 @@ void sethsv(uint16_t hue, uint8_t sat, uint8_t val, LED_TYPE *led1) {
     b = val;
   } else {
     base = ((255 - sat) * val) >> 8;
-    color = (val - base) * (hue % 60) / 60;
+    // The hue has 9 bits, so this takes at most 8 rounds, and is a lot
+    // cheaper than dividing by 60 on the AVR
+    while (hue >= 60) {
+      hue -= 60;
+      sector++;
+    }
+    color = ((uint32_t)(val - base) * pgm_read_word(&HUE_FRACTION[hue])) >> 16;
 
-    switch (hue / 60) {
+    switch (sector) {
       case 0:
         r = val;
         g = base + color;
@@ -261,7 +286,7 @@ void rgblight_toggle(void) {
     #ifdef RGBLIGHT_ANIMATIONS
       rgblight_timer_disable();
     #endif
-    _delay_ms(50);
+    wait_ms(50);
     rgblight_set();
   }
 }
@@ -372,24 +397,27 @@ void rgblight_setrgb(uint8_t r, uint8_t g, uint8_t b) {
 
 __attribute__ ((weak))
 void rgblight_set(void) {
-  if (rgblight_config.enable) {
-    #ifdef RGBW
-      ws2812_setleds_rgbw(led, RGBLED_NUM);
-    #else
-      ws2812_setleds(led, RGBLED_NUM);
-    #endif
-  } else {
+  if (!rgblight_config.enable) {
     for (uint8_t i = 0; i < RGBLED_NUM; i++) {
       led[i].r = 0;
       led[i].g = 0;
       led[i].b = 0;
     }
-    #ifdef RGBW
-      ws2812_setleds_rgbw(led, RGBLED_NUM);
-    #else
-      ws2812_setleds(led, RGBLED_NUM);
-    #endif
   }
+  #ifdef RGBLIGHT_FRAME_CACHE
+    // Breathing and the rainbow mood often produce the same frame a few
+    // times in a row, and sending it blocks the interrupts for a while
+    if (sent_led_valid && memcmp(sent_led, led, sizeof(led)) == 0) {
+      return;
+    }
+    memcpy(sent_led, led, sizeof(led));
+    sent_led_valid = true;
+  #endif
+  #ifdef RGBW
+    ws2812_setleds_rgbw(led, RGBLED_NUM);
+  #else
+    ws2812_setleds(led, RGBLED_NUM);
+  #endif
 }
 
 #ifdef RGBLIGHT_ANIMATIONS
@@ -490,9 +518,15 @@ void rgblight_effect_rainbow_swirl(uint8_t interval) {
     return;
   }
   last_timer = timer_read();
+  // The hue of LED i is (360 / RGBLED_NUM * i + current_hue) % 360, which
+  // never wraps more than once from one LED to the next
+  hue = current_hue;
   for (i = 0; i < RGBLED_NUM; i++) {
-    hue = (360 / RGBLED_NUM * i + current_hue) % 360;
     sethsv(hue, rgblight_config.sat, rgblight_config.val, (LED_TYPE *)&led[i]);
+    hue += 360 / RGBLED_NUM;
+    if (hue >= 360) {
+      hue -= 360;
+    }
   }
   rgblight_set();
 
@@ -510,7 +544,7 @@ void rgblight_effect_snake(uint8_t interval) {
   static uint8_t pos = 0;
   static uint16_t last_timer = 0;
   uint8_t i, j;
-  int8_t k;
+  int16_t k;
   int8_t increment = 1;
   if (interval % 2) {
     increment = -1;
@@ -523,14 +557,14 @@ void rgblight_effect_snake(uint8_t interval) {
     led[i].r = 0;
     led[i].g = 0;
     led[i].b = 0;
-    for (j = 0; j < RGBLIGHT_EFFECT_SNAKE_LENGTH; j++) {
-      k = pos + j * increment;
-      if (k < 0) {
-        k = k + RGBLED_NUM;
-      }
-      if (i == k) {
-        sethsv(rgblight_config.hue, rgblight_config.sat, (uint8_t)(rgblight_config.val*(RGBLIGHT_EFFECT_SNAKE_LENGTH-j)/RGBLIGHT_EFFECT_SNAKE_LENGTH), (LED_TYPE *)&led[i]);
-      }
+  }
+  for (j = 0; j < RGBLIGHT_EFFECT_SNAKE_LENGTH; j++) {
+    k = pos + j * increment;
+    if (k < 0) {
+      k = k + RGBLED_NUM;
+    }
+    if (k >= 0 && k < RGBLED_NUM) {
+      sethsv(rgblight_config.hue, rgblight_config.sat, (uint8_t)(rgblight_config.val*(RGBLIGHT_EFFECT_SNAKE_LENGTH-j)/RGBLIGHT_EFFECT_SNAKE_LENGTH), (LED_TYPE *)&led[k]);
     }
   }
   rgblight_set();
@@ -545,40 +579,38 @@ void rgblight_effect_snake(uint8_t interval) {
   }
 }
 void rgblight_effect_knight(uint8_t interval) {
-  static int8_t pos = 0;
+  static int16_t pos = 0;
   static uint16_t last_timer = 0;
-  uint8_t i, j, cur;
-  int8_t k;
-  LED_TYPE preled[RGBLED_NUM];
+  uint8_t i, j;
+  int16_t k;
+  LED_TYPE color;
   static int8_t increment = -1;
   if (timer_elapsed(last_timer) < pgm_read_byte(&RGBLED_KNIGHT_INTERVALS[interval])) {
     return;
   }
   last_timer = timer_read();
+  sethsv(rgblight_config.hue, rgblight_config.sat, rgblight_config.val, &color);
   for (i = 0; i < RGBLED_NUM; i++) {
-    preled[i].r = 0;
-    preled[i].g = 0;
-    preled[i].b = 0;
-    for (j = 0; j < RGBLIGHT_EFFECT_KNIGHT_LENGTH; j++) {
-      k = pos + j * increment;
-      if (k < 0) {
-        k = 0;
-      }
-      if (k >= RGBLED_NUM) {
-        k = RGBLED_NUM - 1;
-      }
-      if (i == k) {
-        sethsv(rgblight_config.hue, rgblight_config.sat, rgblight_config.val, (LED_TYPE *)&preled[i]);
-      }
-    }
+    led[i].r = 0;
+    led[i].g = 0;
+    led[i].b = 0;
   }
-  if (RGBLIGHT_EFFECT_KNIGHT_OFFSET) {
-    for (i = 0; i < RGBLED_NUM; i++) {
-      cur = (i + RGBLIGHT_EFFECT_KNIGHT_OFFSET) % RGBLED_NUM;
-      led[i].r = preled[cur].r;
-      led[i].g = preled[cur].g;
-      led[i].b = preled[cur].b;
+  for (j = 0; j < RGBLIGHT_EFFECT_KNIGHT_LENGTH; j++) {
+    k = pos + j * increment;
+    if (k < 0) {
+      k = 0;
+    }
+    if (k >= RGBLED_NUM) {
+      k = RGBLED_NUM - 1;
+    }
+    // LED i shows position (i + RGBLIGHT_EFFECT_KNIGHT_OFFSET) % RGBLED_NUM
+    k -= RGBLIGHT_EFFECT_KNIGHT_OFFSET % RGBLED_NUM;
+    if (k < 0) {
+      k += RGBLED_NUM;
     }
+    led[k].r = color.r;
+    led[k].g = color.g;
+    led[k].b = color.b;
   }
   rgblight_set();
   if (increment == 1) {
@@ -602,16 +634,20 @@ void rgblight_effect_knight(uint8_t interval) {
 void rgblight_effect_christmas(void) {
   static uint16_t current_offset = 0;
   static uint16_t last_timer = 0;
-  uint16_t hue;
-  uint8_t i;
+  LED_TYPE colors[2];
+  uint8_t i, c;
   if (timer_elapsed(last_timer) < 1000) {
     return;
   }
   last_timer = timer_read();
   current_offset = (current_offset + 1) % 2;
+  sethsv(0, rgblight_config.sat, rgblight_config.val, &colors[0]);
+  sethsv(80, rgblight_config.sat, rgblight_config.val, &colors[1]);
   for (i = 0; i < RGBLED_NUM; i++) {
-    hue = 0 + ((RGBLED_NUM * (i + current_offset)) % 2) * 80;
-    sethsv(hue, rgblight_config.sat, rgblight_config.val, (LED_TYPE *)&led[i]);
+    c = (RGBLED_NUM * (i + current_offset)) % 2;
+    led[i].r = colors[c].r;
+    led[i].g = colors[c].g;
+    led[i].b = colors[c].b;
   }
   rgblight_set();
 }
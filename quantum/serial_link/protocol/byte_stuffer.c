@@ -24,8 +24,8 @@ SOFTWARE.
 
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/frame_validator.h"
-#include "serial_link/protocol/physical.h"
 #include <stdbool.h>
+#include <string.h>
 
 // This implements the "Consistent overhead byte stuffing protocol"
 // https://en.wikipedia.org/wiki/Consistent_Overhead_Byte_Stuffing
@@ -39,6 +39,7 @@ typedef struct byte_stuffer_state {
 }byte_stuffer_state_t;
 
 static byte_stuffer_state_t states[NUM_LINKS];
+static byte_stuffer_stats_t stats[NUM_LINKS];
 
 void init_byte_stuffer_state(byte_stuffer_state_t* state) {
     state->next_zero = 0;
@@ -51,10 +52,10 @@ void init_byte_stuffer(void) {
     for (i=0;i<NUM_LINKS;i++) {
         init_byte_stuffer_state(&states[i]);
     }
+    memset(stats, 0, sizeof(stats));
 }
 
-void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
-    byte_stuffer_state_t* state = &states[link];
+static void recv_byte(uint8_t link, byte_stuffer_state_t* state, uint8_t data) {
     // Start of a new frame
     if (state->next_zero == 0) {
         state->next_zero = data;
@@ -68,11 +69,13 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
         if (state->next_zero == 0) {
             // The frame is completed
             if (state->data_pos > 0) {
+                stats[link].frames++;
                 validator_recv_frame(link, state->data, state->data_pos);
             }
         }
         else {
             // The frame is invalid, so reset
+            stats[link].invalid++;
             init_byte_stuffer_state(state);
         }
     }
@@ -80,6 +83,7 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
         if (state->data_pos == MAX_FRAME_SIZE) {
             // We exceeded our maximum frame size
             // therefore there's nothing else to do than reset to a new frame
+            stats[link].too_long++;
             state->next_zero = data;
             state->long_frame = data == 0xFF;
             state->data_pos = 0;
@@ -102,41 +106,39 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
     }
 }
 
-static void send_block(uint8_t link, uint8_t* start, uint8_t* end, uint8_t num_non_zero) {
-    send_data(link, &num_non_zero, 1);
-    if (end > start) {
-        send_data(link, start, end-start);
-    }
+void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
+    recv_byte(link, &states[link], data);
 }
 
-void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    const uint8_t zero = 0;
-    if (size > 0) {
-        uint16_t num_non_zero = 1;
-        uint8_t* end = data + size;
-        uint8_t* start = data;
-        while (data < end) {
-            if (num_non_zero == 0xFF) {
-                // There's more data after big non-zero block
-                // So send it, and start a new block
-                send_block(link, start, data, num_non_zero);
-                start = data;
-                num_non_zero = 1;
-            }
-            else {
-                if (*data == 0) {
-                    // A zero encountered, so send the block
-                    send_block(link, start, data, num_non_zero);
-                    start = data + 1;
-                    num_non_zero = 1;
-                }
-                else {
-                    num_non_zero++;
-                }
-                ++data;
-            }
+void byte_stuffer_recv(uint8_t link, const uint8_t* data, uint16_t size) {
+    byte_stuffer_state_t* state = &states[link];
+    const uint8_t* end = data + size;
+    while (data < end) {
+        // Inside a block everything up to the next zero is data, so it's
+        // copied in one go. Block ends and zeroes go through recv_byte.
+        uint16_t run = state->next_zero > 1 ? state->next_zero - 1 : 0;
+        if (run > end - data) {
+            run = end - data;
+        }
+        if (run > MAX_FRAME_SIZE - state->data_pos) {
+            run = MAX_FRAME_SIZE - state->data_pos;
+        }
+        const uint8_t* zero = run ? memchr(data, 0, run) : NULL;
+        if (zero) {
+            run = zero - data;
+        }
+        if (run) {
+            memcpy(state->data + state->data_pos, data, run);
+            state->data_pos += run;
+            state->next_zero -= run;
+            data += run;
+        }
+        else {
+            recv_byte(link, state, *data++);
         }
-        send_block(link, start, data, num_non_zero);
-        send_data(link, &zero, 1);
     }
 }
+
+byte_stuffer_stats_t byte_stuffer_get_stats(uint8_t link) {
+    return stats[link];
+}
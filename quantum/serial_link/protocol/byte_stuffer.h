@@ -30,8 +30,62 @@ SOFTWARE.
 #define MAX_FRAME_SIZE 1024
 #define NUM_LINKS 2
 
+// The worst case size of an encoded frame, including the terminating zero
+#define BYTE_STUFFER_ENCODED_SIZE(size) ((size) + (size) / 254 + 2)
+
+typedef struct byte_stuffer_stats {
+    uint32_t frames;    // frames passed on to the validator
+    uint32_t invalid;   // frames ended by an unexpected zero
+    uint32_t too_long;  // frames over MAX_FRAME_SIZE
+} byte_stuffer_stats_t;
+
 void init_byte_stuffer(void);
 void byte_stuffer_recv_byte(uint8_t link, uint8_t data);
-void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size);
+// Same as calling byte_stuffer_recv_byte for each byte, but the data
+// between block ends is copied in one go
+void byte_stuffer_recv(uint8_t link, const uint8_t* data, uint16_t size);
+byte_stuffer_stats_t byte_stuffer_get_stats(uint8_t link);
+
+// Streaming encoder, the frame is encoded one byte at a time into a buffer
+// of at least BYTE_STUFFER_ENCODED_SIZE bytes, so that other work like
+// calculating a checksum can be done in the same pass.
+typedef struct byte_stuffer_encoder {
+    uint8_t* buffer;
+    uint16_t pos;
+    uint16_t block_start;
+    uint8_t num_non_zero;
+} byte_stuffer_encoder_t;
+
+static inline void byte_stuffer_encoder_init(byte_stuffer_encoder_t* encoder, uint8_t* buffer) {
+    encoder->buffer = buffer;
+    encoder->block_start = 0;
+    encoder->pos = 1;
+    encoder->num_non_zero = 1;
+}
+
+static inline void byte_stuffer_encode_byte(byte_stuffer_encoder_t* encoder, uint8_t data) {
+    if (encoder->num_non_zero == 0xFF) {
+        // The block is full, so start a new one before this byte
+        encoder->buffer[encoder->block_start] = encoder->num_non_zero;
+        encoder->block_start = encoder->pos++;
+        encoder->num_non_zero = 1;
+    }
+    if (data == 0) {
+        encoder->buffer[encoder->block_start] = encoder->num_non_zero;
+        encoder->block_start = encoder->pos++;
+        encoder->num_non_zero = 1;
+    }
+    else {
+        encoder->buffer[encoder->pos++] = data;
+        encoder->num_non_zero++;
+    }
+}
+
+// Terminates the frame and returns the number of bytes to send
+static inline uint16_t byte_stuffer_encoder_finish(byte_stuffer_encoder_t* encoder) {
+    encoder->buffer[encoder->block_start] = encoder->num_non_zero;
+    encoder->buffer[encoder->pos++] = 0;
+    return encoder->pos;
+}
 
 #endif
@@ -0,0 +1,78 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SERIAL_LINK_CRC_H
+#define SERIAL_LINK_CRC_H
+
+#include <stdint.h>
+
+/* Frame checksums
+ *
+ * crc32 is the CRC-32 of zlib and Ethernet. The backend is picked with
+ *
+ * SERIAL_LINK_CRC_SLICES  1, 4 or 8 bytes per table step, each slice takes
+ *                         1 KB of flash. Defaults to 4.
+ * SERIAL_LINK_CRC_HW      the CRC unit of the Kinetis K20, or of STM32 parts
+ *                         that can reflect the input (CRC_CR_REV_IN). Only
+ *                         whole words go through it, the rest uses the tables.
+ *
+ * crc16 is CRC-16/CCITT-FALSE, computed without a table. The frame validator
+ * uses it for small frames when SERIAL_LINK_CRC16_LIMIT is defined.
+ *
+ * The update functions work on the running state, start from the init value
+ * and finish crc32 with crc32_finish. The byte versions let a caller fold
+ * the CRC into a loop that already walks the data.
+ */
+
+#define CRC32_INIT 0xFFFFFFFF
+#define CRC16_INIT 0xFFFF
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, uint16_t size);
+uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint16_t size);
+
+extern const uint32_t crc32_table[][256];
+
+static inline uint32_t crc32_update_byte(uint32_t crc, uint8_t data) {
+    return crc32_table[0][(uint8_t)crc ^ data] ^ (crc >> 8);
+}
+
+static inline uint16_t crc16_update_byte(uint16_t crc, uint8_t data) {
+    uint8_t x = (crc >> 8) ^ data;
+    x ^= x >> 4;
+    return (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+}
+
+static inline uint32_t crc32_finish(uint32_t crc) {
+    return crc ^ 0xFFFFFFFF;
+}
+
+static inline uint32_t crc32(const uint8_t* data, uint16_t size) {
+    return crc32_finish(crc32_update(CRC32_INIT, data, size));
+}
+
+static inline uint16_t crc16(const uint8_t* data, uint16_t size) {
+    return crc16_update(CRC16_INIT, data, size);
+}
+
+#endif
@@ -53,6 +53,13 @@ void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size){
     }
 }
 
+void route_frame_error(uint8_t link) {
+    // the lost frame could have been a delta from any of the slaves
+    if (is_master && link == DOWN_LINK) {
+        transport_recv_error();
+    }
+}
+
 void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size) {
     if (destination == 0) {
         if (!is_master) {
@@ -33,6 +33,8 @@ SOFTWARE.
 
 void router_set_master(bool master);
 void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size);
+// Called for frames that failed the CRC check
+void route_frame_error(uint8_t link);
 void router_send_frame(uint8_t destination, uint8_t* data, uint16_t size);
 
 #endif
@@ -28,7 +28,16 @@ SOFTWARE.
 #include <stdint.h>
 
 void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size);
-// The buffer pointed to by the data needs 4 additional bytes
+// Adds the CRC and byte stuffs the frame into buffer, which needs
+// BYTE_STUFFER_ENCODED_SIZE(size + 4) bytes. Returns the encoded size.
+uint16_t validator_encode_frame(uint8_t* buffer, const uint8_t* data, uint16_t size);
+// Encodes the frame and sends it with a single send_data call
 void validator_send_frame(uint8_t link, uint8_t* data, uint16_t size);
 
+typedef struct frame_validator_stats {
+    uint32_t oversized; // frames too big to send with their CRC, dropped
+} frame_validator_stats_t;
+
+frame_validator_stats_t validator_get_stats(uint8_t link);
+
 #endif
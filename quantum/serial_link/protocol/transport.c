@@ -31,8 +31,29 @@ SOFTWARE.
 static remote_object_t* remote_objects[MAX_REMOTE_OBJECTS];
 static uint32_t num_remote_objects = 0;
 
+#define DELTA_HEADER_SIZE 2
+#define DELTA_MASK_SIZE(chunks) (((chunks) + 7) / 8)
+// with room for the id and the byte the router appends
+static uint8_t delta_frame[DELTA_HEADER_SIZE + DELTA_MASK_SIZE(DELTA_MAX_CHUNKS) + DELTA_MAX_OBJECT_SIZE + 2];
+static delta_stats_t delta_stats;
+static bool resync_all_slaves;
+
 void reinitialize_serial_link_transport(void) {
     num_remote_objects = 0;
+    resync_all_slaves = false;
+    memset(&delta_stats, 0, sizeof(delta_stats));
+}
+
+static delta_sender_t* get_delta_sender(remote_object_t* obj) {
+    uint8_t* start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
+    start += NUM_SLAVES * REMOTE_OBJECT_SIZE(obj->object_size);
+    return (delta_sender_t*)start;
+}
+
+static delta_receiver_t* get_delta_receiver(remote_object_t* obj, uint8_t slave) {
+    uint8_t* start = (uint8_t*)get_delta_sender(obj) + DELTA_SENDER_SIZE(obj->object_size);
+    start += slave * DELTA_RECEIVER_SIZE(obj->object_size);
+    return (delta_receiver_t*)start;
 }
 
 void add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_objects) {
@@ -69,15 +90,99 @@ void add_remote_objects(remote_object_t** _remote_objects, uint32_t _num_remote_
                 triple_buffer_init(tb);
                 start += REMOTE_OBJECT_SIZE(obj->object_size);
             }
+            if (obj->object_type == SLAVE_TO_MASTER_DELTA) {
+                memset(get_delta_sender(obj), 0,
+                    DELTA_SENDER_SIZE(obj->object_size) +
+                    NUM_SLAVES * DELTA_RECEIVER_SIZE(obj->object_size));
+            }
         }
     }
 }
 
+static uint8_t count_chunks(const uint8_t* mask, uint8_t chunks) {
+    uint8_t count = 0;
+    uint8_t i;
+    for (i=0;i<chunks;i++) {
+        if (mask[i / 8] & (1 << (i % 8))) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static void recv_delta_frame(remote_object_t* obj, uint8_t slave, uint8_t* data, uint16_t size) {
+    uint8_t chunks = obj->object_size / obj->chunk_size;
+    uint8_t mask_size = DELTA_MASK_SIZE(chunks);
+    if (slave >= NUM_SLAVES || size < DELTA_HEADER_SIZE + mask_size) {
+        return;
+    }
+    delta_receiver_t* receiver = get_delta_receiver(obj, slave);
+    uint8_t sequence = data[0];
+    uint8_t flags = data[1];
+    uint8_t* mask = data + DELTA_HEADER_SIZE;
+    uint8_t count = count_chunks(mask, chunks);
+    if (size != DELTA_HEADER_SIZE + mask_size + count * obj->chunk_size ||
+        ((flags & DELTA_FLAG_FULL) && count != chunks)) {
+        return;
+    }
+
+    delta_stats.frames++;
+    if (flags & DELTA_FLAG_FULL) {
+        delta_stats.full_frames++;
+        receiver->synced = true;
+        receiver->resync = false;
+    }
+    else if (!receiver->synced) {
+        // still waiting for the full frame, ask again in case it got lost
+        receiver->resync = true;
+        return;
+    }
+    else if (sequence != (uint8_t)(receiver->sequence + (count ? 1 : 0))) {
+        delta_stats.gaps++;
+        receiver->synced = false;
+        receiver->resync = true;
+        return;
+    }
+    else if (count == 0) {
+        delta_stats.heartbeats++;
+        return;
+    }
+
+    uint8_t* copy = (uint8_t*)(receiver + 1);
+    uint8_t* chunk = mask + mask_size;
+    uint8_t i;
+    for (i=0;i<chunks;i++) {
+        if (mask[i / 8] & (1 << (i % 8))) {
+            memcpy(copy + i * obj->chunk_size, chunk, obj->chunk_size);
+            chunk += obj->chunk_size;
+        }
+    }
+    receiver->sequence = sequence;
+
+    uint8_t* start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
+    start += slave * REMOTE_OBJECT_SIZE(obj->object_size);
+    triple_buffer_object_t* tb = (triple_buffer_object_t*)start;
+    void* ptr = triple_buffer_begin_write_internal(obj->object_size, tb);
+    memcpy(ptr, copy, obj->object_size);
+    triple_buffer_end_write_internal(tb);
+}
+
 void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
     uint8_t id = data[size-1];
+    if (id & TRANSPORT_RESYNC_REQUEST) {
+        id &= ~TRANSPORT_RESYNC_REQUEST;
+        if (size == 1 && id < num_remote_objects &&
+            remote_objects[id]->object_type == SLAVE_TO_MASTER_DELTA) {
+            get_delta_sender(remote_objects[id])->resync = true;
+        }
+        return;
+    }
     if (id < num_remote_objects) {
         remote_object_t* obj = remote_objects[id];
-        if (obj->object_size == size - 1) {
+        if (obj->object_type == SLAVE_TO_MASTER_DELTA) {
+            recv_delta_frame(obj, from - 1, data, size - 1);
+        }
+        else if (obj->object_size == size - 1) {
             uint8_t* start;
             if (obj->object_type == MASTER_TO_ALL_SLAVES) {
                 start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);
@@ -97,11 +202,85 @@ void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
     }
 }
 
+void transport_recv_error(void) {
+    resync_all_slaves = true;
+}
+
+delta_stats_t transport_delta_stats(void) {
+    return delta_stats;
+}
+
+static void send_delta_frame(remote_object_t* obj, uint8_t id) {
+    delta_sender_t* sender = get_delta_sender(obj);
+    uint8_t* last = (uint8_t*)(sender + 1);
+    triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
+    uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
+    if (!ptr) {
+        if (!sender->resync) {
+            return;
+        }
+        // nothing new was written, resend the last value
+        ptr = last;
+    }
+
+    bool full = !sender->sent || sender->resync;
+    uint8_t chunks = obj->object_size / obj->chunk_size;
+    uint8_t mask_size = DELTA_MASK_SIZE(chunks);
+    uint8_t* mask = delta_frame + DELTA_HEADER_SIZE;
+    uint8_t* chunk = mask + mask_size;
+    memset(mask, 0, mask_size);
+    uint8_t i;
+    for (i=0;i<chunks;i++) {
+        uint16_t offset = i * obj->chunk_size;
+        if (full || memcmp(ptr + offset, last + offset, obj->chunk_size) != 0) {
+            mask[i / 8] |= 1 << (i % 8);
+            memcpy(chunk, ptr + offset, obj->chunk_size);
+            chunk += obj->chunk_size;
+        }
+    }
+    if (chunk != mask + mask_size) {
+        sender->sequence++;
+    }
+    if (ptr != last) {
+        memcpy(last, ptr, obj->object_size);
+    }
+    sender->sent = true;
+    sender->resync = false;
+
+    delta_frame[0] = sender->sequence;
+    delta_frame[1] = full ? DELTA_FLAG_FULL : 0;
+    *chunk++ = id;
+    router_send_frame(0, delta_frame, chunk - delta_frame);
+}
+
+static void send_resync_requests(remote_object_t* obj, uint8_t id) {
+    uint8_t frame[2] = { id | TRANSPORT_RESYNC_REQUEST };
+    if (resync_all_slaves) {
+        delta_stats.resync_requests++;
+        router_send_frame(0xFF, frame, 1);
+        return;
+    }
+    unsigned int j;
+    for (j=0;j<NUM_SLAVES;j++) {
+        delta_receiver_t* receiver = get_delta_receiver(obj, j);
+        if (receiver->resync) {
+            receiver->resync = false;
+            delta_stats.resync_requests++;
+            // the router addresses the slaves with one bit per hop
+            router_send_frame(1 << j, frame, 1);
+        }
+    }
+}
+
 void update_transport(void) {
     unsigned int i;
     for(i=0;i<num_remote_objects;i++) {
         remote_object_t* obj = remote_objects[i];
-        if (obj->object_type == MASTER_TO_ALL_SLAVES || obj->object_type == SLAVE_TO_MASTER) {
+        if (obj->object_type == SLAVE_TO_MASTER_DELTA) {
+            send_delta_frame(obj, i);
+            send_resync_requests(obj, i);
+        }
+        else if (obj->object_type == MASTER_TO_ALL_SLAVES || obj->object_type == SLAVE_TO_MASTER) {
             triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer;
             uint8_t* ptr = (uint8_t*)triple_buffer_read_internal(obj->object_size + LOCAL_OBJECT_EXTRA, tb);
             if (ptr) {
@@ -125,4 +304,5 @@ void update_transport(void) {
             }
         }
     }
+    resync_all_slaves = false;
 }
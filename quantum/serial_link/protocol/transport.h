@@ -34,16 +34,22 @@ SOFTWARE.
 // master -> slave = 1 local(target all), 1 remote object
 // slave -> master = 1 local(target 0), multiple remote objects
 // master -> single slave (multiple local, target id), 1 remote object
+// slave -> master delta = like slave -> master, but only the chunks that
+// changed since the last frame are sent, see SLAVE_TO_MASTER_DELTA_OBJECT
 typedef enum {
     MASTER_TO_ALL_SLAVES,
     MASTER_TO_SINGLE_SLAVE,
     SLAVE_TO_MASTER,
+    SLAVE_TO_MASTER_DELTA,
 } remote_object_type;
 
 typedef struct {
     remote_object_type object_type;
     uint16_t object_size;
-    uint8_t buffer[] __attribute__((aligned(4)));
+    uint16_t chunk_size;
+    // A zero length array, unlike a flexible one, lets the object be the
+    // first member of the structs declared by REMOTE_OBJECT_HELPER
+    uint8_t buffer[0] __attribute__((aligned(4)));
 } remote_object_t;
 
 #define REMOTE_OBJECT_SIZE(objectsize) \
@@ -142,11 +148,96 @@ typedef struct { \
         return (type*)triple_buffer_read_internal(obj->object_size, tb); \
     }
 
+/* Delta objects
+ *
+ * The object is split into chunks of chunk_size bytes, at most
+ * DELTA_MAX_CHUNKS of them. A frame carries a sequence number, a flags
+ * byte, a bit mask of the chunks that follow and the chunks themselves.
+ * The sequence number is bumped for every frame with chunks in it, so the
+ * master spots a lost frame by the gap. It then asks the slave for a full
+ * frame, and ignores deltas until that arrives. A frame without chunks
+ * keeps the sequence number and serves as heartbeat, writing the same
+ * value again is enough to send one.
+ */
+#define DELTA_MAX_CHUNKS 32
+#ifndef DELTA_MAX_OBJECT_SIZE
+#define DELTA_MAX_OBJECT_SIZE 128
+#endif
+#define DELTA_FLAG_FULL 1
+// set on the id byte of a frame that asks for a full frame of the object
+#define TRANSPORT_RESYNC_REQUEST 0x80
+
+typedef struct {
+    uint8_t sequence;
+    uint8_t sent;       // the next frame can be a delta
+    uint8_t resync;     // the master asked for a full frame
+} delta_sender_t;
+
+typedef struct {
+    uint8_t sequence;
+    uint8_t synced;     // the copy is valid, deltas can be applied
+    uint8_t resync;     // a resync request has to be sent
+} delta_receiver_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t full_frames;
+    uint32_t heartbeats;
+    uint32_t gaps;
+    uint32_t resync_requests;
+} delta_stats_t;
+
+// the last value sent, or received from each slave, follows the state
+#define DELTA_SENDER_SIZE(objectsize) (sizeof(delta_sender_t) + objectsize)
+#define DELTA_RECEIVER_SIZE(objectsize) (sizeof(delta_receiver_t) + objectsize)
+
+#define SLAVE_TO_MASTER_DELTA_OBJECT(name, type, chunk_type) \
+typedef char remote_object_##name##_size_check[ \
+    sizeof(type) <= DELTA_MAX_OBJECT_SIZE && \
+    sizeof(type) / sizeof(chunk_type) <= DELTA_MAX_CHUNKS ? 1 : -1]; \
+typedef struct { \
+    remote_object_t object; \
+    uint8_t buffer[ \
+        NUM_SLAVES * REMOTE_OBJECT_SIZE(sizeof(type)) + \
+        LOCAL_OBJECT_SIZE(sizeof(type)) + \
+        DELTA_SENDER_SIZE(sizeof(type)) + \
+        NUM_SLAVES * DELTA_RECEIVER_SIZE(sizeof(type))]; \
+} remote_object_##name##_t; \
+    remote_object_##name##_t remote_object_##name = { \
+        .object = { \
+            .object_type = SLAVE_TO_MASTER_DELTA, \
+            .object_size = sizeof(type), \
+            .chunk_size = sizeof(chunk_type), \
+        } \
+    }; \
+    type* begin_write_##name(void) { \
+        remote_object_t* obj = (remote_object_t*)&remote_object_##name; \
+        triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer; \
+        return (type*)triple_buffer_begin_write_internal(sizeof(type) + LOCAL_OBJECT_EXTRA, tb); \
+    }\
+    void end_write_##name(void) { \
+        remote_object_t* obj = (remote_object_t*)&remote_object_##name; \
+        triple_buffer_object_t* tb = (triple_buffer_object_t*)obj->buffer; \
+        triple_buffer_end_write_internal(tb); \
+        signal_data_written(); \
+    }\
+    type* read_##name(uint8_t slave) { \
+        remote_object_t* obj = (remote_object_t*)&remote_object_##name; \
+        uint8_t* start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);\
+        start+=slave * REMOTE_OBJECT_SIZE(obj->object_size); \
+        triple_buffer_object_t* tb = (triple_buffer_object_t*)start; \
+        return (type*)triple_buffer_read_internal(obj->object_size, tb); \
+    }
+
 #define REMOTE_OBJECT(name) (remote_object_t*)&remote_object_##name
 
 void add_remote_objects(remote_object_t** remote_objects, uint32_t num_remote_objects);
 void reinitialize_serial_link_transport(void);
 void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size);
 void update_transport(void);
+// Called for frames from the slaves that failed the CRC check, asks every
+// slave for full frames of the delta objects
+void transport_recv_error(void);
+delta_stats_t transport_delta_stats(void);
 
 #endif
@@ -27,52 +27,82 @@ SOFTWARE.
 #include <stdbool.h>
 #include <stddef.h>
 
-#define GET_READ_INDEX() object->state & 3
-#define GET_WRITE_INDEX() (object->state >> 2) & 3
-#define GET_SHARED_INDEX() (object->state >> 4) & 3
-#define GET_DATA_AVAILABLE() (object->state >> 6) & 1
+// With atomic byte operations (LDREXB/STREXB on Cortex-M3 and up) the state
+// is swapped with a compare and swap loop, without them, or when
+// TRIPLE_BUFFER_USE_LOCK is defined, serial_link_lock() guards it instead.
+#if defined(__GCC_ATOMIC_CHAR_LOCK_FREE) && __GCC_ATOMIC_CHAR_LOCK_FREE == 2 && \
+    !defined(TRIPLE_BUFFER_USE_LOCK)
+#define TRIPLE_BUFFER_LOCK_FREE
+#endif
 
-#define SET_READ_INDEX(i) object->state = ((object->state & ~3) | i)
-#define SET_WRITE_INDEX(i) object->state = ((object->state & ~(3 << 2)) | (i << 2))
-#define SET_SHARED_INDEX(i) object->state = ((object->state & ~(3 << 4)) | (i << 4))
-#define SET_DATA_AVAILABLE(i) object->state = ((object->state & ~(1 << 6)) | (i << 6))
+#define GET_READ_INDEX(state) ((state) & 3)
+#define GET_WRITE_INDEX(state) (((state) >> 2) & 3)
+#define GET_SHARED_INDEX(state) (((state) >> 4) & 3)
+#define GET_DATA_AVAILABLE(state) (((state) >> 6) & 1)
+
+#define MAKE_STATE(read, write, shared, available) \
+    ((read) | ((write) << 2) | ((shared) << 4) | ((available) << 6))
 
 void triple_buffer_init(triple_buffer_object_t* object) {
-    object->state = 0;
-    SET_WRITE_INDEX(0);
-    SET_READ_INDEX(1);
-    SET_SHARED_INDEX(2);
-    SET_DATA_AVAILABLE(0);
+    object->state = MAKE_STATE(1, 0, 2, 0);
 }
 
-void* triple_buffer_read_internal(uint16_t object_size, triple_buffer_object_t* object) {
+// The reader only ever moves the read index and the writer the write index,
+// so each side can compute the whole next state from the one it loaded.
+static uint8_t state_after_read(uint8_t state) {
+    if (!GET_DATA_AVAILABLE(state)) {
+        return state;
+    }
+    return MAKE_STATE(GET_SHARED_INDEX(state), GET_WRITE_INDEX(state),
+                      GET_READ_INDEX(state), 0);
+}
+
+static uint8_t state_after_write(uint8_t state) {
+    return MAKE_STATE(GET_READ_INDEX(state), GET_SHARED_INDEX(state),
+                      GET_WRITE_INDEX(state), 1);
+}
+
+// Returns the state before the update
+static uint8_t update_state(triple_buffer_object_t* object, uint8_t (*next)(uint8_t)) {
+#ifdef TRIPLE_BUFFER_LOCK_FREE
+    uint8_t old = __atomic_load_n(&object->state, __ATOMIC_ACQUIRE);
+    uint8_t new;
+    do {
+        new = next(old);
+        if (new == old) {
+            break;
+        }
+    } while (!__atomic_compare_exchange_n(&object->state, &old, new, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return old;
+#else
     serial_link_lock();
-    if (GET_DATA_AVAILABLE()) {
-        uint8_t shared_index = GET_SHARED_INDEX();
-        uint8_t read_index = GET_READ_INDEX();
-        SET_READ_INDEX(shared_index);
-        SET_SHARED_INDEX(read_index);
-        SET_DATA_AVAILABLE(false);
-        serial_link_unlock();
-        return object->buffer + object_size * shared_index;
+    uint8_t old = object->state;
+    object->state = next(old);
+    serial_link_unlock();
+    return old;
+#endif
+}
+
+void* triple_buffer_read_internal(uint16_t object_size, triple_buffer_object_t* object) {
+    uint8_t old = update_state(object, state_after_read);
+    if (GET_DATA_AVAILABLE(old)) {
+        return object->buffer + object_size * GET_SHARED_INDEX(old);
     }
     else {
-        serial_link_unlock();
         return NULL;
     }
 }
 
 void* triple_buffer_begin_write_internal(uint16_t object_size, triple_buffer_object_t* object) {
-    uint8_t write_index = GET_WRITE_INDEX();
-    return object->buffer + object_size * write_index;
+#ifdef TRIPLE_BUFFER_LOCK_FREE
+    uint8_t state = __atomic_load_n(&object->state, __ATOMIC_RELAXED);
+#else
+    uint8_t state = object->state;
+#endif
+    return object->buffer + object_size * GET_WRITE_INDEX(state);
 }
 
 void triple_buffer_end_write_internal(triple_buffer_object_t* object) {
-    serial_link_lock();
-    uint8_t shared_index = GET_SHARED_INDEX();
-    uint8_t write_index = GET_WRITE_INDEX();
-    SET_SHARED_INDEX(write_index);
-    SET_WRITE_INDEX(shared_index);
-    SET_DATA_AVAILABLE(true);
-    serial_link_unlock();
+    update_state(object, state_after_write);
 }
@@ -26,6 +26,7 @@ SOFTWARE.
 #include "serial_link/system/serial_link.h"
 #include "hal.h"
 #include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/transport.h"
 #include "serial_link/protocol/frame_router.h"
 #include "matrix.h"
@@ -66,21 +67,44 @@ static SerialConfig config = {
 
 //#define DEBUG_LINK_ERRORS
 
+static serial_link_stats_t link_stats[NUM_LINKS];
+
+// The input queue is the ring buffer the UART interrupt fills. The bytes
+// up to its end are decoded where they are, and only then given back, so
+// nothing is copied and the interrupt keeps filling the rest meanwhile.
 static uint32_t read_from_serial(SerialDriver* driver, uint8_t link) {
-    const uint32_t buffer_size = 16;
-    uint8_t buffer[buffer_size];
-    uint32_t bytes_read = sdAsynchronousRead(driver, buffer, buffer_size);
-    uint8_t* current = buffer;
-    uint8_t* end = current + bytes_read;
-    while(current < end) {
-        byte_stuffer_recv_byte(link, *current);
-        current++;
+    input_queue_t* queue = &driver->iqueue;
+    chSysLock();
+    uint8_t* start = queue->q_rdptr;
+    size_t available = qSpaceI(queue);
+    chSysUnlock();
+    if (available > (size_t)(queue->q_top - start)) {
+        available = queue->q_top - start;
+    }
+    if (available == 0) {
+        return 0;
+    }
+    byte_stuffer_recv(link, start, available);
+    chSysLock();
+    queue->q_rdptr += available;
+    if (queue->q_rdptr >= queue->q_top) {
+        queue->q_rdptr = queue->q_buffer;
     }
-    return bytes_read;
+    queue->q_counter -= available;
+    chSysUnlock();
+    link_stats[link].bytes += available;
+    return available;
 }
 
-static void print_error(char* str, eventflags_t flags, SerialDriver* driver) {
+static void count_errors(uint8_t link, eventflags_t flags, SerialDriver* driver) {
+    serial_link_stats_t* stats = &link_stats[link];
+    stats->parity += (flags & SD_PARITY_ERROR) != 0;
+    stats->framing += (flags & SD_FRAMING_ERROR) != 0;
+    stats->overrun += (flags & SD_OVERRUN_ERROR) != 0;
+    stats->noise += (flags & SD_NOISE_ERROR) != 0;
+    stats->breaks += (flags & SD_BREAK_DETECTED) != 0;
 #ifdef DEBUG_LINK_ERRORS
+    char* str = link == DOWN_LINK ? "DOWNLINK" : "UPLINK";
     if (flags & SD_PARITY_ERROR) {
         print(str);
         print(" Parity error\n");
@@ -104,12 +128,36 @@ static void print_error(char* str, eventflags_t flags, SerialDriver* driver) {
         print(" Break detected\n");
     }
 #else
-    (void)str;
-    (void)flags;
     (void)driver;
 #endif
 }
 
+serial_link_stats_t serial_link_get_stats(uint8_t link) {
+    serial_link_stats_t stats = link_stats[link];
+    byte_stuffer_stats_t frames = byte_stuffer_get_stats(link);
+    stats.frames = frames.frames;
+    stats.bad_frames = frames.invalid + frames.too_long;
+    stats.oversized_sends = validator_get_stats(link).oversized;
+    return stats;
+}
+
+void serial_link_print_stats(void) {
+    for (uint8_t link = 0; link < NUM_LINKS; link++) {
+        serial_link_stats_t stats = serial_link_get_stats(link);
+        print(link == DOWN_LINK ? "downlink:" : "uplink:");
+        print(" bytes "); print_dec(stats.bytes);
+        print(" frames "); print_dec(stats.frames);
+        print(" bad frames "); print_dec(stats.bad_frames);
+        print(" oversized sends "); print_dec(stats.oversized_sends);
+        print(" overrun "); print_dec(stats.overrun);
+        print(" framing "); print_dec(stats.framing);
+        print(" parity "); print_dec(stats.parity);
+        print(" noise "); print_dec(stats.noise);
+        print(" breaks "); print_dec(stats.breaks);
+        print("\n");
+    }
+}
+
 bool is_serial_link_master(void) {
     return is_master;
 }
@@ -140,11 +188,11 @@ static THD_FUNCTION(serialThread, arg) {
             eventmask_t mask = chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(1000));
             if (mask & EVENT_MASK(1)) {
                 flags1 = chEvtGetAndClearFlags(&sd1_listener);
-                print_error("DOWNLINK", flags1, &SD1);
+                count_errors(DOWN_LINK, flags1, &SD1);
             }
             if (mask & EVENT_MASK(2)) {
                 flags2 = chEvtGetAndClearFlags(&sd2_listener);
-                print_error("UPLINK", flags2, &SD2);
+                count_errors(UP_LINK, flags2, &SD2);
             }
         }
 
@@ -168,6 +216,12 @@ void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
     }
 }
 
+// How often the matrix is written when it doesn't change. The frame that
+// goes out then is a heartbeat, and lets the master notice lost frames.
+#ifndef SERIAL_LINK_HEARTBEAT
+#define SERIAL_LINK_HEARTBEAT 100
+#endif
+
 static systime_t last_update = 0;
 
 typedef struct {
@@ -176,7 +230,7 @@ typedef struct {
 
 static matrix_object_t last_matrix = {};
 
-SLAVE_TO_MASTER_OBJECT(keyboard_matrix, matrix_object_t);
+SLAVE_TO_MASTER_DELTA_OBJECT(keyboard_matrix, matrix_object_t, matrix_row_t);
 MASTER_TO_ALL_SLAVES_OBJECT(serial_link_connected, bool);
 
 static remote_object_t* remote_objects[] = {
@@ -210,9 +264,11 @@ void serial_link_update(void) {
         changed |= matrix.rows[i] != last_matrix.rows[i];
     }
 
+    // only the changed rows go out, the rest of the time just a heartbeat
     systime_t current_time = chVTGetSystemTimeX();
     systime_t delta = current_time - last_update;
-    if (changed || delta > US2ST(1000)) {
+    bool heartbeat = delta > MS2ST(SERIAL_LINK_HEARTBEAT);
+    if (changed || heartbeat) {
         last_update = current_time;
         last_matrix = matrix;
         matrix_object_t* m = begin_write_keyboard_matrix();
@@ -220,6 +276,8 @@ void serial_link_update(void) {
             m->rows[i] = matrix.rows[i];
         }
         end_write_keyboard_matrix();
+    }
+    if (heartbeat) {
         *begin_write_serial_link_connected() = true;
         end_write_serial_link_connected();
     }
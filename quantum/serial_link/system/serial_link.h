@@ -35,6 +35,23 @@ bool is_serial_link_master(void);
 host_driver_t* get_serial_link_driver(void);
 void serial_link_update(void);
 
+// Counted per link since the start, the UART errors as the driver reports
+// them, the received frames as the byte stuffer sees them
+typedef struct {
+    uint32_t bytes;
+    uint32_t frames;
+    uint32_t bad_frames;
+    uint32_t oversized_sends;
+    uint16_t overrun;
+    uint16_t framing;
+    uint16_t parity;
+    uint16_t noise;
+    uint16_t breaks;
+} serial_link_stats_t;
+
+serial_link_stats_t serial_link_get_stats(uint8_t link);
+void serial_link_print_stats(void);
+
 #if defined(PROTOCOL_CHIBIOS)
 #include "ch.h"
 
@@ -26,6 +26,8 @@ SOFTWARE.
 #include "gmock/gmock.h"
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 extern "C" {
 #include "serial_link/protocol/byte_stuffer.h"
 #include "serial_link/protocol/frame_validator.h"
@@ -35,6 +37,7 @@ extern "C" {
 using testing::_;
 using testing::ElementsAreArray;
 using testing::Args;
+using testing::Invoke;
 
 class ByteStuffer : public ::testing::Test{
 public:
@@ -52,6 +55,16 @@ public:
     void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
         std::copy(data, data + size, std::back_inserter(sent_data));
     }
+    // Byte stuffs a frame the way validator_send_frame does, minus the CRC
+    void send_frame(uint8_t link, const uint8_t* data, uint16_t size) {
+        uint8_t buffer[BYTE_STUFFER_ENCODED_SIZE(MAX_FRAME_SIZE)];
+        byte_stuffer_encoder_t encoder;
+        byte_stuffer_encoder_init(&encoder, buffer);
+        for (uint16_t i = 0; i < size; i++) {
+            byte_stuffer_encode_byte(&encoder, data[i]);
+        }
+        send_data(link, buffer, byte_stuffer_encoder_finish(&encoder));
+    }
     std::vector<uint8_t> sent_data;
 
     static ByteStuffer* Instance;
@@ -301,63 +314,58 @@ TEST_F(ByteStuffer, received_frame_is_aborted_when_its_too_long) {
     byte_stuffer_recv_byte(0, 0);
 }
 
-TEST_F(ByteStuffer, does_nothing_when_sending_zero_size_frame) {
-    EXPECT_EQ(sent_data.size(), 0);
-    byte_stuffer_send_frame(0, NULL, 0);
-}
-
 TEST_F(ByteStuffer, send_one_byte_frame) {
     uint8_t data[] = {5};
-    byte_stuffer_send_frame(1, data, 1);
+    send_frame(1, data, 1);
     uint8_t expected[] = {2, 5, 0};
     EXPECT_THAT(sent_data, ElementsAreArray(expected));
 }
 
 TEST_F(ByteStuffer, sends_two_byte_frame) {
     uint8_t data[] = {5, 0x77};
-    byte_stuffer_send_frame(0, data, 2);
+    send_frame(0, data, 2);
     uint8_t expected[] = {3, 5, 0x77, 0};
     EXPECT_THAT(sent_data, ElementsAreArray(expected));
 }
 
 TEST_F(ByteStuffer, sends_one_byte_frame_with_zero) {
     uint8_t data[] = {0};
-    byte_stuffer_send_frame(0, data, 1);
+    send_frame(0, data, 1);
     uint8_t expected[] = {1, 1, 0};
     EXPECT_THAT(sent_data, ElementsAreArray(expected));
 }
 
 TEST_F(ByteStuffer, sends_two_byte_frame_starting_with_zero) {
     uint8_t data[] = {0, 9};
-    byte_stuffer_send_frame(1, data, 2);
+    send_frame(1, data, 2);
     uint8_t expected[] = {1, 2, 9, 0};
     EXPECT_THAT(sent_data, ElementsAreArray(expected));
 }
 
 TEST_F(ByteStuffer, sends_two_byte_frame_starting_with_non_zero) {
     uint8_t data[] = {9, 0};
-    byte_stuffer_send_frame(1, data, 2);
+    send_frame(1, data, 2);
     uint8_t expected[] = {2, 9, 1, 0};
     EXPECT_THAT(sent_data, ElementsAreArray(expected));
 }
 
 TEST_F(ByteStuffer, sends_three_byte_frame_zero_in_the_middle) {
     uint8_t data[] = {9, 0, 0x68};
-    byte_stuffer_send_frame(0, data, 3);
+    send_frame(0, data, 3);
     uint8_t expected[] = {2, 9, 2, 0x68, 0};
     EXPECT_THAT(sent_data, ElementsAreArray(expected));
 }
 
 TEST_F(ByteStuffer, sends_three_byte_frame_data_in_the_middle) {
     uint8_t data[] = {0, 0x55, 0};
-    byte_stuffer_send_frame(0, data, 3);
+    send_frame(0, data, 3);
     uint8_t expected[] = {1, 2, 0x55, 1, 0};
     EXPECT_THAT(sent_data, ElementsAreArray(expected));
 }
 
 TEST_F(ByteStuffer, sends_three_byte_frame_with_all_zeroes) {
     uint8_t data[] = {0, 0, 0};
-    byte_stuffer_send_frame(0, data, 3);
+    send_frame(0, data, 3);
     uint8_t expected[] = {1, 1, 1, 1, 0};
     EXPECT_THAT(sent_data, ElementsAreArray(expected));
 }
@@ -368,7 +376,7 @@ TEST_F(ByteStuffer, sends_frame_with_254_non_zeroes) {
     for(i=0;i<254;i++) {
         data[i] = i + 1;
     }
-    byte_stuffer_send_frame(0, data, 254);
+    send_frame(0, data, 254);
     uint8_t expected[256];
     expected[0] = 0xFF;
     for(i=1;i<255;i++) {
@@ -384,7 +392,7 @@ TEST_F(ByteStuffer, sends_frame_with_255_non_zeroes) {
     for(i=0;i<255;i++) {
         data[i] = i + 1;
     }
-    byte_stuffer_send_frame(0, data, 255);
+    send_frame(0, data, 255);
     uint8_t expected[258];
     expected[0] = 0xFF;
     for(i=1;i<255;i++) {
@@ -403,7 +411,7 @@ TEST_F(ByteStuffer, sends_frame_with_254_non_zeroes_followed_by_zero) {
         data[i] = i + 1;
     }
     data[254] = 0;
-    byte_stuffer_send_frame(0, data, 255);
+    send_frame(0, data, 255);
     uint8_t expected[258];
     expected[0] = 0xFF;
     for(i=1;i<255;i++) {
@@ -417,7 +425,7 @@ TEST_F(ByteStuffer, sends_frame_with_254_non_zeroes_followed_by_zero) {
 
 TEST_F(ByteStuffer, sends_and_receives_full_roundtrip_small_packet) {
     uint8_t original_data[] = { 1, 2, 3};
-    byte_stuffer_send_frame(0, original_data, sizeof(original_data));
+    send_frame(0, original_data, sizeof(original_data));
     EXPECT_CALL(*this, validator_recv_frame(_, _, _))
         .With(Args<1, 2>(ElementsAreArray(original_data)));
     int i;
@@ -428,7 +436,7 @@ TEST_F(ByteStuffer, sends_and_receives_full_roundtrip_small_packet) {
 
 TEST_F(ByteStuffer, sends_and_receives_full_roundtrip_small_packet_with_zeros) {
     uint8_t original_data[] = { 1, 0, 3, 0, 0, 9};
-    byte_stuffer_send_frame(1, original_data, sizeof(original_data));
+    send_frame(1, original_data, sizeof(original_data));
     EXPECT_CALL(*this, validator_recv_frame(_, _, _))
         .With(Args<1, 2>(ElementsAreArray(original_data)));
     int i;
@@ -443,7 +451,7 @@ TEST_F(ByteStuffer, sends_and_receives_full_roundtrip_254_bytes) {
     for(i=0;i<254;i++) {
         original_data[i] = i + 1;
     }
-    byte_stuffer_send_frame(0, original_data, sizeof(original_data));
+    send_frame(0, original_data, sizeof(original_data));
     EXPECT_CALL(*this, validator_recv_frame(_, _, _))
         .With(Args<1, 2>(ElementsAreArray(original_data)));
     for(auto& d : sent_data) {
@@ -459,7 +467,7 @@ TEST_F(ByteStuffer, sends_and_receives_full_roundtrip_256_bytes) {
     }
     original_data[254] = 22;
     original_data[255] = 23;
-    byte_stuffer_send_frame(0, original_data, sizeof(original_data));
+    send_frame(0, original_data, sizeof(original_data));
     EXPECT_CALL(*this, validator_recv_frame(_, _, _))
         .With(Args<1, 2>(ElementsAreArray(original_data)));
     for(auto& d : sent_data) {
@@ -474,10 +482,109 @@ TEST_F(ByteStuffer, sends_and_receives_full_roundtrip_254_bytes_and_then_zero) {
         original_data[i] = i + 1;
     }
     original_data[254] = 0;
-    byte_stuffer_send_frame(0, original_data, sizeof(original_data));
+    send_frame(0, original_data, sizeof(original_data));
     EXPECT_CALL(*this, validator_recv_frame(_, _, _))
         .With(Args<1, 2>(ElementsAreArray(original_data)));
     for(auto& d : sent_data) {
        byte_stuffer_recv_byte(1, d);
     }
 }
+
+TEST_F(ByteStuffer, benchmark_send_and_receive_throughput) {
+    const int frames = 2000;
+    uint8_t original_data[256];
+    int i;
+    for(i=0;i<256;i++) {
+        original_data[i] = i * 7;
+    }
+    EXPECT_CALL(*this, validator_recv_frame(_, _, _))
+        .Times(frames * 2);
+
+    auto start = std::chrono::steady_clock::now();
+    for(i=0;i<frames;i++) {
+        sent_data.clear();
+        send_frame(0, original_data, sizeof(original_data));
+    }
+    auto send_time = std::chrono::steady_clock::now() - start;
+
+    std::vector<uint8_t> frame = sent_data;
+    start = std::chrono::steady_clock::now();
+    for(i=0;i<frames;i++) {
+        for(auto& d : frame) {
+           byte_stuffer_recv_byte(1, d);
+        }
+    }
+    auto recv_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for(i=0;i<frames;i++) {
+        byte_stuffer_recv(1, frame.data(), frame.size());
+    }
+    auto span_time = std::chrono::steady_clock::now() - start;
+
+    long long send_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(send_time).count();
+    long long recv_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(recv_time).count();
+    long long span_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(span_time).count();
+    printf("send: %.1f MB/s\n", (double)sizeof(original_data) * frames * 1000 / send_ns);
+    printf("recv: %.1f MB/s\n", (double)sizeof(original_data) * frames * 1000 / recv_ns);
+    printf("recv spans: %.1f MB/s\n", (double)sizeof(original_data) * frames * 1000 / span_ns);
+}
+
+TEST_F(ByteStuffer, receives_spans_like_single_bytes) {
+    std::vector<uint8_t> stream;
+    auto send = [&](const std::vector<uint8_t>& frame) {
+        sent_data.clear();
+        send_frame(0, frame.data(), frame.size());
+        stream.insert(stream.end(), sent_data.begin(), sent_data.end());
+    };
+    std::vector<uint8_t> frame(600);
+    for (size_t i = 0; i < frame.size(); i++) {
+        frame[i] = i % 5 ? i : 0;
+    }
+    send(frame);
+    send(std::vector<uint8_t>(254, 0x55));
+    send({0, 0, 0});
+    // a frame cut short by a zero
+    stream.insert(stream.end(), {5, 1, 2, 0});
+    send({7});
+    // a frame that is too long
+    stream.push_back(0xFF);
+    for (int i = 0; i < 5; i++) {
+        stream.insert(stream.end(), 254, 0x11);
+        stream.push_back(0xFF);
+    }
+    stream.insert(stream.end(), {2, 9, 0});
+    send(std::vector<uint8_t>(1000, 0xAA));
+
+    std::vector<std::vector<uint8_t>> expected;
+    EXPECT_CALL(*this, validator_recv_frame(_, _, _))
+        .WillRepeatedly(Invoke([&](uint8_t link, uint8_t* data, uint16_t size) {
+            expected.emplace_back(data, data + size);
+        }));
+    for (auto d : stream) {
+        byte_stuffer_recv_byte(0, d);
+    }
+    byte_stuffer_stats_t byte_stats = byte_stuffer_get_stats(0);
+    EXPECT_EQ(expected.size(), 5);
+    EXPECT_EQ(byte_stats.frames, 5);
+    // the rest of the long frame is taken for a new one, which is cut short
+    EXPECT_EQ(byte_stats.invalid, 2);
+    EXPECT_EQ(byte_stats.too_long, 1);
+
+    for (size_t chunk : {1, 2, 3, 16, 255, 4096}) {
+        std::vector<std::vector<uint8_t>> received;
+        EXPECT_CALL(*this, validator_recv_frame(1, _, _))
+            .WillRepeatedly(Invoke([&](uint8_t link, uint8_t* data, uint16_t size) {
+                received.emplace_back(data, data + size);
+            }));
+        init_byte_stuffer();
+        for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+            byte_stuffer_recv(1, &stream[pos], std::min(chunk, stream.size() - pos));
+        }
+        EXPECT_EQ(received, expected) << "chunk " << chunk;
+        byte_stuffer_stats_t span_stats = byte_stuffer_get_stats(1);
+        EXPECT_EQ(span_stats.frames, byte_stats.frames);
+        EXPECT_EQ(span_stats.invalid, byte_stats.invalid);
+        EXPECT_EQ(span_stats.too_long, byte_stats.too_long);
+    }
+}
@@ -0,0 +1,108 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "tests/cycles.h"
+extern "C" {
+#include "serial_link/protocol/crc.h"
+}
+
+static const uint8_t check[] = "123456789";
+
+static uint32_t reference_crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (size--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+TEST(Crc, crc32_of_the_check_string) {
+    EXPECT_EQ(crc32(check, 9), 0xCBF43926);
+}
+
+TEST(Crc, crc32_of_nothing) {
+    EXPECT_EQ(crc32(check, 0), 0);
+}
+
+TEST(Crc, crc16_of_the_check_string) {
+    EXPECT_EQ(crc16(check, 9), 0x29B1);
+}
+
+TEST(Crc, crc32_matches_the_bitwise_one_for_all_sizes_and_offsets) {
+    std::vector<uint8_t> data(80);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 37 + 11;
+    }
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t size = 0; size + offset <= data.size(); size++) {
+            ASSERT_EQ(crc32(&data[offset], size), reference_crc32(&data[offset], size))
+                << "offset " << offset << " size " << size;
+        }
+    }
+}
+
+TEST(Crc, updates_in_pieces_give_the_same_result) {
+    uint8_t data[61];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = i ^ 0xA5;
+    }
+    for (uint16_t split = 0; split <= sizeof(data); split++) {
+        uint32_t crc = crc32_update(CRC32_INIT, data, split);
+        crc = crc32_update(crc, data + split, sizeof(data) - split);
+        ASSERT_EQ(crc32_finish(crc), crc32(data, sizeof(data)));
+        uint16_t crc_16 = crc16_update(CRC16_INIT, data, split);
+        crc_16 = crc16_update(crc_16, data + split, sizeof(data) - split);
+        ASSERT_EQ(crc_16, crc16(data, sizeof(data)));
+    }
+}
+
+TEST(Crc, benchmark_bytes_per_cycle) {
+    const int rounds = 2000;
+    std::vector<uint8_t> data(1024);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i * 7;
+    }
+    for (uint16_t size : {16, 64, 1024}) {
+        volatile uint32_t sink = 0;
+        uint64_t start = read_cycles();
+        for (int i = 0; i < rounds; i++) {
+            sink = sink + crc32(data.data(), size);
+        }
+        uint64_t crc32_time = read_cycles() - start;
+        start = read_cycles();
+        for (int i = 0; i < rounds; i++) {
+            sink = sink + crc16(data.data(), size);
+        }
+        uint64_t crc16_time = read_cycles() - start;
+        printf("%4u byte frames: crc32 %.2f, crc16 %.2f bytes per 1000 %s\n", size,
+            (double)size * rounds * 1000 / crc32_time, (double)size * rounds * 1000 / crc16_time, CYCLES_UNIT);
+    }
+}
@@ -80,6 +80,7 @@ public:
     }
 
     MOCK_METHOD3(transport_recv_frame, void (uint8_t from, uint8_t* data, uint16_t size));
+    MOCK_METHOD0(transport_recv_error, void ());
 
     std::vector<uint8_t> received_data;
 
@@ -111,6 +112,10 @@ extern "C" {
     void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
         FrameRouter::Instance->transport_recv_frame(from, data, size);
     }
+
+    void transport_recv_error(void) {
+        FrameRouter::Instance->transport_recv_error();
+    }
 }
 
 TEST_F(FrameRouter, master_broadcast_is_received_by_everyone) {
@@ -227,3 +232,28 @@ TEST_F(FrameRouter, master_receives_on_uplink_does_nothing) {
     EXPECT_EQ(router_buffers[0].send_buffers[UP_LINK].size(), 0);
     EXPECT_EQ(router_buffers[0].send_buffers[DOWN_LINK].size(), 0);
 }
+
+TEST_F(FrameRouter, master_reports_broken_frames_from_the_slaves) {
+    frame_buffer_t data;
+    data.data = {0xAB, 0x70, 0x55, 0xBB};
+    activate_router(1);
+    router_send_frame(0, (uint8_t*)&data, 4);
+    router_buffers[1].send_buffers[UP_LINK][2] ^= 0x10;
+    EXPECT_CALL(*this, transport_recv_frame(_, _, _))
+        .Times(0);
+    EXPECT_CALL(*this, transport_recv_error());
+    simulate_transport(1, 0);
+}
+
+TEST_F(FrameRouter, slave_does_not_report_broken_frames) {
+    frame_buffer_t data;
+    data.data = {0xAB, 0x70, 0x55, 0xBB};
+    activate_router(0);
+    router_send_frame(0xFF, (uint8_t*)&data, 4);
+    router_buffers[0].send_buffers[DOWN_LINK][2] ^= 0x10;
+    EXPECT_CALL(*this, transport_recv_frame(_, _, _))
+        .Times(0);
+    EXPECT_CALL(*this, transport_recv_error())
+        .Times(0);
+    simulate_transport(0, 1);
+}
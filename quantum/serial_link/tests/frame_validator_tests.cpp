@@ -24,8 +24,13 @@ SOFTWARE.
 
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 extern "C" {
 #include "serial_link/protocol/frame_validator.h"
+#include "serial_link/protocol/byte_stuffer.h"
 }
 
 using testing::_;
@@ -43,7 +48,8 @@ public:
     }
 
     MOCK_METHOD3(route_incoming_frame, void (uint8_t link, uint8_t* data, uint16_t size));
-    MOCK_METHOD3(byte_stuffer_send_frame, void (uint8_t link, uint8_t* data, uint16_t size));
+    MOCK_METHOD1(route_frame_error, void (uint8_t link));
+    MOCK_METHOD3(send_data, void (uint8_t link, const uint8_t* data, uint16_t size));
 
     static FrameValidator* Instance;
 };
@@ -55,11 +61,68 @@ void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
     FrameValidator::Instance->route_incoming_frame(link, data, size);
 }
 
-void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    FrameValidator::Instance->byte_stuffer_send_frame(link, data, size);
+void route_frame_error(uint8_t link) {
+    FrameValidator::Instance->route_frame_error(link);
 }
+
+void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+    FrameValidator::Instance->send_data(link, data, size);
+}
+}
+
+#ifdef SERIAL_LINK_CRC16_LIMIT
+TEST_F(FrameValidator, doesnt_validate_frames_under_3_bytes) {
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _))
+        .Times(0);
+    uint8_t data[] = {1, 2};
+    validator_recv_frame(0, 0, 1);
+    validator_recv_frame(0, data, 2);
+}
+
+TEST_F(FrameValidator, validates_one_byte_frame_with_crc16) {
+    uint8_t data[] = {0x44, 0xB0, 0xE9};
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _))
+        .With(Args<1, 2>(ElementsAreArray(data, 1)));
+    validator_recv_frame(0, data, 3);
+}
+
+TEST_F(FrameValidator, does_not_take_crc32_for_small_frames) {
+    uint8_t data[] = {0x44, 0x04, 0x6A, 0xB3, 0xA3};
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _))
+        .Times(0);
+    EXPECT_CALL(*this, route_frame_error(0));
+    validator_recv_frame(0, data, 5);
+}
+
+TEST_F(FrameValidator, validates_large_frame_with_crc32) {
+    uint8_t data[34];
+    for (int i = 0; i < 30; i++) {
+        data[i] = i + 1;
+    }
+    uint8_t crc[] = {0x72, 0xFF, 0x75, 0x24};
+    memcpy(data + 30, crc, 4);
+    EXPECT_CALL(*this, route_incoming_frame(_, _, _))
+        .With(Args<1, 2>(ElementsAreArray(data, 30)));
+    validator_recv_frame(0, data, 34);
 }
 
+TEST_F(FrameValidator, sends_five_bytes_with_crc16) {
+    uint8_t original[] = {1, 2, 3, 4, 5};
+    uint8_t expected[] = {8, 1, 2, 3, 4, 5, 0x04, 0x93, 0};
+    EXPECT_CALL(*this, send_data(_, _, _))
+        .With(Args<1, 2>(ElementsAreArray(expected)));
+    validator_send_frame(0, original, 5);
+}
+
+TEST_F(FrameValidator, sends_large_frame_with_crc32) {
+    uint8_t original[30];
+    for (int i = 0; i < 30; i++) {
+        original[i] = i + 1;
+    }
+    EXPECT_CALL(*this, send_data(_, _, 36));
+    validator_send_frame(0, original, 30);
+}
+#else
 TEST_F(FrameValidator, doesnt_validate_frames_under_5_bytes) {
     EXPECT_CALL(*this, route_incoming_frame(_, _, _))
         .Times(0);
@@ -77,13 +140,17 @@ TEST_F(FrameValidator, validates_one_byte_frame_with_correct_crc) {
     validator_recv_frame(0, data, 5);
 }
 
+#endif
+
 TEST_F(FrameValidator, does_not_validate_one_byte_frame_with_incorrect_crc) {
     uint8_t data[] = {0x44, 0, 0, 0, 0};
     EXPECT_CALL(*this, route_incoming_frame(_, _, _))
         .Times(0);
+    EXPECT_CALL(*this, route_frame_error(1));
     validator_recv_frame(1, data, 5);
 }
 
+#ifndef SERIAL_LINK_CRC16_LIMIT
 TEST_F(FrameValidator, validates_four_byte_frame_with_correct_crc) {
     uint8_t data[] = {0x44, 0x10, 0xFF, 0x00, 0x74, 0x4E, 0x30, 0xBA};
     EXPECT_CALL(*this, route_incoming_frame(_, _, _))
@@ -99,17 +166,68 @@ TEST_F(FrameValidator, validates_five_byte_frame_with_correct_crc) {
 }
 
 TEST_F(FrameValidator, sends_one_byte_with_correct_crc) {
-    uint8_t original[] = {0x44, 0, 0, 0, 0};
-    uint8_t expected[] = {0x44, 0x04, 0x6A, 0xB3, 0xA3};
-    EXPECT_CALL(*this, byte_stuffer_send_frame(_, _, _))
+    uint8_t original[] = {0x44};
+    uint8_t expected[] = {6, 0x44, 0x04, 0x6A, 0xB3, 0xA3, 0};
+    EXPECT_CALL(*this, send_data(_, _, _))
         .With(Args<1, 2>(ElementsAreArray(expected)));
     validator_send_frame(0, original, 1);
 }
 
 TEST_F(FrameValidator, sends_five_bytes_with_correct_crc) {
-    uint8_t original[] = {1, 2, 3, 4, 5, 0, 0, 0, 0};
-    uint8_t expected[] = {1, 2, 3, 4, 5, 0xF4, 0x99, 0x0B, 0x47};
-    EXPECT_CALL(*this, byte_stuffer_send_frame(_, _, _))
+    uint8_t original[] = {1, 2, 3, 4, 5};
+    uint8_t expected[] = {10, 1, 2, 3, 4, 5, 0xF4, 0x99, 0x0B, 0x47, 0};
+    EXPECT_CALL(*this, send_data(_, _, _))
         .With(Args<1, 2>(ElementsAreArray(expected)));
     validator_send_frame(0, original, 5);
 }
+
+TEST_F(FrameValidator, sends_zeroes_with_correct_crc) {
+    uint8_t original[] = {0x44, 0x10, 0xFF, 0x00};
+    uint8_t expected[] = {4, 0x44, 0x10, 0xFF, 5, 0x74, 0x4E, 0x30, 0xBA, 0};
+    EXPECT_CALL(*this, send_data(_, _, _))
+        .With(Args<1, 2>(ElementsAreArray(expected)));
+    validator_send_frame(1, original, 4);
+}
+
+#endif
+
+TEST_F(FrameValidator, does_not_change_the_sent_data) {
+    uint8_t original[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    uint8_t expected[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_CALL(*this, send_data(_, _, _));
+    validator_send_frame(0, original, 5);
+    EXPECT_THAT(original, ElementsAreArray(expected));
+}
+
+TEST_F(FrameValidator, counts_frames_too_big_to_send) {
+    static uint8_t original[MAX_FRAME_SIZE];
+    uint32_t oversized = validator_get_stats(1).oversized;
+    EXPECT_CALL(*this, send_data(_, _, _))
+        .Times(0);
+    validator_send_frame(1, original, MAX_FRAME_SIZE - 3);
+    validator_send_frame(1, original, MAX_FRAME_SIZE);
+    EXPECT_EQ(validator_get_stats(1).oversized, oversized + 2);
+    EXPECT_EQ(validator_get_stats(0).oversized, 0);
+}
+
+TEST_F(FrameValidator, benchmark_encode_throughput) {
+    const int frames = 2000;
+    const uint16_t size = 256;
+    std::vector<uint8_t> data(size);
+    for (uint16_t i = 0; i < size; i++) {
+        data[i] = i * 7;
+    }
+    std::vector<uint8_t> buffer(BYTE_STUFFER_ENCODED_SIZE(size + 4));
+    uint32_t total = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        total += validator_encode_frame(buffer.data(), data.data(), size);
+    }
+    auto time = std::chrono::steady_clock::now() - start;
+    long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+
+    printf("crc and stuffing: %.1f MB/s, %lld ns per %u byte frame\n",
+        (double)size * frames * 1000 / ns, ns / frames, size);
+    EXPECT_GE(total, frames * (size + 4 + 2));
+}
@@ -4,12 +4,14 @@ serial_link_byte_stuffer_SRC :=\
 
 serial_link_frame_validator_SRC := \
 	$(SERIAL_PATH)/tests/frame_validator_tests.cpp \
-	$(SERIAL_PATH)/protocol/frame_validator.c 
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/crc.c
 
 serial_link_frame_router_SRC := \
 	$(SERIAL_PATH)/tests/frame_router_tests.cpp \
 	$(SERIAL_PATH)/protocol/byte_stuffer.c \
 	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/crc.c \
 	$(SERIAL_PATH)/protocol/frame_router.c
 
 serial_link_triple_buffered_object_SRC := \
@@ -20,3 +22,16 @@ serial_link_transport_SRC := \
 	$(SERIAL_PATH)/tests/transport_tests.cpp \
 	$(SERIAL_PATH)/protocol/transport.c \
 	$(SERIAL_PATH)/protocol/triple_buffered_object.c 
+
+serial_link_crc_SRC := \
+	$(SERIAL_PATH)/tests/crc_tests.cpp \
+	$(SERIAL_PATH)/protocol/crc.c
+
+serial_link_crc_slice1_SRC := $(serial_link_crc_SRC)
+serial_link_crc_slice1_DEFS := -DSERIAL_LINK_CRC_SLICES=1
+
+serial_link_crc_slice8_SRC := $(serial_link_crc_SRC)
+serial_link_crc_slice8_DEFS := -DSERIAL_LINK_CRC_SLICES=8
+
+serial_link_frame_validator_crc16_SRC := $(serial_link_frame_validator_SRC)
+serial_link_frame_validator_crc16_DEFS := -DSERIAL_LINK_CRC16_LIMIT=32
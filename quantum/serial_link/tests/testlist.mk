@@ -1,6 +1,10 @@
 TEST_LIST +=\
 	serial_link_byte_stuffer\
 	serial_link_frame_validator\
+	serial_link_frame_validator_crc16\
+	serial_link_crc\
+	serial_link_crc_slice1\
+	serial_link_crc_slice8\
 	serial_link_frame_router\
 	serial_link_triple_buffered_object\
 	serial_link_transport
\ No newline at end of file
@@ -28,6 +28,7 @@ SOFTWARE.
 using testing::_;
 using testing::ElementsAreArray;
 using testing::Args;
+using testing::AnyNumber;
 
 extern "C" {
 #include "serial_link/protocol/transport.h"
@@ -42,16 +43,24 @@ struct test_object2 {
     uint32_t test2;
 };
 
+struct test_delta_object {
+    uint32_t rows[4];
+};
+
 MASTER_TO_ALL_SLAVES_OBJECT(master_to_slave, test_object1);
 MASTER_TO_SINGLE_SLAVE_OBJECT(master_to_single_slave, test_object1);
 SLAVE_TO_MASTER_OBJECT(slave_to_master, test_object1);
+SLAVE_TO_MASTER_DELTA_OBJECT(slave_to_master_delta, test_delta_object, uint32_t);
 
 static remote_object_t* test_remote_objects[] = {
     REMOTE_OBJECT(master_to_slave),
     REMOTE_OBJECT(master_to_single_slave),
     REMOTE_OBJECT(slave_to_master),
+    REMOTE_OBJECT(slave_to_master_delta),
 };
 
+static const uint8_t delta_object_id = 3;
+
 class Transport : public testing::Test {
 public:
     Transport() {
@@ -186,3 +195,205 @@ TEST_F(Transport, ignores_object_with_size_too_big) {
     test_object1* obj2 = read_master_to_slave();
     EXPECT_EQ(obj2, nullptr);
 }
+
+/* The delta object is both written here, as a slave would, and received
+ * from the frames it produces, as the master would.
+ */
+class DeltaTransport : public Transport {
+public:
+    DeltaTransport() {
+        EXPECT_CALL(*this, signal_data_written()).Times(AnyNumber());
+        EXPECT_CALL(*this, router_send_frame(_)).Times(AnyNumber());
+        update_transport();
+    }
+
+    void write(uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3) {
+        test_delta_object* obj = begin_write_slave_to_master_delta();
+        obj->rows[0] = r0;
+        obj->rows[1] = r1;
+        obj->rows[2] = r2;
+        obj->rows[3] = r3;
+        end_write_slave_to_master_delta();
+    }
+
+    std::vector<uint8_t> send() {
+        sent_data.clear();
+        update_transport();
+        return sent_data;
+    }
+
+    void deliver(std::vector<uint8_t> frame, uint8_t from = 1) {
+        transport_recv_frame(from, frame.data(), frame.size());
+    }
+
+    void expect_rows(uint8_t slave, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3) {
+        test_delta_object* obj = read_slave_to_master_delta(slave);
+        ASSERT_NE(obj, nullptr);
+        EXPECT_EQ(obj->rows[0], r0);
+        EXPECT_EQ(obj->rows[1], r1);
+        EXPECT_EQ(obj->rows[2], r2);
+        EXPECT_EQ(obj->rows[3], r3);
+    }
+
+    // header, mask, chunks and the id
+    static size_t frame_size(int chunks) {
+        return 2 + 1 + chunks * sizeof(uint32_t) + 1;
+    }
+};
+
+TEST_F(DeltaTransport, first_frame_has_everything) {
+    write(1, 2, 3, 4);
+    std::vector<uint8_t> frame = send();
+    EXPECT_EQ(frame.size(), frame_size(4));
+    EXPECT_EQ(frame.back(), delta_object_id);
+    deliver(frame);
+    expect_rows(0, 1, 2, 3, 4);
+    EXPECT_EQ(transport_delta_stats().full_frames, 1);
+}
+
+TEST_F(DeltaTransport, only_changed_chunks_are_sent) {
+    write(1, 2, 3, 4);
+    deliver(send());
+    write(1, 2, 7, 4);
+    std::vector<uint8_t> frame = send();
+    EXPECT_EQ(frame.size(), frame_size(1));
+    deliver(frame);
+    expect_rows(0, 1, 2, 7, 4);
+    write(9, 2, 7, 8);
+    frame = send();
+    EXPECT_EQ(frame.size(), frame_size(2));
+    deliver(frame);
+    expect_rows(0, 9, 2, 7, 8);
+}
+
+TEST_F(DeltaTransport, nothing_is_sent_without_a_write) {
+    write(1, 2, 3, 4);
+    deliver(send());
+    EXPECT_EQ(send().size(), 0);
+}
+
+TEST_F(DeltaTransport, writing_the_same_value_sends_a_heartbeat) {
+    write(1, 2, 3, 4);
+    deliver(send());
+    read_slave_to_master_delta(0);
+    write(1, 2, 3, 4);
+    std::vector<uint8_t> frame = send();
+    EXPECT_EQ(frame.size(), frame_size(0));
+    deliver(frame);
+    EXPECT_EQ(read_slave_to_master_delta(0), nullptr);
+    EXPECT_EQ(transport_delta_stats().heartbeats, 1);
+    EXPECT_EQ(send().size(), 0);
+}
+
+TEST_F(DeltaTransport, lost_frame_is_detected_and_resynced) {
+    write(1, 2, 3, 4);
+    deliver(send());
+    read_slave_to_master_delta(0);
+    write(1, 5, 3, 4);
+    send();
+    write(1, 5, 6, 4);
+    deliver(send());
+    // the delta can't be applied without the lost one
+    EXPECT_EQ(read_slave_to_master_delta(0), nullptr);
+    EXPECT_EQ(transport_delta_stats().gaps, 1);
+
+    EXPECT_CALL(*this, router_send_frame(1 << 0));
+    std::vector<uint8_t> request = send();
+    ASSERT_EQ(request.size(), 1);
+    EXPECT_EQ(request[0], delta_object_id | TRANSPORT_RESYNC_REQUEST);
+
+    // on the slave the request makes the next update send everything
+    deliver(request, 0);
+    std::vector<uint8_t> frame = send();
+    EXPECT_EQ(frame.size(), frame_size(4));
+    deliver(frame);
+    expect_rows(0, 1, 5, 6, 4);
+
+    write(1, 5, 6, 0);
+    deliver(send());
+    expect_rows(0, 1, 5, 6, 0);
+}
+
+TEST_F(DeltaTransport, lost_frame_is_detected_by_the_heartbeat) {
+    write(1, 2, 3, 4);
+    deliver(send());
+    write(1, 2, 3, 5);
+    send();
+    write(1, 2, 3, 5);
+    deliver(send());
+    EXPECT_EQ(transport_delta_stats().gaps, 1);
+    EXPECT_CALL(*this, router_send_frame(1 << 0));
+    EXPECT_EQ(send().size(), 1);
+}
+
+TEST_F(DeltaTransport, deltas_are_ignored_until_the_full_frame_arrives) {
+    write(1, 2, 3, 4);
+    deliver(send());
+    read_slave_to_master_delta(0);
+    write(2, 2, 3, 4);
+    send();
+    write(3, 2, 3, 4);
+    deliver(send());
+    std::vector<uint8_t> request = send();
+    // the request is lost, so are the deltas after it
+    write(4, 2, 3, 4);
+    deliver(send());
+    EXPECT_EQ(read_slave_to_master_delta(0), nullptr);
+    // and it is asked for again
+    EXPECT_CALL(*this, router_send_frame(1 << 0));
+    EXPECT_EQ(send(), request);
+}
+
+TEST_F(DeltaTransport, master_without_a_full_frame_asks_for_one) {
+    write(1, 2, 3, 4);
+    send();
+    write(1, 2, 3, 5);
+    deliver(send());
+    EXPECT_EQ(read_slave_to_master_delta(0), nullptr);
+    EXPECT_CALL(*this, router_send_frame(1 << 0));
+    std::vector<uint8_t> request = send();
+    deliver(request, 0);
+    deliver(send());
+    expect_rows(0, 1, 2, 3, 5);
+}
+
+TEST_F(DeltaTransport, crc_error_asks_all_slaves_for_full_frames) {
+    write(1, 2, 3, 4);
+    deliver(send());
+    transport_recv_error();
+    EXPECT_CALL(*this, router_send_frame(0xFF));
+    std::vector<uint8_t> request = send();
+    ASSERT_EQ(request.size(), 1);
+    EXPECT_EQ(request[0], delta_object_id | TRANSPORT_RESYNC_REQUEST);
+    EXPECT_EQ(send().size(), 0);
+    EXPECT_EQ(transport_delta_stats().resync_requests, 1);
+}
+
+TEST_F(DeltaTransport, slaves_are_kept_apart) {
+    write(1, 2, 3, 4);
+    std::vector<uint8_t> full = send();
+    deliver(full, 1);
+    deliver(full, 3);
+    write(1, 2, 3, 9);
+    deliver(send(), 3);
+    expect_rows(0, 1, 2, 3, 4);
+    expect_rows(2, 1, 2, 3, 9);
+    EXPECT_EQ(read_slave_to_master_delta(1), nullptr);
+}
+
+TEST_F(DeltaTransport, ignores_frame_with_wrong_size) {
+    write(1, 2, 3, 4);
+    std::vector<uint8_t> frame = send();
+    frame.erase(frame.begin() + 4);
+    deliver(frame);
+    EXPECT_EQ(read_slave_to_master_delta(0), nullptr);
+    EXPECT_EQ(transport_delta_stats().frames, 0);
+}
+
+TEST_F(DeltaTransport, ignores_resync_request_for_other_objects) {
+    write(1, 2, 3, 4);
+    deliver(send());
+    uint8_t request[] = {2 | TRANSPORT_RESYNC_REQUEST};
+    transport_recv_frame(0, request, 1);
+    EXPECT_EQ(send().size(), 0);
+}
@@ -23,6 +23,8 @@ SOFTWARE.
 */
 
 #include "gtest/gtest.h"
+#include <thread>
+#include <atomic>
 extern "C" {
 #include "serial_link/protocol/triple_buffered_object.h"
 }
@@ -82,3 +84,51 @@ TEST_F(TripleBufferedObject, performs_two_writes_in_the_middle_of_read) {
     EXPECT_EQ(*triple_buffer_read(&test_object), 3);
     EXPECT_EQ(triple_buffer_read(&test_object), nullptr);
 }
+
+struct stress_payload {
+    uint32_t values[8];
+};
+
+struct stress_object {
+    uint8_t state;
+    stress_payload buffer[3];
+};
+
+stress_object stress_object;
+
+TEST(TripleBufferedObjectThreads, reader_never_sees_a_torn_or_old_object) {
+    const uint32_t writes = 200000;
+    triple_buffer_init((triple_buffer_object_t*)&stress_object);
+    std::atomic<bool> done(false);
+
+    std::thread writer([&]() {
+        for (uint32_t i = 1; i <= writes; i++) {
+            stress_payload* payload = triple_buffer_begin_write(&stress_object);
+            for (auto& value : payload->values) {
+                value = i;
+            }
+            triple_buffer_end_write(&stress_object);
+        }
+        done = true;
+    });
+
+    uint32_t last = 0;
+    uint32_t reads = 0;
+    while (last != writes) {
+        // once the writer is done, the last write must be there to read
+        bool writer_done = done;
+        stress_payload* payload = triple_buffer_read(&stress_object);
+        if (!payload) {
+            ASSERT_FALSE(writer_done);
+            continue;
+        }
+        for (auto value : payload->values) {
+            ASSERT_EQ(value, payload->values[0]);
+        }
+        ASSERT_GT(payload->values[0], last);
+        last = payload->values[0];
+        reads++;
+    }
+    writer.join();
+    EXPECT_GT(reads, 0);
+}
@@ -16,12 +16,11 @@
 // poll loop takes at least 8 clock cycles to execute
 #define I2C_LOOP_TIMEOUT (9+1)*(F_CPU/SCL_CLOCK)/8
 
-#define BUFFER_POS_INC() (slave_buffer_pos = (slave_buffer_pos+1)%SLAVE_BUFFER_SIZE)
-
-volatile uint8_t i2c_slave_buffer[SLAVE_BUFFER_SIZE];
-
-static volatile uint8_t slave_buffer_pos;
-static volatile bool slave_has_register_set = false;
+static uint8_t slave_request[I2C_SLAVE_REQUEST_SIZE];
+static uint8_t slave_request_size;
+static uint8_t slave_reply[I2C_SLAVE_REPLY_SIZE];
+static uint8_t slave_reply_size;
+static uint8_t slave_reply_pos;
 
 // Wait for an i2c operation to finish
 inline static
@@ -120,35 +119,31 @@ ISR(TWI_vect) {
   switch(TW_STATUS) {
     case TW_SR_SLA_ACK:
       // this device has been addressed as a slave receiver
-      slave_has_register_set = false;
+      slave_request_size = 0;
       break;
 
     case TW_SR_DATA_ACK:
-      // this device has received data as a slave receiver
-      // The first byte that we receive in this transaction sets the location
-      // of the read/write location of the slaves memory that it exposes over
-      // i2c.  After that, bytes will be written at slave_buffer_pos, incrementing
-      // slave_buffer_pos after each write.
-      if(!slave_has_register_set) {
-        slave_buffer_pos = TWDR;
-        // don't acknowledge the master if this memory loctaion is out of bounds
-        if ( slave_buffer_pos >= SLAVE_BUFFER_SIZE ) {
-          ack = 0;
-          slave_buffer_pos = 0;
-        }
-        slave_has_register_set = true;
-      } else {
-        i2c_slave_buffer[slave_buffer_pos] = TWDR;
-        BUFFER_POS_INC();
+      // this device has received data as a slave receiver, the bytes are
+      // collected until the master reads the reply, extra ones are dropped
+      if (slave_request_size < I2C_SLAVE_REQUEST_SIZE) {
+        slave_request[slave_request_size++] = TWDR;
       }
       break;
 
     case TW_ST_SLA_ACK:
+      // master has addressed this device as a slave transmitter, the reply
+      // is put together from what it wrote since the last start
+      slave_reply_size = i2c_slave_reply(slave_request, slave_request_size, slave_reply);
+      slave_request_size = 0;
+      slave_reply_pos = 0;
+      // fall through
     case TW_ST_DATA_ACK:
-      // master has addressed this device as a slave transmitter and is
-      // requesting data.
-      TWDR = i2c_slave_buffer[slave_buffer_pos];
-      BUFFER_POS_INC();
+      // master is requesting data, past the end of the reply it gets 0xFF
+      if (slave_reply_pos < slave_reply_size) {
+        TWDR = slave_reply[slave_reply_pos++];
+      } else {
+        TWDR = 0xFF;
+      }
       break;
 
     case TW_BUS_ERROR: // something went wrong, reset twi state
@@ -2,6 +2,7 @@
 #define I2C_H
 
 #include <stdint.h>
+#include "split_protocol.h"
 
 #ifndef F_CPU
 #define F_CPU 16000000UL
@@ -13,13 +14,13 @@
 #define I2C_ACK 1
 #define I2C_NACK 0
 
-#define SLAVE_BUFFER_SIZE 0x10
+// Sized for the messages of split_protocol.h
+#define I2C_SLAVE_REQUEST_SIZE SPLIT_REQUEST_MAX
+#define I2C_SLAVE_REPLY_SIZE SPLIT_REPLY_MAX
 
 // i2c SCL clock frequency
 #define SCL_CLOCK  100000L
 
-extern volatile uint8_t i2c_slave_buffer[SLAVE_BUFFER_SIZE];
-
 void i2c_master_init(void);
 uint8_t i2c_master_start(uint8_t address);
 void i2c_master_stop(void);
@@ -28,4 +29,9 @@ uint8_t i2c_master_read(int);
 void i2c_reset_state(void);
 void i2c_slave_init(uint8_t address);
 
+// Provided by the user of the slave mode. Called from the interrupt when
+// the master turns around to read, with the bytes it wrote before. Fills
+// reply and returns its size.
+uint8_t i2c_slave_reply(const uint8_t* request, uint8_t size, uint8_t* reply);
+
 #endif
@@ -12,7 +12,7 @@
 #include <stdbool.h>
 #include "serial.h"
 
-#ifdef USE_SERIAL
+#if defined(USE_SERIAL) && !defined(SERIAL_PHY_USART) && !defined(SERIAL_PHY_ICP)
 
 // Serial pulse period in microseconds. Its probably a bad idea to lower this
 // value.
@@ -0,0 +1,47 @@
+#ifndef MY_SERIAL_H
+#define MY_SERIAL_H
+
+#include "config.h"
+#include <stdbool.h>
+#include "split_protocol.h"
+
+/* TODO:  some defines for interrupt setup */
+#define SERIAL_PIN_DDR DDRD
+#define SERIAL_PIN_PORT PORTD
+#define SERIAL_PIN_INPUT PIND
+#define SERIAL_PIN_MASK _BV(PD0)
+#define SERIAL_PIN_INTERRUPT INT0_vect
+
+// Sized for the messages of split_protocol.h
+#define SERIAL_SLAVE_BUFFER_LENGTH SPLIT_REPLY_MAX
+#define SERIAL_MASTER_BUFFER_LENGTH SPLIT_REQUEST_MAX
+
+// Buffers for master - slave communication
+extern volatile uint8_t serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH];
+extern volatile uint8_t serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH];
+
+void serial_master_init(void);
+void serial_slave_init(void);
+int serial_update_buffers(void);
+bool serial_slave_data_corrupt(void);
+
+/* The bit-banged PHY in serial.c is used unless one of these is defined:
+ *
+ * SERIAL_PHY_USART  hardware USART1 in half duplex, TXD1 (D3) and RXD1 (D2)
+ *                   both wired to the link, the slave also uses timer 0
+ *                   compare B
+ * SERIAL_PHY_ICP    timer 1 input capture, link wired to ICP1 (D4)
+ *
+ * Both send CRC checked frames and retry failed transactions.
+ */
+#if defined(SERIAL_PHY_USART) || defined(SERIAL_PHY_ICP)
+#include "serial_frame.h"
+
+#if SPLIT_REPLY_MAX > SERIAL_FRAME_MAX_PAYLOAD || SPLIT_REQUEST_MAX > SERIAL_FRAME_MAX_PAYLOAD
+#error "SERIAL_FRAME_MAX_PAYLOAD is too small for SPLIT_ROWS, raise it in config.h"
+#endif
+
+serial_frame_stats_t serial_stats(void);
+#endif
+
+#endif
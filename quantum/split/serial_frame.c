@@ -0,0 +1,125 @@
+#include "serial_frame.h"
+
+// CRC-8 with polynomial 0x07, catches every single bit error and every
+// burst of up to 8 bits
+uint8_t serial_frame_crc8(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+// serial.h checks the split buffers against SERIAL_FRAME_MAX_PAYLOAD, this
+// keeps any other caller from running off the end of the frame buffers
+static uint8_t clamp_size(uint8_t size) {
+    return size > SERIAL_FRAME_MAX_PAYLOAD ? SERIAL_FRAME_MAX_PAYLOAD : size;
+}
+
+uint8_t serial_frame_encode(uint8_t* frame, uint8_t marker, const volatile uint8_t* payload, uint8_t size) {
+    size = clamp_size(size);
+    uint8_t crc = serial_frame_crc8(0, marker);
+    frame[0] = marker;
+    for (uint8_t i = 0; i < size; i++) {
+        frame[i + 1] = payload[i];
+        crc = serial_frame_crc8(crc, payload[i]);
+    }
+    frame[size + 1] = crc;
+    return size + SERIAL_FRAME_OVERHEAD;
+}
+
+void serial_frame_receiver_init(serial_frame_receiver_t* receiver, uint8_t marker, uint8_t size) {
+    receiver->marker = marker;
+    receiver->size = clamp_size(size);
+    receiver->index = 0;
+}
+
+serial_frame_status_t serial_frame_receive(serial_frame_receiver_t* receiver, uint8_t byte) {
+    if (receiver->index == 0) {
+        if (byte == receiver->marker) {
+            receiver->crc = serial_frame_crc8(0, byte);
+            receiver->index = 1;
+        }
+        return SERIAL_FRAME_INCOMPLETE;
+    }
+    if (receiver->index <= receiver->size) {
+        receiver->data[receiver->index - 1] = byte;
+        receiver->crc = serial_frame_crc8(receiver->crc, byte);
+        receiver->index++;
+        return SERIAL_FRAME_INCOMPLETE;
+    }
+    receiver->index = 0;
+    return byte == receiver->crc ? SERIAL_FRAME_OK : SERIAL_FRAME_BAD;
+}
+
+int serial_frame_transaction(const serial_frame_phy_t* phy,
+                             const volatile uint8_t* master_buffer, uint8_t master_size,
+                             volatile uint8_t* slave_buffer, uint8_t slave_size,
+                             serial_frame_stats_t* stats) {
+    uint8_t request[SERIAL_FRAME_MAX_PAYLOAD + SERIAL_FRAME_OVERHEAD];
+    uint8_t request_size = serial_frame_encode(request, SERIAL_FRAME_REQUEST, master_buffer, master_size);
+    serial_frame_receiver_t reply;
+
+    stats->transactions++;
+    for (uint8_t attempt = 0; attempt <= SERIAL_FRAME_RETRIES; attempt++) {
+        if (attempt) {
+            stats->retries++;
+        }
+        phy->send(request, request_size);
+
+        serial_frame_receiver_init(&reply, SERIAL_FRAME_REPLY, slave_size);
+        serial_frame_status_t status;
+        uint8_t byte;
+        if (!phy->receive(&byte)) {
+            // Nothing came back, most likely the slave isn't there, and
+            // retrying would only keep the master busy for longer
+            stats->timeouts++;
+            break;
+        }
+        do {
+            status = serial_frame_receive(&reply, byte);
+        } while (status == SERIAL_FRAME_INCOMPLETE && phy->receive(&byte));
+        if (status == SERIAL_FRAME_OK) {
+            for (uint8_t i = 0; i < reply.size; i++) {
+                slave_buffer[i] = reply.data[i];
+            }
+            return 0;
+        }
+        if (status == SERIAL_FRAME_BAD) {
+            stats->checksum_errors++;
+        } else {
+            stats->timeouts++;
+        }
+    }
+    stats->failures++;
+    return 1;
+}
+
+void serial_frame_slave_init(serial_frame_slave_t* slave,
+                             volatile uint8_t* master_buffer, uint8_t master_size,
+                             const volatile uint8_t* slave_buffer, uint8_t slave_size) {
+    serial_frame_receiver_init(&slave->request, SERIAL_FRAME_REQUEST, master_size);
+    slave->master_buffer = master_buffer;
+    slave->slave_buffer = slave_buffer;
+    slave->slave_size = clamp_size(slave_size);
+    slave->checksum_errors = 0;
+}
+
+void serial_frame_slave_idle(serial_frame_slave_t* slave) {
+    slave->request.index = 0;
+}
+
+uint8_t serial_frame_slave_receive(serial_frame_slave_t* slave, uint8_t byte) {
+    switch (serial_frame_receive(&slave->request, byte)) {
+    case SERIAL_FRAME_OK:
+        for (uint8_t i = 0; i < slave->request.size; i++) {
+            slave->master_buffer[i] = slave->request.data[i];
+        }
+        return serial_frame_encode(slave->reply, SERIAL_FRAME_REPLY, slave->slave_buffer, slave->slave_size);
+    case SERIAL_FRAME_BAD:
+        slave->checksum_errors++;
+        return 0;
+    default:
+        return 0;
+    }
+}
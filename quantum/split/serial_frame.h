@@ -0,0 +1,100 @@
+#ifndef SPLIT_SERIAL_FRAME_H
+#define SPLIT_SERIAL_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Framing for the byte oriented split serial PHYs
+ *
+ * A transaction is a request from the master followed by the reply of the
+ * slave, both with a marker byte in front and a CRC-8 of marker and
+ * payload at the end:
+ *
+ *   master: SERIAL_FRAME_REQUEST, master buffer, crc
+ *   slave:  SERIAL_FRAME_REPLY,   slave buffer,  crc
+ *
+ * The slave only replies to a good request and only takes over the master
+ * buffer from one. The master retries the whole transaction when the reply
+ * is broken or cut short, so both buffers have to be safe to send twice.
+ * When no reply byte arrives at all it gives up right away.
+ */
+
+#define SERIAL_FRAME_REQUEST  0xA5
+#define SERIAL_FRAME_REPLY    0x5A
+#define SERIAL_FRAME_OVERHEAD 2
+
+#ifndef SERIAL_FRAME_MAX_PAYLOAD
+#define SERIAL_FRAME_MAX_PAYLOAD 16
+#endif
+
+#ifndef SERIAL_FRAME_RETRIES
+#define SERIAL_FRAME_RETRIES 3
+#endif
+
+typedef struct {
+    uint16_t transactions;
+    uint16_t retries;           // attempts after the first one
+    uint16_t timeouts;          // reply missing or cut short
+    uint16_t checksum_errors;   // bad frames, on the slave too
+    uint16_t failures;          // transactions that ran out of retries
+} serial_frame_stats_t;
+
+typedef enum {
+    SERIAL_FRAME_INCOMPLETE,
+    SERIAL_FRAME_OK,
+    SERIAL_FRAME_BAD,
+} serial_frame_status_t;
+
+typedef struct {
+    uint8_t marker;
+    uint8_t size;
+    uint8_t index;
+    uint8_t crc;
+    uint8_t data[SERIAL_FRAME_MAX_PAYLOAD];
+} serial_frame_receiver_t;
+
+// The PHY the master runs transactions on. send returns once the frame is
+// on the wire, receive returns false when no byte arrived in time.
+typedef struct {
+    void (*send)(const uint8_t* frame, uint8_t size);
+    bool (*receive)(uint8_t* byte);
+} serial_frame_phy_t;
+
+typedef struct {
+    serial_frame_receiver_t request;
+    volatile uint8_t* master_buffer;
+    const volatile uint8_t* slave_buffer;
+    uint8_t slave_size;
+    uint8_t reply[SERIAL_FRAME_MAX_PAYLOAD + SERIAL_FRAME_OVERHEAD];
+    uint16_t checksum_errors;
+} serial_frame_slave_t;
+
+uint8_t serial_frame_crc8(uint8_t crc, uint8_t data);
+
+// Writes marker, payload and crc to frame, returns the frame size
+uint8_t serial_frame_encode(uint8_t* frame, uint8_t marker, const volatile uint8_t* payload, uint8_t size);
+
+void serial_frame_receiver_init(serial_frame_receiver_t* receiver, uint8_t marker, uint8_t size);
+// Bytes before the marker are skipped. Once OK is returned the payload is
+// in receiver->data until the next byte is fed.
+serial_frame_status_t serial_frame_receive(serial_frame_receiver_t* receiver, uint8_t byte);
+
+// Runs one transaction with retries. Returns 0 when the slave buffer was
+// updated, 1 when all attempts failed and the slave buffer is unchanged.
+int serial_frame_transaction(const serial_frame_phy_t* phy,
+                             const volatile uint8_t* master_buffer, uint8_t master_size,
+                             volatile uint8_t* slave_buffer, uint8_t slave_size,
+                             serial_frame_stats_t* stats);
+
+void serial_frame_slave_init(serial_frame_slave_t* slave,
+                             volatile uint8_t* master_buffer, uint8_t master_size,
+                             const volatile uint8_t* slave_buffer, uint8_t slave_size);
+// Called by the PHY when the line has been idle for longer than a byte, so
+// a frame cut short by noise can't swallow the start of the next request.
+void serial_frame_slave_idle(serial_frame_slave_t* slave);
+// Feeds one received byte to the slave, safe to call from an interrupt.
+// Returns the size of slave->reply to send back, 0 while there is nothing
+// to answer yet.
+uint8_t serial_frame_slave_receive(serial_frame_slave_t* slave, uint8_t byte);
+
+#endif
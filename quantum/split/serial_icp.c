@@ -0,0 +1,281 @@
+/*
+ * Single wire PHY decoded with the timer 1 input capture unit
+ *
+ * The link wire goes to ICP1 (PD4) and carries plain asynchronous frames:
+ * a start bit, 8 data bits LSB first and two stop bits. Instead of sampling
+ * the line, the receiver timestamps every edge in hardware and works out
+ * the bits from the distance between edges, so a short interrupt per edge
+ * is all the slave spends receiving. It sends its reply from the output
+ * compare interrupt, one bit per interrupt, and never waits in an ISR.
+ *
+ * The master only turns interrupts off while it drives the line and while
+ * it decodes a reply byte. The wait for the reply runs with interrupts on,
+ * the input capture keeps the time of the start bit meanwhile. An
+ * interrupt that outlasts a bit still breaks the byte, and the frame
+ * checksum catches it.
+ *
+ * Timer 1 is used exclusively, which rules out backlight on it.
+ */
+
+#ifndef F_CPU
+#define F_CPU 16000000
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdbool.h>
+#include "serial.h"
+
+#if defined(USE_SERIAL) && defined(SERIAL_PHY_ICP)
+
+#include "serial_frame.h"
+
+#ifndef SERIAL_ICP_SPEED
+#define SERIAL_ICP_SPEED 125000
+#endif
+#define BIT_TICKS (F_CPU / SERIAL_ICP_SPEED)
+#define FRAME_BITS 11
+// how long the master waits for the start of a reply byte
+#ifndef SERIAL_ICP_TIMEOUT_BITS
+#define SERIAL_ICP_TIMEOUT_BITS 40
+#endif
+
+#define SERIAL_ICP_DDR  DDRD
+#define SERIAL_ICP_PORT PORTD
+#define SERIAL_ICP_MASK _BV(PD4)
+
+uint8_t volatile serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH] = {0};
+uint8_t volatile serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH] = {0};
+
+static serial_frame_stats_t stats;
+static serial_frame_slave_t slave;
+
+static bool rx_active;
+static bool rx_level;
+static uint8_t rx_index;
+static uint16_t rx_frame;
+static uint16_t rx_start;
+
+static const uint8_t* tx_data;
+static uint8_t tx_size;
+static uint8_t tx_bit;
+static uint16_t tx_frame;
+
+inline static
+void line_release(void) {
+  SERIAL_ICP_DDR  &= ~SERIAL_ICP_MASK;
+  SERIAL_ICP_PORT |=  SERIAL_ICP_MASK;
+}
+
+inline static
+void line_drive(bool level) {
+  if (level) {
+    SERIAL_ICP_PORT |=  SERIAL_ICP_MASK;
+  } else {
+    SERIAL_ICP_PORT &= ~SERIAL_ICP_MASK;
+  }
+  SERIAL_ICP_DDR |= SERIAL_ICP_MASK;
+}
+
+static
+void icp_timer_init(void) {
+  TCCR1A = 0;
+  TCCR1B = _BV(ICNC1) | _BV(CS10);  // falling edge, no prescaler
+  TIMSK1 = 0;
+  line_release();
+}
+
+// the bits between the last edge and bit position index had the old level
+inline static
+void rx_fill(uint8_t index) {
+  if (index > FRAME_BITS) {
+    index = FRAME_BITS;
+  }
+  for (; rx_index < index; rx_index++) {
+    if (rx_level) {
+      rx_frame |= 1 << rx_index;
+    }
+  }
+}
+
+static
+void rx_reset(void) {
+  rx_active = false;
+  TCCR1B &= ~_BV(ICES1);
+  TIFR1 = _BV(ICF1);
+}
+
+// returns true for the start bit of a new byte
+static
+bool rx_edge(uint16_t time) {
+  bool start = !rx_active;
+  if (start) {
+    rx_active = true;
+    rx_level = false;
+    rx_index = 0;
+    rx_frame = 0;
+    rx_start = time;
+    // the end of the byte is decided in the middle of the first stop bit
+    OCR1A = time + BIT_TICKS * 19 / 2;
+    TIFR1 = _BV(OCF1A);
+  } else {
+    rx_fill(((uint16_t)(time - rx_start) + BIT_TICKS / 2) / BIT_TICKS);
+    rx_level = !rx_level;
+  }
+  TCCR1B ^= _BV(ICES1);
+  TIFR1 = _BV(ICF1);
+  return start;
+}
+
+// returns false for a framing error, which is what a break looks like
+static
+bool rx_finish(uint8_t* byte) {
+  rx_fill(10);
+  rx_reset();
+  *byte = rx_frame >> 1;
+  return rx_frame & (1 << 9);
+}
+
+// drives the next bit, returns false once the last stop bit is done
+static
+bool tx_step(void) {
+  if (tx_bit == FRAME_BITS) {
+    if (!tx_size) {
+      return false;
+    }
+    tx_frame = ((uint16_t)*tx_data++ << 1) | (0b11 << 9);
+    tx_size--;
+    tx_bit = 0;
+  }
+  line_drive(tx_frame & (1 << tx_bit));
+  tx_bit++;
+  return true;
+}
+
+static
+void tx_load(const uint8_t* data, uint8_t size) {
+  tx_data = data;
+  tx_size = size;
+  tx_bit = FRAME_BITS;
+}
+
+static
+void icp_send(const uint8_t* frame, uint8_t size) {
+  uint8_t sreg = SREG;
+  cli();
+
+  // a break of more than a byte resets the slave's frame receiver
+  line_drive(false);
+  OCR1B = TCNT1 + BIT_TICKS * (FRAME_BITS + 1);
+  TIFR1 = _BV(OCF1B);
+  while (!(TIFR1 & _BV(OCF1B)));
+  line_drive(true);
+
+  tx_load(frame, size);
+  OCR1B += BIT_TICKS;
+  TIFR1 = _BV(OCF1B);
+  do {
+    while (!(TIFR1 & _BV(OCF1B)));
+    TIFR1 = _BV(OCF1B);
+    OCR1B += BIT_TICKS;
+  } while (tx_step());
+
+  line_release();
+  rx_reset();
+  SREG = sreg;
+}
+
+static
+bool icp_receive(uint8_t* byte) {
+  OCR1A = TCNT1 + BIT_TICKS * SERIAL_ICP_TIMEOUT_BITS;
+  TIFR1 = _BV(OCF1A);
+  while (!(TIFR1 & _BV(ICF1))) {
+    if (TIFR1 & _BV(OCF1A)) {
+      return false;
+    }
+  }
+
+  uint8_t sreg = SREG;
+  cli();
+  rx_edge(ICR1);
+  while (!(TIFR1 & _BV(OCF1A))) {
+    if (TIFR1 & _BV(ICF1)) {
+      rx_edge(ICR1);
+    }
+  }
+  // a broken byte is passed on, the frame checksum catches it
+  rx_finish(byte);
+  SREG = sreg;
+  return true;
+}
+
+static const serial_frame_phy_t icp_phy = { icp_send, icp_receive };
+
+void serial_master_init(void) {
+  icp_timer_init();
+}
+
+void serial_slave_init(void) {
+  serial_frame_slave_init(&slave,
+      serial_master_buffer, SERIAL_MASTER_BUFFER_LENGTH,
+      serial_slave_buffer, SERIAL_SLAVE_BUFFER_LENGTH);
+  icp_timer_init();
+  rx_reset();
+  TIMSK1 = _BV(ICIE1);
+}
+
+ISR(TIMER1_CAPT_vect) {
+  if (rx_edge(ICR1)) {
+    TIMSK1 |= _BV(OCIE1A);
+  }
+}
+
+ISR(TIMER1_COMPA_vect) {
+  TIMSK1 &= ~_BV(OCIE1A);
+  uint8_t byte;
+  if (!rx_finish(&byte)) {
+    serial_frame_slave_idle(&slave);
+    return;
+  }
+  uint8_t reply_size = serial_frame_slave_receive(&slave, byte);
+  if (reply_size) {
+    // stop listening while the reply goes out
+    TIMSK1 = 0;
+    tx_load(slave.reply, reply_size);
+    line_drive(true);
+    // the master still drives its last stop bit, start after it let go
+    OCR1B = TCNT1 + BIT_TICKS * 3;
+    TIFR1 = _BV(OCF1B);
+    TIMSK1 = _BV(OCIE1B);
+  }
+}
+
+ISR(TIMER1_COMPB_vect) {
+  OCR1B += BIT_TICKS;
+  if (!tx_step()) {
+    line_release();
+    rx_reset();
+    TIMSK1 = _BV(ICIE1);
+  }
+}
+
+// Copies the serial_slave_buffer to the master and sends the
+// serial_master_buffer to the slave, retrying broken transactions.
+//
+// Returns:
+// 0 => no error
+// 1 => slave did not respond
+int serial_update_buffers(void) {
+  return serial_frame_transaction(&icp_phy,
+      serial_master_buffer, SERIAL_MASTER_BUFFER_LENGTH,
+      serial_slave_buffer, SERIAL_SLAVE_BUFFER_LENGTH,
+      &stats);
+}
+
+serial_frame_stats_t serial_stats(void) {
+  serial_frame_stats_t result = stats;
+  result.checksum_errors += slave.checksum_errors;
+  return result;
+}
+
+#endif
@@ -0,0 +1,193 @@
+/*
+ * Half duplex one-wire PHY on the hardware USART1
+ *
+ * TXD1 (PD3) and RXD1 (PD2) are both tied to the link wire, which idles
+ * high through the pull-up. A side only enables its transmitter while it
+ * has a frame to send and keeps its receiver off meanwhile, so it never
+ * hears itself. The master starts every transaction with a break, which
+ * the slave sees as a framing error and uses to resync.
+ *
+ * The slave is entirely interrupt driven: bytes are decoded as they come
+ * in and the reply goes out from the data register empty interrupt. The
+ * last request byte completes half way through its stop bit, while the
+ * master still drives the line, so the reply only starts a guard time
+ * later, from the timer 0 compare B interrupt. tmk's millisecond timer
+ * only uses compare A.
+ */
+
+#ifndef F_CPU
+#define F_CPU 16000000
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include <stdbool.h>
+#include "serial.h"
+#include "timer.h"
+
+#if defined(USE_SERIAL) && defined(SERIAL_PHY_USART)
+
+#include "serial_frame.h"
+
+#ifndef SERIAL_USART_SPEED
+#define SERIAL_USART_SPEED 500000
+#endif
+// double speed mode, 8 samples per bit
+#define SERIAL_USART_UBRR ((F_CPU / (8UL * SERIAL_USART_SPEED)) - 1)
+// start, 8 data and stop bit
+#define SERIAL_USART_BYTE_US (10 * 1000000UL / SERIAL_USART_SPEED)
+#ifndef SERIAL_USART_TIMEOUT_US
+#define SERIAL_USART_TIMEOUT_US (10 * SERIAL_USART_BYTE_US)
+#endif
+// how long the slave waits after a request before it takes the line
+#ifndef SERIAL_USART_GUARD_US
+#define SERIAL_USART_GUARD_US SERIAL_USART_BYTE_US
+#endif
+// rounded up, plus one as the timer may be about to tick
+#define SERIAL_USART_GUARD_TICKS \
+  ((SERIAL_USART_GUARD_US * (F_CPU / 1000000) + TIMER_PRESCALER - 1) / TIMER_PRESCALER + 1)
+#if SERIAL_USART_GUARD_TICKS > TIMER_RAW_TOP
+#error "SERIAL_USART_GUARD_US doesn't fit in a Timer0 period"
+#endif
+
+#define SERIAL_USART_DDR  DDRD
+#define SERIAL_USART_PORT PORTD
+#define SERIAL_USART_MASK (_BV(PD2) | _BV(PD3))
+#define SERIAL_USART_TX_MASK _BV(PD3)
+
+uint8_t volatile serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH] = {0};
+uint8_t volatile serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH] = {0};
+
+static serial_frame_stats_t stats;
+static serial_frame_slave_t slave;
+static uint8_t reply_size;
+static uint8_t reply_index;
+
+// release the line to the pull-up
+inline static
+void usart_release(void) {
+  SERIAL_USART_DDR  &= ~SERIAL_USART_MASK;
+  SERIAL_USART_PORT |=  SERIAL_USART_MASK;
+}
+
+static
+void usart_init(void) {
+  usart_release();
+  UBRR1 = SERIAL_USART_UBRR;
+  UCSR1A = _BV(U2X1);
+  UCSR1C = _BV(UCSZ11) | _BV(UCSZ10);  // 8N1
+}
+
+static
+void usart_send(const uint8_t* frame, uint8_t size) {
+  UCSR1B = 0;
+
+  // a break ahead of the frame resets the slave's frame receiver
+  SERIAL_USART_PORT &= ~SERIAL_USART_TX_MASK;
+  SERIAL_USART_DDR  |=  SERIAL_USART_TX_MASK;
+  _delay_us(2 * SERIAL_USART_BYTE_US);
+  SERIAL_USART_PORT |=  SERIAL_USART_TX_MASK;
+  _delay_us(SERIAL_USART_BYTE_US / 10 + 1);
+
+  UCSR1B = _BV(TXEN1);
+  for (uint8_t i = 0; i < size; i++) {
+    while (!(UCSR1A & _BV(UDRE1)));
+    UCSR1A = _BV(U2X1) | _BV(TXC1);
+    UDR1 = frame[i];
+  }
+  while (!(UCSR1A & _BV(TXC1)));
+
+  UCSR1B = 0;
+  usart_release();
+  UCSR1B = _BV(RXEN1);
+}
+
+static
+bool usart_receive(uint8_t* byte) {
+  for (uint16_t t = 0; t < SERIAL_USART_TIMEOUT_US; t++) {
+    if (UCSR1A & _BV(RXC1)) {
+      *byte = UDR1;
+      return true;
+    }
+    _delay_us(1);
+  }
+  return false;
+}
+
+static const serial_frame_phy_t usart_phy = { usart_send, usart_receive };
+
+void serial_master_init(void) {
+  usart_init();
+}
+
+void serial_slave_init(void) {
+  serial_frame_slave_init(&slave,
+      serial_master_buffer, SERIAL_MASTER_BUFFER_LENGTH,
+      serial_slave_buffer, SERIAL_SLAVE_BUFFER_LENGTH);
+  usart_init();
+  UCSR1B = _BV(RXEN1) | _BV(RXCIE1);
+}
+
+ISR(USART1_RX_vect) {
+  bool framing_error = UCSR1A & _BV(FE1);
+  uint8_t byte = UDR1;
+
+  if (framing_error) {
+    // the master's break
+    serial_frame_slave_idle(&slave);
+    return;
+  }
+  reply_size = serial_frame_slave_receive(&slave, byte);
+  if (reply_size) {
+    // stop listening and start the reply once the master let go
+    UCSR1B = 0;
+    reply_index = 0;
+    uint16_t start = TCNT0 + SERIAL_USART_GUARD_TICKS;
+    // timer 0 counts from 0 to TIMER_RAW_TOP
+    OCR0B = start > TIMER_RAW_TOP ? start - (TIMER_RAW_TOP + 1) : start;
+    TIFR0 = _BV(OCF0B);
+    TIMSK0 |= _BV(OCIE0B);
+  }
+}
+
+ISR(TIMER0_COMPB_vect) {
+  TIMSK0 &= ~_BV(OCIE0B);
+  UCSR1B = _BV(TXEN1) | _BV(UDRIE1);
+}
+
+ISR(USART1_UDRE_vect) {
+  UCSR1A = _BV(U2X1) | _BV(TXC1);
+  UDR1 = slave.reply[reply_index++];
+  if (reply_index == reply_size) {
+    UCSR1B = _BV(TXEN1) | _BV(TXCIE1);
+  }
+}
+
+ISR(USART1_TX_vect) {
+  // the reply is out, hand the line back to the master
+  UCSR1B = 0;
+  usart_release();
+  UCSR1B = _BV(RXEN1) | _BV(RXCIE1);
+}
+
+// Copies the serial_slave_buffer to the master and sends the
+// serial_master_buffer to the slave, retrying broken transactions.
+//
+// Returns:
+// 0 => no error
+// 1 => slave did not respond
+int serial_update_buffers(void) {
+  return serial_frame_transaction(&usart_phy,
+      serial_master_buffer, SERIAL_MASTER_BUFFER_LENGTH,
+      serial_slave_buffer, SERIAL_SLAVE_BUFFER_LENGTH,
+      &stats);
+}
+
+serial_frame_stats_t serial_stats(void) {
+  serial_frame_stats_t result = stats;
+  result.checksum_errors += slave.checksum_errors;
+  return result;
+}
+
+#endif
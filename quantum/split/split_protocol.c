@@ -0,0 +1,171 @@
+#include <string.h>
+#include "split_protocol.h"
+
+static uint8_t* write_row(uint8_t* out, matrix_row_t row) {
+    for (uint8_t i = 0; i < SPLIT_ROW_SIZE; i++) {
+        *out++ = row;
+        row >>= 8;
+    }
+    return out;
+}
+
+static const uint8_t* read_row(const uint8_t* in, matrix_row_t* row) {
+    matrix_row_t result = 0;
+    for (uint8_t i = 0; i < SPLIT_ROW_SIZE; i++) {
+        result |= (matrix_row_t)in[i] << (8 * i);
+    }
+    *row = result;
+    return in + SPLIT_ROW_SIZE;
+}
+
+static bool state_equal(const split_state_t* a, const split_state_t* b) {
+    return a->leds == b->leds && a->layers == b->layers;
+}
+
+void split_slave_init(split_slave_t* slave) {
+    memset(slave, 0, sizeof(*slave));
+    // 0 is what a master without rows sends
+    slave->sequence = 1;
+}
+
+bool split_slave_set_rows(split_slave_t* slave, const matrix_row_t* rows) {
+    if (memcmp(slave->rows, rows, sizeof(slave->rows)) == 0) {
+        return false;
+    }
+    memcpy(slave->rows, rows, sizeof(slave->rows));
+    if (++slave->sequence == 0) {
+        slave->sequence = 1;
+    }
+    return true;
+}
+
+void split_slave_request(split_slave_t* slave, const uint8_t* request, uint8_t size) {
+    if (size < 1 + SPLIT_REQUEST_STATE_SIZE || SPLIT_REQUEST_STATE_SIZE == 0) {
+        return;
+    }
+    split_state_t state = slave->state;
+    request++;
+#ifdef SPLIT_SYNC_LEDS
+    state.leds = *request++;
+#endif
+#ifdef SPLIT_SYNC_LAYERS
+    state.layers = (uint32_t)request[0] | (uint32_t)request[1] << 8 |
+                   (uint32_t)request[2] << 16 | (uint32_t)request[3] << 24;
+#endif
+    if (!state_equal(&state, &slave->state)) {
+        slave->state = state;
+        slave->state_changed = true;
+    }
+}
+
+uint8_t split_slave_reply(split_slave_t* slave, uint8_t sequence, uint8_t* reply) {
+    uint8_t mask = 0;
+    if (sequence != slave->sequence) {
+        if (sequence != 0 && sequence == slave->sent_sequence) {
+            for (uint8_t i = 0; i < SPLIT_ROWS; i++) {
+                if (slave->rows[i] != slave->sent_rows[i]) {
+                    mask |= 1 << i;
+                }
+            }
+        } else {
+            mask = SPLIT_ALL_ROWS;
+        }
+    }
+
+    uint8_t* out = reply;
+    *out++ = mask;
+    *out++ = slave->sequence;
+    for (uint8_t i = 0; i < SPLIT_ROWS; i++) {
+        if (mask & (1 << i)) {
+            out = write_row(out, slave->rows[i]);
+        }
+    }
+    memcpy(slave->sent_rows, slave->rows, sizeof(slave->rows));
+    slave->sent_sequence = slave->sequence;
+    return out - reply;
+}
+
+void split_master_init(split_master_t* master) {
+    memset(master, 0, sizeof(*master));
+}
+
+uint8_t split_master_request(split_master_t* master, const split_state_t* state,
+                             bool force_state, uint8_t* request) {
+    uint8_t* out = request;
+    *out++ = master->sequence;
+    master->pending_valid = false;
+    if (SPLIT_REQUEST_STATE_SIZE == 0) {
+        return out - request;
+    }
+    if (!force_state && master->state_valid && state_equal(state, &master->state)) {
+        return out - request;
+    }
+#ifdef SPLIT_SYNC_LEDS
+    *out++ = state->leds;
+#endif
+#ifdef SPLIT_SYNC_LAYERS
+    *out++ = state->layers;
+    *out++ = state->layers >> 8;
+    *out++ = state->layers >> 16;
+    *out++ = state->layers >> 24;
+#endif
+    master->pending = *state;
+    master->pending_valid = true;
+    return out - request;
+}
+
+uint8_t split_reply_rows_size(uint8_t mask) {
+    uint8_t rows = 0;
+    for (; mask; mask &= mask - 1) {
+        rows++;
+    }
+    return rows * SPLIT_ROW_SIZE;
+}
+
+bool split_master_reply(split_master_t* master, const uint8_t* reply, uint8_t size) {
+    master->stats.exchanges++;
+    if (size < SPLIT_REPLY_HEADER ||
+        (reply[0] & ~SPLIT_ALL_ROWS) || reply[1] == 0 ||
+        size != SPLIT_REPLY_HEADER + split_reply_rows_size(reply[0])) {
+        split_master_error(master);
+        return false;
+    }
+    uint8_t mask = reply[0];
+    uint8_t sequence = reply[1];
+
+    // backends with fixed size replies always send all rows
+    if (mask == 0 || sequence == master->sequence) {
+        mask = 0;
+        master->stats.unchanged++;
+    } else if (mask == SPLIT_ALL_ROWS) {
+        master->stats.full++;
+    }
+    const uint8_t* in = reply + SPLIT_REPLY_HEADER;
+    for (uint8_t i = 0; i < SPLIT_ROWS; i++) {
+        if (mask & (1 << i)) {
+            in = read_row(in, &master->rows[i]);
+            if (mask != SPLIT_ALL_ROWS) {
+                master->stats.delta_rows++;
+            }
+        }
+    }
+    master->sequence = sequence;
+
+    if (master->pending_valid) {
+        master->state = master->pending;
+        master->state_valid = true;
+        master->pending_valid = false;
+    }
+    return true;
+}
+
+void split_master_error(split_master_t* master) {
+    master->stats.errors++;
+    master->pending_valid = false;
+}
+
+void split_master_reset(split_master_t* master) {
+    memset(master->rows, 0, sizeof(master->rows));
+    master->sequence = 0;
+    master->state_valid = false;
+}
@@ -0,0 +1,124 @@
+#ifndef SPLIT_PROTOCOL_H
+#define SPLIT_PROTOCOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+
+/* What the two halves of a split keyboard tell each other
+ *
+ * The master starts every exchange with a request:
+ *
+ *   sequence   the sequence number of the slave rows it has, 0 for none
+ *   leds       host LED state, with SPLIT_SYNC_LEDS
+ *   layers     layer_state, 4 bytes little endian, with SPLIT_SYNC_LAYERS
+ *
+ * The state is only appended when it changed, or always when the backend
+ * needs fixed size requests. The slave answers with:
+ *
+ *   mask       bit n set when row n follows
+ *   sequence   the sequence number of the rows after applying the reply
+ *   rows       the rows in mask, sizeof(matrix_row_t) bytes little endian
+ *
+ * The slave bumps its sequence number whenever a row changes. If the master
+ * already has the current sequence the mask is empty, if it has the one of
+ * the previous reply only the rows that changed since are sent, otherwise
+ * all of them are.
+ */
+
+#ifndef SPLIT_ROWS
+#define SPLIT_ROWS (MATRIX_ROWS / 2)
+#endif
+
+#if SPLIT_ROWS > 8
+#error "SPLIT_ROWS: the reply mask only has room for 8 rows"
+#endif
+
+#define SPLIT_ALL_ROWS ((uint8_t)((1 << SPLIT_ROWS) - 1))
+
+#define SPLIT_LEDS_SIZE 1
+#define SPLIT_LAYERS_SIZE 4
+#ifdef SPLIT_SYNC_LEDS
+#  define SPLIT_REQUEST_LEDS_SIZE SPLIT_LEDS_SIZE
+#else
+#  define SPLIT_REQUEST_LEDS_SIZE 0
+#endif
+#ifdef SPLIT_SYNC_LAYERS
+#  define SPLIT_REQUEST_LAYERS_SIZE SPLIT_LAYERS_SIZE
+#else
+#  define SPLIT_REQUEST_LAYERS_SIZE 0
+#endif
+#define SPLIT_REQUEST_STATE_SIZE (SPLIT_REQUEST_LEDS_SIZE + SPLIT_REQUEST_LAYERS_SIZE)
+#define SPLIT_REQUEST_MAX (1 + SPLIT_REQUEST_STATE_SIZE)
+
+// sizeof(matrix_row_t), spelled out like matrix.h so that #if can use it
+#if (MATRIX_COLS <= 8)
+#  define SPLIT_ROW_SIZE 1
+#elif (MATRIX_COLS <= 16)
+#  define SPLIT_ROW_SIZE 2
+#else
+#  define SPLIT_ROW_SIZE 4
+#endif
+#define SPLIT_REPLY_HEADER 2
+#define SPLIT_REPLY_MAX (SPLIT_REPLY_HEADER + SPLIT_ROWS * SPLIT_ROW_SIZE)
+
+// State the master forwards to the slave
+typedef struct {
+    uint8_t leds;
+    uint32_t layers;
+} split_state_t;
+
+typedef struct {
+    matrix_row_t rows[SPLIT_ROWS];
+    uint8_t sequence;
+    // what the last reply left the master with
+    matrix_row_t sent_rows[SPLIT_ROWS];
+    uint8_t sent_sequence;
+    split_state_t state;
+    bool state_changed;
+} split_slave_t;
+
+typedef struct {
+    uint16_t exchanges;
+    uint16_t unchanged;     // replies without rows
+    uint16_t delta_rows;    // rows received in partial replies
+    uint16_t full;          // replies with all rows
+    uint16_t errors;        // failed exchanges and broken replies
+} split_stats_t;
+
+typedef struct {
+    matrix_row_t rows[SPLIT_ROWS];
+    uint8_t sequence;
+    split_state_t state;
+    bool state_valid;
+    // sent with the last request, becomes state once it went through
+    split_state_t pending;
+    bool pending_valid;
+    split_stats_t stats;
+} split_master_t;
+
+void split_slave_init(split_slave_t* slave);
+// Stores the rows of the slave half, returns true if any changed
+bool split_slave_set_rows(split_slave_t* slave, const matrix_row_t* rows);
+// Takes in a request, the forwarded state is kept in slave->state and
+// slave->state_changed is set when it differs
+void split_slave_request(split_slave_t* slave, const uint8_t* request, uint8_t size);
+// Writes the reply to the master that sent sequence, returns its size
+uint8_t split_slave_reply(split_slave_t* slave, uint8_t sequence, uint8_t* reply);
+
+void split_master_init(split_master_t* master);
+// Writes the next request, returns its size. With force_state the state
+// is sent even when the slave already has it.
+uint8_t split_master_request(split_master_t* master, const split_state_t* state,
+                             bool force_state, uint8_t* request);
+// The number of reply bytes that follow a reply header
+uint8_t split_reply_rows_size(uint8_t mask);
+// Takes in the reply to the last request, returns false if it is broken
+bool split_master_reply(split_master_t* master, const uint8_t* reply, uint8_t size);
+// Called when an exchange failed. The rows are kept, the slave works out
+// what the master is missing from the sequence of the next request.
+void split_master_error(split_master_t* master);
+// Forgets the slave rows, the next reply brings all of them
+void split_master_reset(split_master_t* master);
+
+#endif
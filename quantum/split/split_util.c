@@ -7,13 +7,9 @@
 #include "split_util.h"
 #include "matrix.h"
 #include "keyboard.h"
+#include "timer.h"
 #include "config.h"
-
-#ifdef USE_I2C
-#  include "i2c.h"
-#else
-#  include "serial.h"
-#endif
+#include "transport.h"
 
 volatile bool isLeftHand = true;
 
@@ -30,19 +26,11 @@ static void setup_handedness(void) {
 }
 
 static void keyboard_master_setup(void) {
-#ifdef USE_I2C
-    i2c_master_init();
-#else
-    serial_master_init();
-#endif
+    transport_master_init();
 }
 
 static void keyboard_slave_setup(void) {
-#ifdef USE_I2C
-    i2c_slave_init(SLAVE_I2C_ADDRESS);
-#else
-    serial_slave_init();
-#endif
+    transport_slave_init();
 }
 
 bool has_usb(void) {
@@ -63,6 +51,8 @@ void split_keyboard_setup(void) {
 }
 
 void keyboard_slave_loop(void) {
+   // the slave never reaches keyboard_init, but debouncing needs the timer
+   timer_init();
    matrix_init();
 
    while (1) {
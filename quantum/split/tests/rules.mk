@@ -0,0 +1,14 @@
+split_serial_frame_SRC := \
+	$(SPLIT_PATH)/tests/serial_frame_tests.cpp \
+	$(SPLIT_PATH)/serial_frame.c
+
+split_protocol_SRC := \
+	$(SPLIT_PATH)/tests/split_protocol_tests.cpp \
+	$(SPLIT_PATH)/split_protocol.c
+split_protocol_INC := $(TMK_PATH)/common
+split_protocol_CONFIG := $(SPLIT_PATH)/tests/split_config.h
+
+split_protocol_sync_SRC := $(split_protocol_SRC)
+split_protocol_sync_INC := $(TMK_PATH)/common
+split_protocol_sync_CONFIG := $(SPLIT_PATH)/tests/split_config.h
+split_protocol_sync_DEFS := -DSPLIT_SYNC_LEDS -DSPLIT_SYNC_LAYERS
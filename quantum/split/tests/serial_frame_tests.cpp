@@ -0,0 +1,255 @@
+#include "gtest/gtest.h"
+#include <deque>
+#include <functional>
+#include <vector>
+extern "C" {
+#include "split/serial_frame.h"
+}
+
+/* Loopback simulation of a half duplex link
+ *
+ * Whatever the master sends is fed byte by byte into the slave, the way the
+ * slave's receive interrupt would, and the reply the slave produces is
+ * queued for the master to read. A hook can corrupt or drop bytes on the
+ * way in either direction.
+ */
+static serial_frame_slave_t slave;
+static std::deque<uint8_t> to_master;
+static std::function<bool(std::vector<uint8_t>&)> corrupt_request;
+static std::function<bool(std::vector<uint8_t>&)> corrupt_reply;
+static int requests_sent;
+
+static void loopback_send(const uint8_t* frame, uint8_t size) {
+    requests_sent++;
+    // transactions are always separated by an idle line
+    serial_frame_slave_idle(&slave);
+    std::vector<uint8_t> request(frame, frame + size);
+    if (corrupt_request && !corrupt_request(request)) {
+        return;
+    }
+    for (uint8_t byte : request) {
+        uint8_t reply_size = serial_frame_slave_receive(&slave, byte);
+        if (reply_size) {
+            std::vector<uint8_t> reply(slave.reply, slave.reply + reply_size);
+            if (corrupt_reply && !corrupt_reply(reply)) {
+                continue;
+            }
+            to_master.insert(to_master.end(), reply.begin(), reply.end());
+        }
+    }
+}
+
+static bool loopback_receive(uint8_t* byte) {
+    if (to_master.empty()) {
+        return false;
+    }
+    *byte = to_master.front();
+    to_master.pop_front();
+    return true;
+}
+
+static const serial_frame_phy_t loopback = { loopback_send, loopback_receive };
+
+class SerialFrame : public testing::Test {
+public:
+    SerialFrame() {
+        to_master.clear();
+        corrupt_request = nullptr;
+        corrupt_reply = nullptr;
+        requests_sent = 0;
+        stats = {};
+        for (uint8_t i = 0; i < sizeof(slave_rows); i++) {
+            slave_rows[i] = 0x11 * (i + 1);
+            master_copy[i] = 0;
+        }
+        master_leds[0] = 0x05;
+        slave_leds[0] = 0;
+        serial_frame_slave_init(&slave, slave_leds, sizeof(slave_leds), slave_rows, sizeof(slave_rows));
+    }
+
+    int transaction() {
+        return serial_frame_transaction(&loopback, master_leds, sizeof(master_leds),
+            master_copy, sizeof(master_copy), &stats);
+    }
+
+    void expect_rows_copied() {
+        for (uint8_t i = 0; i < sizeof(slave_rows); i++) {
+            EXPECT_EQ(master_copy[i], slave_rows[i]) << "row " << (int)i;
+        }
+    }
+
+    volatile uint8_t slave_rows[4];
+    volatile uint8_t master_copy[4];
+    volatile uint8_t master_leds[1];
+    volatile uint8_t slave_leds[1];
+    serial_frame_stats_t stats;
+};
+
+TEST_F(SerialFrame, encodes_marker_payload_and_crc) {
+    const uint8_t payload[] = {1, 2, 3};
+    uint8_t frame[sizeof(payload) + SERIAL_FRAME_OVERHEAD];
+    EXPECT_EQ(serial_frame_encode(frame, SERIAL_FRAME_REQUEST, payload, sizeof(payload)), sizeof(frame));
+    EXPECT_EQ(frame[0], SERIAL_FRAME_REQUEST);
+    EXPECT_EQ(frame[1], 1);
+    EXPECT_EQ(frame[3], 3);
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < sizeof(frame) - 1; i++) {
+        crc = serial_frame_crc8(crc, frame[i]);
+    }
+    EXPECT_EQ(frame[sizeof(frame) - 1], crc);
+}
+
+TEST_F(SerialFrame, clamps_oversized_payloads) {
+    uint8_t payload[SERIAL_FRAME_MAX_PAYLOAD + 4] = {};
+    uint8_t frame[SERIAL_FRAME_MAX_PAYLOAD + SERIAL_FRAME_OVERHEAD + 1];
+    frame[sizeof(frame) - 1] = 0xEE;
+    EXPECT_EQ(serial_frame_encode(frame, SERIAL_FRAME_REQUEST, payload, sizeof(payload)),
+        SERIAL_FRAME_MAX_PAYLOAD + SERIAL_FRAME_OVERHEAD);
+    EXPECT_EQ(frame[sizeof(frame) - 1], 0xEE);
+    serial_frame_receiver_t receiver;
+    serial_frame_receiver_init(&receiver, SERIAL_FRAME_REQUEST, sizeof(payload));
+    EXPECT_EQ(receiver.size, SERIAL_FRAME_MAX_PAYLOAD);
+}
+
+TEST_F(SerialFrame, receiver_skips_bytes_before_the_marker) {
+    const uint8_t payload[] = {0xA5, 0x5A, 0x00};
+    uint8_t frame[sizeof(payload) + SERIAL_FRAME_OVERHEAD];
+    serial_frame_encode(frame, SERIAL_FRAME_REPLY, payload, sizeof(payload));
+    serial_frame_receiver_t receiver;
+    serial_frame_receiver_init(&receiver, SERIAL_FRAME_REPLY, sizeof(payload));
+    EXPECT_EQ(serial_frame_receive(&receiver, 0x00), SERIAL_FRAME_INCOMPLETE);
+    EXPECT_EQ(serial_frame_receive(&receiver, 0xFF), SERIAL_FRAME_INCOMPLETE);
+    for (uint8_t i = 0; i < sizeof(frame) - 1; i++) {
+        EXPECT_EQ(serial_frame_receive(&receiver, frame[i]), SERIAL_FRAME_INCOMPLETE);
+    }
+    EXPECT_EQ(serial_frame_receive(&receiver, frame[sizeof(frame) - 1]), SERIAL_FRAME_OK);
+    EXPECT_EQ(receiver.data[0], 0xA5);
+    EXPECT_EQ(receiver.data[1], 0x5A);
+}
+
+TEST_F(SerialFrame, detects_every_single_bit_error) {
+    const uint8_t payload[] = {0x12, 0x34, 0x56, 0x78};
+    uint8_t frame[sizeof(payload) + SERIAL_FRAME_OVERHEAD];
+    serial_frame_encode(frame, SERIAL_FRAME_REPLY, payload, sizeof(payload));
+    // the marker is left alone, a broken marker is never seen as a frame
+    for (uint8_t byte = 1; byte < sizeof(frame); byte++) {
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            serial_frame_receiver_t receiver;
+            serial_frame_receiver_init(&receiver, SERIAL_FRAME_REPLY, sizeof(payload));
+            serial_frame_status_t status = SERIAL_FRAME_INCOMPLETE;
+            for (uint8_t i = 0; i < sizeof(frame); i++) {
+                status = serial_frame_receive(&receiver, i == byte ? frame[i] ^ (1 << bit) : frame[i]);
+            }
+            EXPECT_EQ(status, SERIAL_FRAME_BAD) << "byte " << (int)byte << " bit " << (int)bit;
+        }
+    }
+}
+
+TEST_F(SerialFrame, transaction_copies_both_buffers) {
+    EXPECT_EQ(transaction(), 0);
+    expect_rows_copied();
+    EXPECT_EQ(slave_leds[0], 0x05);
+    EXPECT_EQ(requests_sent, 1);
+    EXPECT_EQ(stats.transactions, 1);
+    EXPECT_EQ(stats.retries, 0);
+    EXPECT_EQ(stats.failures, 0);
+}
+
+TEST_F(SerialFrame, retries_after_a_corrupted_reply) {
+    int replies = 0;
+    corrupt_reply = [&replies](std::vector<uint8_t>& reply) {
+        if (replies++ == 0) {
+            reply[2] ^= 0x10;
+        }
+        return true;
+    };
+    EXPECT_EQ(transaction(), 0);
+    expect_rows_copied();
+    EXPECT_EQ(requests_sent, 2);
+    EXPECT_EQ(stats.retries, 1);
+    EXPECT_EQ(stats.checksum_errors, 1);
+    EXPECT_EQ(stats.timeouts, 0);
+}
+
+TEST_F(SerialFrame, gives_up_right_away_when_no_reply_arrives) {
+    int replies = 0;
+    corrupt_reply = [&replies](std::vector<uint8_t>&) {
+        return replies++ != 0;
+    };
+    EXPECT_EQ(transaction(), 1);
+    EXPECT_EQ(requests_sent, 1);
+    EXPECT_EQ(stats.retries, 0);
+    EXPECT_EQ(stats.timeouts, 1);
+    EXPECT_EQ(stats.failures, 1);
+
+    EXPECT_EQ(transaction(), 0);
+    expect_rows_copied();
+}
+
+TEST_F(SerialFrame, retries_after_a_truncated_reply) {
+    int replies = 0;
+    corrupt_reply = [&replies](std::vector<uint8_t>& reply) {
+        if (replies++ == 0) {
+            reply.resize(3);
+        }
+        return true;
+    };
+    EXPECT_EQ(transaction(), 0);
+    expect_rows_copied();
+    EXPECT_EQ(stats.retries, 1);
+    EXPECT_EQ(stats.timeouts, 1);
+}
+
+TEST_F(SerialFrame, slave_ignores_a_corrupted_request) {
+    int requests = 0;
+    corrupt_request = [&requests](std::vector<uint8_t>& request) {
+        if (requests++ == 0) {
+            request[1] ^= 0x01;
+        }
+        return true;
+    };
+    // the slave stays quiet, so the master doesn't retry
+    EXPECT_EQ(transaction(), 1);
+    EXPECT_EQ(slave.checksum_errors, 1);
+    EXPECT_EQ(slave_leds[0], 0);
+    EXPECT_EQ(stats.timeouts, 1);
+
+    EXPECT_EQ(transaction(), 0);
+    EXPECT_EQ(slave_leds[0], 0x05);
+    expect_rows_copied();
+}
+
+TEST_F(SerialFrame, gives_up_after_the_retries) {
+    corrupt_reply = [](std::vector<uint8_t>& reply) {
+        reply.back() ^= 0xFF;
+        return true;
+    };
+    EXPECT_EQ(transaction(), 1);
+    for (uint8_t i = 0; i < sizeof(master_copy); i++) {
+        EXPECT_EQ(master_copy[i], 0);
+    }
+    EXPECT_EQ(requests_sent, SERIAL_FRAME_RETRIES + 1);
+    EXPECT_EQ(stats.retries, SERIAL_FRAME_RETRIES);
+    EXPECT_EQ(stats.checksum_errors, SERIAL_FRAME_RETRIES + 1);
+    EXPECT_EQ(stats.failures, 1);
+
+    corrupt_reply = nullptr;
+    EXPECT_EQ(transaction(), 0);
+    expect_rows_copied();
+    EXPECT_EQ(stats.transactions, 2);
+}
+
+TEST_F(SerialFrame, recovers_from_line_noise_between_transactions) {
+    for (int i = 0; i < 100; i++) {
+        // noise ending in a marker would put the slave in the middle of a frame
+        for (uint8_t byte : {0x00, 0xFF, SERIAL_FRAME_REQUEST}) {
+            serial_frame_slave_receive(&slave, byte);
+        }
+        slave_rows[i % sizeof(slave_rows)] = i;
+        master_leds[0] = i;
+        EXPECT_EQ(transaction(), 0);
+        expect_rows_copied();
+        EXPECT_EQ(slave_leds[0], i);
+    }
+    EXPECT_EQ(stats.failures, 0);
+}
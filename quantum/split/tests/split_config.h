@@ -0,0 +1,9 @@
+/* Config for running the split protocol on the host */
+#ifndef SPLIT_TEST_CONFIG_H
+#define SPLIT_TEST_CONFIG_H
+
+// 12 columns make the rows two bytes wide
+#define MATRIX_ROWS 10
+#define MATRIX_COLS 12
+
+#endif
@@ -0,0 +1,199 @@
+#include "gtest/gtest.h"
+#include <random>
+extern "C" {
+#include "split/split_protocol.h"
+}
+
+/* The exchanges are run the way the I2C backend does: the slave answers the
+ * sequence number in the request and the master gets the reply as it was
+ * sent, unless it is dropped.
+ */
+class SplitProtocol : public testing::Test {
+public:
+    SplitProtocol() {
+        split_slave_init(&slave);
+        split_master_init(&master);
+        memset(rows, 0, sizeof(rows));
+        state = {};
+    }
+
+    bool exchange(bool deliver = true) {
+        uint8_t request[SPLIT_REQUEST_MAX];
+        uint8_t reply[SPLIT_REPLY_MAX];
+        request_size = split_master_request(&master, &state, false, request);
+        split_slave_request(&slave, request, request_size);
+        reply_size = split_slave_reply(&slave, request[0], reply);
+        if (!deliver) {
+            split_master_error(&master);
+            return false;
+        }
+        return split_master_reply(&master, reply, reply_size);
+    }
+
+    void set_row(uint8_t row, matrix_row_t value) {
+        rows[row] = value;
+        split_slave_set_rows(&slave, rows);
+    }
+
+    void expect_synced() {
+        for (uint8_t i = 0; i < SPLIT_ROWS; i++) {
+            EXPECT_EQ(master.rows[i], rows[i]) << "row " << (int)i;
+        }
+    }
+
+    split_slave_t slave;
+    split_master_t master;
+    matrix_row_t rows[SPLIT_ROWS];
+    split_state_t state;
+    uint8_t request_size;
+    uint8_t reply_size;
+};
+
+TEST_F(SplitProtocol, first_reply_has_all_rows) {
+    set_row(0, 0x0801);
+    set_row(4, 0x0F00);
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(reply_size, SPLIT_REPLY_MAX);
+    EXPECT_EQ(master.stats.full, 1);
+    expect_synced();
+}
+
+TEST_F(SplitProtocol, unchanged_rows_are_not_sent) {
+    set_row(1, 0x0002);
+    EXPECT_TRUE(exchange());
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(exchange());
+        EXPECT_EQ(reply_size, SPLIT_REPLY_HEADER);
+    }
+    EXPECT_EQ(master.stats.unchanged, 10);
+    expect_synced();
+}
+
+TEST_F(SplitProtocol, only_changed_rows_are_sent) {
+    EXPECT_TRUE(exchange());
+    set_row(2, 0x0004);
+    set_row(3, 0x0100);
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(reply_size, SPLIT_REPLY_HEADER + 2 * SPLIT_ROW_SIZE);
+    EXPECT_EQ(master.stats.delta_rows, 2);
+    expect_synced();
+
+    // a row that changes back within one exchange is not sent
+    set_row(2, 0x0000);
+    set_row(2, 0x0004);
+    set_row(1, 0x0800);
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(reply_size, SPLIT_REPLY_HEADER + SPLIT_ROW_SIZE);
+    expect_synced();
+}
+
+TEST_F(SplitProtocol, lost_reply_is_made_up_for) {
+    EXPECT_TRUE(exchange());
+    set_row(0, 0x0001);
+    EXPECT_FALSE(exchange(false));
+    // the slave can't know what the master missed, so it sends everything
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(reply_size, SPLIT_REPLY_MAX);
+    expect_synced();
+    EXPECT_EQ(master.stats.errors, 1);
+}
+
+TEST_F(SplitProtocol, lost_reply_without_changes_keeps_the_rows) {
+    set_row(3, 0x0030);
+    EXPECT_TRUE(exchange());
+    EXPECT_FALSE(exchange(false));
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(reply_size, SPLIT_REPLY_HEADER);
+    expect_synced();
+}
+
+TEST_F(SplitProtocol, reset_brings_all_rows_again) {
+    set_row(4, 0x0ABC);
+    EXPECT_TRUE(exchange());
+    split_master_reset(&master);
+    EXPECT_EQ(master.rows[4], 0);
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(reply_size, SPLIT_REPLY_MAX);
+    expect_synced();
+}
+
+TEST_F(SplitProtocol, broken_replies_are_rejected) {
+    set_row(0, 0x0001);
+    EXPECT_TRUE(exchange());
+    const uint8_t mask_out_of_range[] = {(uint8_t)(SPLIT_ALL_ROWS + 1), 5};
+    EXPECT_FALSE(split_master_reply(&master, mask_out_of_range, sizeof(mask_out_of_range)));
+    const uint8_t short_rows[] = {0x01, 5, 0xFF};
+    EXPECT_FALSE(split_master_reply(&master, short_rows, sizeof(short_rows)));
+    const uint8_t no_sequence[] = {0x00, 0};
+    EXPECT_FALSE(split_master_reply(&master, no_sequence, sizeof(no_sequence)));
+    EXPECT_FALSE(split_master_reply(&master, short_rows, 1));
+    expect_synced();
+    EXPECT_EQ(master.stats.errors, 4);
+}
+
+TEST_F(SplitProtocol, fixed_size_replies_are_skipped_when_unchanged) {
+    // the serial backend always sends all rows
+    uint8_t reply[SPLIT_REPLY_MAX];
+    set_row(1, 0x0010);
+    EXPECT_EQ(split_slave_reply(&slave, 0, reply), SPLIT_REPLY_MAX);
+    EXPECT_TRUE(split_master_reply(&master, reply, sizeof(reply)));
+    EXPECT_EQ(split_slave_reply(&slave, 0, reply), SPLIT_REPLY_MAX);
+    EXPECT_TRUE(split_master_reply(&master, reply, sizeof(reply)));
+    EXPECT_EQ(master.stats.full, 1);
+    EXPECT_EQ(master.stats.unchanged, 1);
+    expect_synced();
+}
+
+TEST_F(SplitProtocol, sequence_skips_zero) {
+    EXPECT_TRUE(exchange());
+    for (int i = 0; i < 600; i++) {
+        set_row(0, i);
+        EXPECT_NE(slave.sequence, 0);
+        EXPECT_TRUE(exchange());
+        EXPECT_EQ(master.sequence, slave.sequence);
+    }
+    expect_synced();
+}
+
+TEST_F(SplitProtocol, state_is_sent_when_it_changes) {
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(request_size, SPLIT_REQUEST_MAX);
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(request_size, 1);
+
+    state.leds = 0x02;
+    state.layers = 0x00010004;
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(request_size, SPLIT_REQUEST_MAX);
+    EXPECT_EQ(slave.state_changed, SPLIT_REQUEST_STATE_SIZE != 0);
+#ifdef SPLIT_SYNC_LEDS
+    EXPECT_EQ(slave.state.leds, 0x02);
+#endif
+#ifdef SPLIT_SYNC_LAYERS
+    EXPECT_EQ(slave.state.layers, 0x00010004);
+#endif
+}
+
+TEST_F(SplitProtocol, state_is_sent_again_after_a_lost_exchange) {
+    EXPECT_TRUE(exchange());
+    state.leds = 0x04;
+    EXPECT_FALSE(exchange(false));
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(request_size, SPLIT_REQUEST_MAX);
+    EXPECT_TRUE(exchange());
+    EXPECT_EQ(request_size, 1);
+}
+
+TEST_F(SplitProtocol, random_changes_and_losses_stay_in_sync) {
+    std::mt19937 rng(1234);
+    for (int i = 0; i < 5000; i++) {
+        if (rng() % 2) {
+            set_row(rng() % SPLIT_ROWS, rng() & 0x0FFF);
+        }
+        if (exchange(rng() % 8 != 0)) {
+            expect_synced();
+        }
+    }
+    EXPECT_GT(master.stats.delta_rows, 0);
+    EXPECT_GT(master.stats.unchanged, 0);
+}
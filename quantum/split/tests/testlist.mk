@@ -0,0 +1,4 @@
+TEST_LIST +=\
+	split_serial_frame\
+	split_protocol\
+	split_protocol_sync
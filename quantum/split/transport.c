@@ -0,0 +1,187 @@
+#include <string.h>
+#include <util/atomic.h>
+#include "transport.h"
+#include "split_util.h"
+#include "host.h"
+#include "led.h"
+#include "action_layer.h"
+#include "print.h"
+
+#ifdef USE_I2C
+#  include "i2c.h"
+#else // USE_SERIAL
+#  include "serial.h"
+#endif
+
+static split_master_t master;
+static split_slave_t slave;
+
+static void current_state(split_state_t* state) {
+    state->leds = host_keyboard_leds();
+    state->layers = layer_state;
+}
+
+static void apply_state(const split_state_t* state) {
+#ifdef SPLIT_SYNC_LEDS
+    led_set(state->leds);
+#endif
+#if defined(SPLIT_SYNC_LAYERS) && !defined(NO_ACTION_LAYER)
+    layer_state = state->layers;
+#endif
+    (void)state;
+}
+
+#ifdef USE_I2C
+
+void transport_master_init(void) {
+    i2c_master_init();
+}
+
+void transport_slave_init(void) {
+    split_slave_init(&slave);
+    i2c_slave_init(SLAVE_I2C_ADDRESS);
+}
+
+// Called from the TWI interrupt when the master turns around to read
+uint8_t i2c_slave_reply(const uint8_t* request, uint8_t size, uint8_t* reply) {
+    split_slave_request(&slave, request, size);
+    return split_slave_reply(&slave, size ? request[0] : 0, reply);
+}
+
+static bool exchange(void) {
+    uint8_t request[SPLIT_REQUEST_MAX];
+    uint8_t reply[SPLIT_REPLY_MAX];
+    split_state_t state;
+
+    current_state(&state);
+    uint8_t request_size = split_master_request(&master, &state, false, request);
+
+    int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
+    if (err) goto i2c_error;
+
+    for (uint8_t i = 0; i < request_size; i++) {
+        err = i2c_master_write(request[i]);
+        if (err) goto i2c_error;
+    }
+
+    err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_READ);
+    if (err) goto i2c_error;
+
+    // the mask tells how much follows, a broken one ends the read early
+    reply[0] = i2c_master_read(I2C_ACK);
+    uint8_t reply_size = SPLIT_REPLY_HEADER;
+    if (!(reply[0] & ~SPLIT_ALL_ROWS)) {
+        reply_size += split_reply_rows_size(reply[0]);
+    }
+    for (uint8_t i = 1; i < reply_size; i++) {
+        reply[i] = i2c_master_read(i < reply_size - 1 ? I2C_ACK : I2C_NACK);
+    }
+    i2c_master_stop();
+
+    return split_master_reply(&master, reply, reply_size);
+
+i2c_error: // the cable is disconnceted, or something else went wrong
+    i2c_reset_state();
+    split_master_error(&master);
+    return false;
+}
+
+void transport_slave(const matrix_row_t* rows) {
+    bool changed;
+    split_state_t state;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        split_slave_set_rows(&slave, rows);
+        changed = slave.state_changed;
+        state = slave.state;
+        slave.state_changed = false;
+    }
+    if (changed) {
+        apply_state(&state);
+    }
+}
+
+#else // USE_SERIAL
+
+void transport_master_init(void) {
+    serial_master_init();
+}
+
+void transport_slave_init(void) {
+    split_slave_init(&slave);
+    // the master must not take the empty buffer for rows
+    split_slave_reply(&slave, 0, (uint8_t*)serial_slave_buffer);
+    serial_slave_init();
+}
+
+static bool exchange(void) {
+    split_state_t state;
+
+    // the buffers have a fixed size, the state goes along every time
+    current_state(&state);
+    split_master_request(&master, &state, true, (uint8_t*)serial_master_buffer);
+
+    if (serial_update_buffers()) {
+        split_master_error(&master);
+        return false;
+    }
+    return split_master_reply(&master, (const uint8_t*)serial_slave_buffer,
+                              SERIAL_SLAVE_BUFFER_LENGTH);
+}
+
+void transport_slave(const matrix_row_t* rows) {
+    bool changed;
+    split_state_t state;
+
+    // the PHY sends from an interrupt, it must never see half a buffer
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (split_slave_set_rows(&slave, rows)) {
+            split_slave_reply(&slave, 0, (uint8_t*)serial_slave_buffer);
+        }
+        split_slave_request(&slave, (const uint8_t*)serial_master_buffer,
+                            SERIAL_MASTER_BUFFER_LENGTH);
+        changed = slave.state_changed;
+        state = slave.state;
+        slave.state_changed = false;
+    }
+    if (changed) {
+        apply_state(&state);
+    }
+}
+
+#endif
+
+bool transport_master(matrix_row_t* rows) {
+    if (!exchange()) {
+        return false;
+    }
+    memcpy(rows, master.rows, sizeof(master.rows));
+    return true;
+}
+
+void transport_master_reset(void) {
+    split_master_reset(&master);
+}
+
+split_stats_t transport_stats(void) {
+    return master.stats;
+}
+
+void transport_print_stats(void) {
+    split_stats_t stats = transport_stats();
+    print("split: exchanges "); print_dec(stats.exchanges);
+    print(" unchanged "); print_dec(stats.unchanged);
+    print(" delta rows "); print_dec(stats.delta_rows);
+    print(" full "); print_dec(stats.full);
+    print(" errors "); print_dec(stats.errors);
+    print("\n");
+#if !defined(USE_I2C) && (defined(SERIAL_PHY_USART) || defined(SERIAL_PHY_ICP))
+    serial_frame_stats_t serial = serial_stats();
+    print("serial: transactions "); print_dec(serial.transactions);
+    print(" retries "); print_dec(serial.retries);
+    print(" timeouts "); print_dec(serial.timeouts);
+    print(" checksum errors "); print_dec(serial.checksum_errors);
+    print(" failures "); print_dec(serial.failures);
+    print("\n");
+#endif
+}
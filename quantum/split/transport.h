@@ -0,0 +1,39 @@
+#ifndef SPLIT_TRANSPORT_H
+#define SPLIT_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+#include "split_protocol.h"
+
+/* Link between the halves of a split keyboard
+ *
+ * The backend is picked in config.h:
+ *
+ * USE_I2C     TWI, the slave answers at SLAVE_I2C_ADDRESS
+ * USE_SERIAL  single wire, see serial.h for the PHYs
+ *
+ * Over I2C the master only reads the rows that changed since its last
+ * exchange, the serial PHYs move fixed size frames and always carry all of
+ * them. Define SPLIT_SYNC_LEDS and SPLIT_SYNC_LAYERS to forward the host
+ * LEDs and layer_state to the slave, where led_set() is called and
+ * layer_state is updated whenever they change.
+ */
+
+void transport_master_init(void);
+void transport_slave_init(void);
+
+// Exchanges with the slave and copies its SPLIT_ROWS rows to rows.
+// Returns false and leaves rows alone when the slave did not answer.
+bool transport_master(matrix_row_t* rows);
+// Forgets the slave rows after a disconnect
+void transport_master_reset(void);
+
+// Publishes the rows of the slave half and applies the forwarded state
+void transport_slave(const matrix_row_t* rows);
+
+split_stats_t transport_stats(void);
+// Also prints the frame counters of the serial link when it sends frames
+void transport_print_stats(void);
+
+#endif
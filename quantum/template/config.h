@@ -48,6 +48,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /* COL2ROW or ROW2COL */
 #define DIODE_DIRECTION COL2ROW
+
+/* Settle time in us after selecting a row/col, lower it to scan faster */
+//#define MATRIX_IO_DELAY 30
+/* Select the next row while the current one is decoded */
+//#define MATRIX_SELECT_PIPELINE
+/* Measure the lines on first boot and raise the settle time for slow ones,
+ * up to MATRIX_SETTLE_MAX, keeping the result in eeconfig */
+//#define MATRIX_SETTLE_CALIBRATION
  
 // #define BACKLIGHT_PIN B7
 // #define BACKLIGHT_BREATHING
@@ -60,6 +68,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* define if matrix has ghost (lacks anti-ghosting diodes) */
 //#define MATRIX_HAS_GHOST
 
+/*
+ * Process up to this many changed keys per matrix scan instead of one.
+ * All events of a scan carry that scan's timestamp and are processed in
+ * row/column order. Useful for chording (steno) and fast rolls.
+ */
+//#define QMK_KEYS_PER_SCAN 4
+
+/* Keep a RAM bitmap of the transparent keys of the lowest layers so the active
+ * layer of a key is found without reading the keymap. Costs
+ * MATRIX_ROWS * MATRIX_COLS bytes for 8 layers, twice that for 16.
+ */
+//#define LAYER_OPAQUE_CACHE
+//#define LAYER_OPAQUE_CACHE_LAYERS 8
+
+/* Layout of the PREVENT_STUCK_MODIFIERS cache of the layer each key was pressed
+ * on. The default packs MAX_LAYER_BITS (5) bits per key; bytes are fastest,
+ * nibbles hold up to 16 layers and refuse a MAX_LAYER_BITS above 4.
+ */
+//#define SOURCE_LAYERS_CACHE_BYTES
+//#define SOURCE_LAYERS_CACHE_NIBBLES
+
 /* number of backlight levels */
 
 /* Mechanical locking support. Use KC_LCAP, KC_LNUM or KC_LSCR instead in keymap */
@@ -0,0 +1,31 @@
+/* Cycle counter for the benchmarks of the native tests
+ *
+ * read_cycles() reads the time stamp counter on x86. Anywhere else it falls
+ * back to the nanoseconds of the steady clock, CYCLES_UNIT says which one a
+ * benchmark printed.
+ */
+#ifndef TESTS_CYCLES_H
+#define TESTS_CYCLES_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+#define CYCLES_UNIT "cycles"
+
+static inline uint64_t read_cycles() {
+    return __rdtsc();
+}
+#else
+#include <chrono>
+
+#define CYCLES_UNIT "ns"
+
+static inline uint64_t read_cycles() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#endif
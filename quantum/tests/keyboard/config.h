@@ -0,0 +1,27 @@
+/* Config of the simulated keyboard the action pipeline runs on in the
+ * keyboard tests. Everything that touches hardware is replaced by the fakes
+ * in test_keyboard.cpp.
+ */
+#ifndef KEYBOARD_TEST_CONFIG_H
+#define KEYBOARD_TEST_CONFIG_H
+
+#include <stdint.h>
+
+#define MATRIX_ROWS 4
+#define MATRIX_COLS 10
+
+#define TAPPING_TERM 200
+#define ONESHOT_TIMEOUT 500
+
+#define NO_PRINT
+#define NO_DEBUG
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+
+#define wait_ms(ms)
+#define wait_us(us)
+
+#endif
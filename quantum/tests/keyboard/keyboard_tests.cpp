@@ -0,0 +1,114 @@
+#include "test_keyboard.h"
+#include <cstdio>
+#include "tests/cycles.h"
+extern "C" {
+#include "quantum.h"
+}
+
+class Keyboard : public TestKeyboard {
+};
+
+TEST_F(Keyboard, sends_a_tapped_key) {
+    play("A");
+    expect_reports({ { KC_A }, {} });
+}
+
+TEST_F(Keyboard, sends_keys_held_together) {
+    play("+A +B -A -B");
+    expect_reports({ { KC_A }, { KC_A, KC_B }, { KC_B }, {} });
+}
+
+TEST_F(Keyboard, processes_keys_changed_in_one_scan) {
+    play("+A+B");
+#if QMK_KEYS_PER_SCAN
+    expect_reports({ { KC_A }, { KC_A, KC_B } });
+#else
+    // the second key waits for the next scan
+    expect_reports({ { KC_A } });
+    idle(1);
+    expect_reports({ { KC_A, KC_B } });
+#endif
+    play("-A-B 1");
+    expect_reports({ { KC_B }, {} });
+}
+
+TEST_F(Keyboard, sends_modified_keycodes) {
+    play("EXLM");
+    expect_reports({ { KC_LSFT }, { KC_LSFT, KC_1 }, { KC_LSFT }, {} });
+}
+
+TEST_F(Keyboard, switches_momentary_layer) {
+    play("+LOWER A C B -LOWER A");
+    expect_reports({ { KC_1 }, {}, { KC_3 }, {}, { KC_B }, {}, { KC_A }, {} });
+}
+
+TEST_F(Keyboard, releases_on_the_layer_pressed_on) {
+    play("+LOWER +A -LOWER -A");
+    expect_reports({ { KC_1 }, {} });
+}
+
+TEST_F(Keyboard, toggles_layer) {
+    play("TG_RS A TG_RS A");
+    expect_reports({ { KC_LEFT }, {}, { KC_A }, {} });
+}
+
+TEST_F(Keyboard, taps_layer_tap_key) {
+    play("LT_SPC");
+    expect_reports({ { KC_SPC }, {} });
+}
+
+TEST_F(Keyboard, holds_layer_tap_key) {
+    play("+LT_SPC 250 A -LT_SPC");
+    expect_reports({ { KC_LEFT }, {} });
+}
+
+TEST_F(Keyboard, taps_mod_tap_key) {
+    play("CT_ESC");
+    expect_reports({ { KC_ESC }, {} });
+}
+
+TEST_F(Keyboard, holds_mod_tap_key) {
+    play("+CT_ESC 250 A -CT_ESC");
+    expect_reports({ { KC_LCTRL }, { KC_LCTRL, KC_A }, { KC_LCTRL }, {} });
+}
+
+TEST_F(Keyboard, applies_one_shot_mod_to_next_key) {
+    play("OS_SFT 10 A 10 A");
+    expect_reports({ { KC_LSFT, KC_A }, {}, { KC_A }, {} });
+}
+
+TEST_F(Keyboard, times_out_one_shot_mod) {
+    play("OS_SFT 600 A");
+    expect_reports({ { KC_A }, {} });
+}
+
+TEST_F(Keyboard, dances_single_tap) {
+    play("TD_AB 250");
+    expect_reports({ { KC_A }, {} });
+}
+
+TEST_F(Keyboard, dances_double_tap) {
+    play("TD_AB 20 TD_AB 250");
+    expect_reports({ { KC_B }, {} });
+}
+
+TEST_F(Keyboard, benchmark_cycles_per_event) {
+    const char *scripts[][2] = {
+        { "plain keys", "A B C D +A +B -A -B" },
+        { "layers", "+LOWER A C -LOWER TG_RS A B TG_RS" },
+        { "mod and layer tap", "+CT_ESC 250 A -CT_ESC +LT_SPC 250 A -LT_SPC LT_SPC 250" },
+        { "one shot", "OS_SFT A OS_SFT 600" },
+        { "tap dance", "TD_AB 20 TD_AB 250" },
+    };
+
+    for (auto script : scripts) {
+        play(script[1]);
+        event_cycles = 0;
+        events = 0;
+        for (int i = 0; i < 200; i++) {
+            play(script[1]);
+        }
+        take_reports();
+        printf("%-18s %6llu %s/event\n", script[0], (unsigned long long)(event_cycles / events), CYCLES_UNIT);
+    }
+}
@@ -0,0 +1,54 @@
+#include "quantum.h"
+#include "test_keyboard.h"
+
+enum test_layers {
+    _BASE,
+    _LOWER,
+    _RAISE,
+};
+
+enum test_tap_dances {
+    TD_A_B,
+};
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [_BASE] = {
+        { KC_A,    KC_B,           KC_C,             KC_D,         KC_E,      KC_F, KC_G, KC_H, KC_I, KC_J },
+        { KC_LSFT, LSFT(KC_1),     LT(_RAISE, KC_SPC), CTL_T(KC_ESC), OSM(MOD_LSFT), KC_NO, KC_NO, KC_NO, KC_NO, KC_NO },
+        { MO(_LOWER), TG(_RAISE),  TD(TD_A_B),       KC_NO,        KC_NO,     KC_NO, KC_NO, KC_NO, KC_NO, KC_NO },
+        { KC_NO,   KC_NO,          KC_NO,            KC_NO,        KC_NO,     KC_NO, KC_NO, KC_NO, KC_NO, KC_NO },
+    },
+    [_LOWER] = {
+        { KC_1,    KC_TRNS,        KC_3,             KC_TRNS,      KC_TRNS,   KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS },
+        { KC_TRNS, KC_TRNS,        KC_TRNS,          KC_TRNS,      KC_TRNS,   KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS },
+        { KC_TRNS, KC_TRNS,        KC_TRNS,          KC_TRNS,      KC_TRNS,   KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS },
+        { KC_TRNS, KC_TRNS,        KC_TRNS,          KC_TRNS,      KC_TRNS,   KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS },
+    },
+    [_RAISE] = {
+        { KC_LEFT, KC_DOWN,        KC_UP,            KC_RGHT,      KC_TRNS,   KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS },
+        { KC_TRNS, KC_TRNS,        KC_TRNS,          KC_TRNS,      KC_TRNS,   KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS },
+        { KC_TRNS, KC_TRNS,        KC_TRNS,          KC_TRNS,      KC_TRNS,   KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS },
+        { KC_TRNS, KC_TRNS,        KC_TRNS,          KC_TRNS,      KC_TRNS,   KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS, KC_TRNS },
+    },
+};
+
+qk_tap_dance_action_t tap_dance_actions[] = {
+    [TD_A_B] = ACTION_TAP_DANCE_DOUBLE(KC_A, KC_B),
+};
+
+/* names used by the test scripts */
+const test_key_t test_keys[] = {
+    { "A",      { .col = 0, .row = 0 } },
+    { "B",      { .col = 1, .row = 0 } },
+    { "C",      { .col = 2, .row = 0 } },
+    { "D",      { .col = 3, .row = 0 } },
+    { "LSFT",   { .col = 0, .row = 1 } },
+    { "EXLM",   { .col = 1, .row = 1 } },
+    { "LT_SPC", { .col = 2, .row = 1 } },
+    { "CT_ESC", { .col = 3, .row = 1 } },
+    { "OS_SFT", { .col = 4, .row = 1 } },
+    { "LOWER",  { .col = 0, .row = 2 } },
+    { "TG_RS",  { .col = 1, .row = 2 } },
+    { "TD_AB",  { .col = 2, .row = 2 } },
+    { NULL },
+};
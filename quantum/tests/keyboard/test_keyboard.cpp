@@ -0,0 +1,226 @@
+#include "test_keyboard.h"
+#include <cstring>
+#include <sstream>
+#include "tests/cycles.h"
+extern "C" {
+#include "quantum.h"
+#include "host.h"
+#include "action_tapping.h"
+}
+
+/* Fake timer, only moves when the simulator says so */
+extern "C" {
+volatile uint32_t timer_count;
+
+void timer_init(void) {}
+void timer_clear(void) { timer_count = 0; }
+uint16_t timer_read(void) { return timer_count & 0xFFFF; }
+uint32_t timer_read32(void) { return timer_count; }
+uint16_t timer_elapsed(uint16_t last) { return TIMER_DIFF_16(timer_read(), last); }
+uint32_t timer_elapsed32(uint32_t last) { return TIMER_DIFF_32(timer_read32(), last); }
+}
+
+/* Fake matrix, holds the keys the script has pressed */
+static matrix_row_t fake_matrix[MATRIX_ROWS];
+static bool fake_matrix_changed;
+
+extern "C" {
+__attribute__ ((weak))
+void matrix_init_kb(void) { matrix_init_user(); }
+__attribute__ ((weak))
+void matrix_scan_kb(void) { matrix_scan_user(); }
+__attribute__ ((weak))
+void matrix_init_user(void) {}
+__attribute__ ((weak))
+void matrix_scan_user(void) {}
+
+uint8_t matrix_rows(void) { return MATRIX_ROWS; }
+uint8_t matrix_cols(void) { return MATRIX_COLS; }
+void matrix_init(void) {
+    memset(fake_matrix, 0, sizeof(fake_matrix));
+    matrix_init_quantum();
+}
+uint8_t matrix_scan(void) {
+    matrix_scan_quantum();
+    return 1;
+}
+bool matrix_is_on(uint8_t row, uint8_t col) { return fake_matrix[row] & ((matrix_row_t)1 << col); }
+matrix_row_t matrix_get_row(uint8_t row) { return fake_matrix[row]; }
+void matrix_print(void) {}
+void matrix_power_up(void) {}
+void matrix_power_down(void) {}
+}
+
+/* Fake EEPROM */
+static uint8_t fake_eeprom[1024];
+
+extern "C" {
+uint8_t eeprom_read_byte(const uint8_t *p) { return fake_eeprom[(uintptr_t)p]; }
+uint16_t eeprom_read_word(const uint16_t *p) {
+    uint16_t value;
+    memcpy(&value, &fake_eeprom[(uintptr_t)p], sizeof(value));
+    return value;
+}
+uint32_t eeprom_read_dword(const uint32_t *p) {
+    uint32_t value;
+    memcpy(&value, &fake_eeprom[(uintptr_t)p], sizeof(value));
+    return value;
+}
+void eeprom_read_block(void *dst, const void *src, uint32_t n) { memcpy(dst, &fake_eeprom[(uintptr_t)src], n); }
+void eeprom_write_byte(uint8_t *p, uint8_t value) { fake_eeprom[(uintptr_t)p] = value; }
+void eeprom_write_word(uint16_t *p, uint16_t value) { memcpy(&fake_eeprom[(uintptr_t)p], &value, sizeof(value)); }
+void eeprom_write_dword(uint32_t *p, uint32_t value) { memcpy(&fake_eeprom[(uintptr_t)p], &value, sizeof(value)); }
+void eeprom_write_block(const void *src, void *dst, uint32_t n) { memcpy(&fake_eeprom[(uintptr_t)dst], src, n); }
+void eeprom_update_byte(uint8_t *p, uint8_t value) { eeprom_write_byte(p, value); }
+void eeprom_update_word(uint16_t *p, uint16_t value) { eeprom_write_word(p, value); }
+void eeprom_update_dword(uint32_t *p, uint32_t value) { eeprom_write_dword(p, value); }
+void eeprom_update_block(const void *src, void *dst, uint32_t n) { eeprom_write_block(src, dst, n); }
+
+void bootloader_jump(void) {}
+}
+
+/* Fake host driver, records every keyboard report that changes what the host sees */
+static std::vector<TestReport> sent_reports;
+static TestReport last_report;
+
+static uint8_t fake_keyboard_leds(void) { return 0; }
+
+static void fake_send_keyboard(report_keyboard_t *report) {
+    TestReport keys;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (report->mods & (1 << i)) {
+            keys.insert(KC_LCTRL + i);
+        }
+    }
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (report->keys[i]) {
+            keys.insert(report->keys[i]);
+        }
+    }
+    if (keys != last_report) {
+        sent_reports.push_back(keys);
+        last_report = keys;
+    }
+}
+
+static void fake_send_mouse(report_mouse_t *report) {}
+static void fake_send_system(uint16_t data) {}
+static void fake_send_consumer(uint16_t data) {}
+
+static host_driver_t fake_driver = {
+    fake_keyboard_leds,
+    fake_send_keyboard,
+    fake_send_mouse,
+    fake_send_system,
+    fake_send_consumer,
+};
+
+static keypos_t find_key(const char *name) {
+    for (const test_key_t *key = test_keys; key->name; key++) {
+        if (strcmp(key->name, name) == 0) {
+            return key->key;
+        }
+    }
+    ADD_FAILURE() << "unknown key " << name;
+    return (keypos_t){ .col = 0, .row = 0 };
+}
+
+TestKeyboard::TestKeyboard() : event_cycles(0), events(0) {
+    memset(fake_eeprom, 0xFF, sizeof(fake_eeprom));
+    timer_count = 1;
+    host_set_driver(&fake_driver);
+    keyboard_init();
+    layer_clear();
+    sent_reports.clear();
+    last_report.clear();
+}
+
+TestKeyboard::~TestKeyboard() {
+    /* let the keyboard settle so the next test starts from a clean state */
+    memset(fake_matrix, 0, sizeof(fake_matrix));
+    fake_matrix_changed = true;
+    idle(TAPPING_TERM * 2);
+    clear_keyboard();
+    layer_clear();
+}
+
+void TestKeyboard::press(const char *name) {
+    keypos_t key = find_key(name);
+    fake_matrix[key.row] |= (matrix_row_t)1 << key.col;
+    fake_matrix_changed = true;
+    idle(1);
+}
+
+void TestKeyboard::release(const char *name) {
+    keypos_t key = find_key(name);
+    fake_matrix[key.row] &= ~((matrix_row_t)1 << key.col);
+    fake_matrix_changed = true;
+    idle(1);
+}
+
+void TestKeyboard::change(const std::string &keys) {
+    size_t start = 0;
+    while (start < keys.size()) {
+        size_t end = keys.find_first_of("+-", start + 1);
+        if (end == std::string::npos) {
+            end = keys.size();
+        }
+        keypos_t key = find_key(keys.substr(start + 1, end - start - 1).c_str());
+        if (keys[start] == '+') {
+            fake_matrix[key.row] |= (matrix_row_t)1 << key.col;
+        } else {
+            fake_matrix[key.row] &= ~((matrix_row_t)1 << key.col);
+        }
+        start = end;
+    }
+    fake_matrix_changed = true;
+    idle(1);
+}
+
+void TestKeyboard::tap(const char *name) {
+    press(name);
+    release(name);
+}
+
+void TestKeyboard::idle(uint16_t ms) {
+    for (uint16_t i = 0; i < ms; i++) {
+        timer_count++;
+        if (fake_matrix_changed) {
+            fake_matrix_changed = false;
+            uint64_t start = read_cycles();
+            keyboard_task();
+            event_cycles += read_cycles() - start;
+            events++;
+        } else {
+            keyboard_task();
+        }
+    }
+}
+
+void TestKeyboard::play(const std::string &script) {
+    std::istringstream tokens(script);
+    std::string token;
+    while (tokens >> token) {
+        if ((token[0] == '+' || token[0] == '-') && token.find_first_of("+-", 1) != std::string::npos) {
+            change(token);
+        } else if (token[0] == '+') {
+            press(token.c_str() + 1);
+        } else if (token[0] == '-') {
+            release(token.c_str() + 1);
+        } else if (isdigit(token[0])) {
+            idle(std::stoi(token));
+        } else {
+            tap(token.c_str());
+        }
+    }
+}
+
+std::vector<TestReport> TestKeyboard::take_reports() {
+    std::vector<TestReport> reports;
+    reports.swap(sent_reports);
+    return reports;
+}
+
+void TestKeyboard::expect_reports(const std::vector<TestReport> &expected) {
+    EXPECT_EQ(take_reports(), expected);
+}
@@ -0,0 +1,60 @@
+/* Keyboard simulator for the native tests
+ *
+ * tmk_core and quantum run unchanged on top of a fake timer, matrix, EEPROM
+ * and host driver. Key events are written as a script of space separated
+ * tokens, keys are named in test_keys[] of the keymap:
+ *   +NAME   press the key
+ *   -NAME   release the key
+ *   +A+B-C  press A and B and release C, all before the same scan
+ *   NAME    tap the key, press and release it one scan later
+ *   100     let 100 ms pass, one matrix scan per ms
+ * Each press or release token is followed by one scan. That processes a
+ * single change, unless QMK_KEYS_PER_SCAN lets the scan take more.
+ */
+#ifndef TEST_KEYBOARD_H
+#define TEST_KEYBOARD_H
+
+#include "keyboard.h"
+
+typedef struct {
+    const char *name;
+    keypos_t key;
+} test_key_t;
+
+/* terminated by an entry with a NULL name */
+extern const test_key_t test_keys[];
+
+#ifdef __cplusplus
+#include <set>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+/* keycodes in a keyboard report, modifiers as KC_LCTRL ... KC_RGUI */
+typedef std::set<uint8_t> TestReport;
+
+class TestKeyboard : public testing::Test {
+public:
+    TestKeyboard();
+    ~TestKeyboard();
+
+    void press(const char *name);
+    void release(const char *name);
+    /* "+A+B-C", applied to the matrix at once */
+    void change(const std::string &keys);
+    void tap(const char *name);
+    /* one matrix scan and keyboard_task() per ms */
+    void idle(uint16_t ms);
+    void play(const std::string &script);
+
+    /* keyboard reports sent since the last call, reports that change nothing are dropped */
+    std::vector<TestReport> take_reports();
+    void expect_reports(const std::vector<TestReport> &expected);
+
+    /* time spent in keyboard_task() for scans that found a key event */
+    uint64_t event_cycles;
+    uint32_t events;
+};
+#endif
+
+#endif
@@ -0,0 +1,29 @@
+/* Config for running quantum/matrix.c on the host.
+ * The AVR I/O space is replaced by a mocked register file, see matrix_tests.cpp
+ */
+#ifndef MATRIX_TEST_CONFIG_H
+#define MATRIX_TEST_CONFIG_H
+
+#include <stdint.h>
+#include "config_common.h"
+
+#define MATRIX_ROWS 5
+#define MATRIX_COLS 12
+#define MATRIX_ROW_PINS { D0, D5, B5, B6, D1 }
+#define MATRIX_COL_PINS { F1, F0, B0, C7, F4, F5, F6, F7, D4, D6, B4, D7 }
+
+#define DEBOUNCING_DELAY 0
+
+#define NO_PRINT
+#define NO_DEBUG
+
+#define wait_us(us)
+#define _BV(bit) (1 << (bit))
+#define _SFR_IO8(addr) (*mock_sfr_io8(addr))
+
+#ifdef __cplusplus
+extern "C"
+#endif
+volatile uint8_t* mock_sfr_io8(uint8_t addr);
+
+#endif
@@ -0,0 +1,192 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+extern "C" {
+#include "matrix.h"
+}
+
+/* Mocked AVR I/O space: PINx, DDRx and PORTx for ports A-F
+ * Reading a PINx register recomputes it from the DDR/PORT state and the keys
+ * held down, so the scanner sees the same thing as on a real switch matrix.
+ */
+static uint8_t io_registers[0x12];
+static uint32_t pin_reads;
+static bool keys[MATRIX_ROWS][MATRIX_COLS];
+
+static const uint8_t test_row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
+static const uint8_t test_col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
+
+static bool is_driven_low(uint8_t pin) {
+    uint8_t port = pin >> 4;
+    uint8_t bit = _BV(pin & 0xF);
+    return (io_registers[port + 1] & bit) && !(io_registers[port + 2] & bit);
+}
+
+static void pull_low(uint8_t pin) {
+    io_registers[pin >> 4] &= ~_BV(pin & 0xF);
+}
+
+static void update_pin_registers() {
+    for (uint8_t port = 0; port < sizeof(io_registers); port += 3) {
+        io_registers[port] = io_registers[port + 2];
+    }
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (keys[row][col]) {
+                if (is_driven_low(test_row_pins[row])) {
+                    pull_low(test_col_pins[col]);
+                }
+                if (is_driven_low(test_col_pins[col])) {
+                    pull_low(test_row_pins[row]);
+                }
+            }
+        }
+    }
+}
+
+extern "C" volatile uint8_t* mock_sfr_io8(uint8_t addr) {
+    if (addr % 3 == 0) {
+        pin_reads++;
+        update_pin_registers();
+    }
+    return &io_registers[addr];
+}
+
+/* The scanner as it was before sense ports were grouped: one PINx read per
+ * pin. Used as the reference for both the results and the cost.
+ */
+static void reference_select(uint8_t pin) {
+    _SFR_IO8((pin >> 4) + 1) |=  _BV(pin & 0xF);
+    _SFR_IO8((pin >> 4) + 2) &= ~_BV(pin & 0xF);
+}
+
+static void reference_unselect(uint8_t pin) {
+    _SFR_IO8((pin >> 4) + 1) &= ~_BV(pin & 0xF);
+    _SFR_IO8((pin >> 4) + 2) |=  _BV(pin & 0xF);
+}
+
+static void reference_scan(matrix_row_t result[]) {
+#if (DIODE_DIRECTION == COL2ROW)
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        result[row] = 0;
+        reference_select(test_row_pins[row]);
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            uint8_t pin = test_col_pins[col];
+            uint8_t pin_state = (_SFR_IO8(pin >> 4) & _BV(pin & 0xF));
+            result[row] |= pin_state ? 0 : ((matrix_row_t)1 << col);
+        }
+        reference_unselect(test_row_pins[row]);
+    }
+#else
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        result[row] = 0;
+    }
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        reference_select(test_col_pins[col]);
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            uint8_t pin = test_row_pins[row];
+            if ((_SFR_IO8(pin >> 4) & _BV(pin & 0xF)) == 0) {
+                result[row] |= ((matrix_row_t)1 << col);
+            }
+        }
+        reference_unselect(test_col_pins[col]);
+    }
+#endif
+}
+
+class Matrix : public testing::Test {
+public:
+    Matrix() {
+        memset(io_registers, 0, sizeof(io_registers));
+        memset(keys, 0, sizeof(keys));
+        matrix_init();
+        pin_reads = 0;
+    }
+
+    void expect_matrix_equals_keys() {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            matrix_row_t expected = 0;
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                if (keys[row][col]) {
+                    expected |= (matrix_row_t)1 << col;
+                }
+            }
+            EXPECT_EQ(matrix_get_row(row), expected) << "row " << (int)row;
+        }
+    }
+
+    void set_random_keys(std::mt19937& rng) {
+        std::bernoulli_distribution pressed(0.2);
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                keys[row][col] = pressed(rng);
+            }
+        }
+    }
+};
+
+TEST_F(Matrix, reads_no_keys) {
+    matrix_scan();
+    expect_matrix_equals_keys();
+}
+
+TEST_F(Matrix, reads_every_single_key) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            keys[row][col] = true;
+            matrix_scan();
+            expect_matrix_equals_keys();
+            keys[row][col] = false;
+        }
+    }
+    matrix_scan();
+    expect_matrix_equals_keys();
+}
+
+TEST_F(Matrix, matches_per_pin_scan) {
+    std::mt19937 rng(1234);
+    matrix_row_t reference[MATRIX_ROWS];
+    for (int i = 0; i < 200; i++) {
+        set_random_keys(rng);
+        matrix_scan();
+        reference_scan(reference);
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            EXPECT_EQ(matrix_get_row(row), reference[row]);
+        }
+        expect_matrix_equals_keys();
+    }
+}
+
+TEST_F(Matrix, benchmark_against_per_pin_scan) {
+    const int scans = 2000;
+    std::mt19937 rng(5678);
+    set_random_keys(rng);
+    matrix_row_t reference[MATRIX_ROWS];
+
+    pin_reads = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < scans; i++) {
+        reference_scan(reference);
+    }
+    auto reference_time = std::chrono::steady_clock::now() - start;
+    uint32_t reference_reads = pin_reads;
+
+    pin_reads = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < scans; i++) {
+        matrix_scan();
+    }
+    auto grouped_time = std::chrono::steady_clock::now() - start;
+    uint32_t grouped_reads = pin_reads;
+
+    printf("per pin: %u PINx reads/scan, %lld ns/scan\n",
+        reference_reads / scans,
+        (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(reference_time).count() / scans);
+    printf("grouped: %u PINx reads/scan, %lld ns/scan\n",
+        grouped_reads / scans,
+        (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(grouped_time).count() / scans);
+
+    EXPECT_LT(grouped_reads, reference_reads);
+}
@@ -0,0 +1,25 @@
+/* Config of the LED strip the rgblight tests run on. The strip, timer and
+ * EEPROM are replaced by the fakes in rgblight_tests.cpp, RGBLED_NUM comes
+ * from the test target.
+ */
+#ifndef RGBLIGHT_TEST_CONFIG_H
+#define RGBLIGHT_TEST_CONFIG_H
+
+#include <stdint.h>
+
+#ifndef RGBLED_NUM
+#define RGBLED_NUM 16
+#endif
+#define RGBLIGHT_ANIMATIONS
+
+#define NO_PRINT
+#define NO_DEBUG
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+
+#define wait_ms(ms)
+#define wait_us(us)
+
+#endif
@@ -0,0 +1,290 @@
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "tests/cycles.h"
+extern "C" {
+#include "rgblight.h"
+#include "eeprom.h"
+#include "timer.h"
+
+extern rgblight_config_t rgblight_config;
+extern const uint8_t DIM_CURVE[];
+}
+
+typedef std::vector<LED_TYPE> frame_t;
+
+static bool operator==(const LED_TYPE& a, const LED_TYPE& b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static uint16_t fake_time;
+static std::vector<frame_t> sent_frames;
+static uint8_t fake_eeprom[64];
+
+extern "C" {
+uint16_t timer_read(void) { return fake_time; }
+uint16_t timer_elapsed(uint16_t last) { return fake_time - last; }
+
+uint32_t eeprom_read_dword(const uint32_t *p) {
+    uint32_t value;
+    memcpy(&value, &fake_eeprom[(uintptr_t)p], sizeof(value));
+    return value;
+}
+void eeprom_update_dword(uint32_t *p, uint32_t value) { memcpy(&fake_eeprom[(uintptr_t)p], &value, sizeof(value)); }
+bool eeconfig_is_enabled(void) { return true; }
+void eeconfig_init(void) {}
+
+void ws2812_setleds(LED_TYPE *ledarray, uint16_t number_of_leds) {
+    sent_frames.push_back(frame_t(ledarray, ledarray + number_of_leds));
+}
+}
+
+static frame_t current_frame() {
+    return frame_t(led, led + RGBLED_NUM);
+}
+
+// sethsv() before it went table driven
+static LED_TYPE reference_hsv(uint16_t hue, uint8_t sat, uint8_t val) {
+    uint8_t r = 0, g = 0, b = 0, base, color;
+    if (sat == 0) {
+        r = g = b = val;
+    } else {
+        base = ((255 - sat) * val) >> 8;
+        color = (val - base) * (hue % 60) / 60;
+        switch (hue / 60) {
+            case 0: r = val; g = base + color; b = base; break;
+            case 1: r = val - color; g = val; b = base; break;
+            case 2: r = base; g = val; b = base + color; break;
+            case 3: r = base; g = val - color; b = val; break;
+            case 4: r = base + color; g = base; b = val; break;
+            case 5: r = val; g = base; b = val - color; break;
+        }
+    }
+    LED_TYPE result = {};
+    result.r = DIM_CURVE[r];
+    result.g = DIM_CURVE[g];
+    result.b = DIM_CURVE[b];
+    return result;
+}
+
+// The effects as they were drawn with a sethsv() per LED and position
+static frame_t reference_swirl(uint16_t current_hue) {
+    frame_t frame(RGBLED_NUM);
+    for (int i = 0; i < RGBLED_NUM; i++) {
+        frame[i] = reference_hsv((360 / RGBLED_NUM * i + current_hue) % 360, rgblight_config.sat, rgblight_config.val);
+    }
+    return frame;
+}
+
+static frame_t reference_snake(int pos, int increment) {
+    frame_t frame(RGBLED_NUM);
+    for (int i = 0; i < RGBLED_NUM; i++) {
+        for (int j = 0; j < RGBLIGHT_EFFECT_SNAKE_LENGTH; j++) {
+            int k = pos + j * increment;
+            if (k < 0) {
+                k = k + RGBLED_NUM;
+            }
+            if (i == k) {
+                frame[i] = reference_hsv(rgblight_config.hue, rgblight_config.sat,
+                    rgblight_config.val * (RGBLIGHT_EFFECT_SNAKE_LENGTH - j) / RGBLIGHT_EFFECT_SNAKE_LENGTH);
+            }
+        }
+    }
+    return frame;
+}
+
+static frame_t reference_knight(int pos, int increment) {
+    frame_t preled(RGBLED_NUM);
+    for (int i = 0; i < RGBLED_NUM; i++) {
+        for (int j = 0; j < RGBLIGHT_EFFECT_KNIGHT_LENGTH; j++) {
+            int k = pos + j * increment;
+            if (k < 0) {
+                k = 0;
+            }
+            if (k >= RGBLED_NUM) {
+                k = RGBLED_NUM - 1;
+            }
+            if (i == k) {
+                preled[i] = reference_hsv(rgblight_config.hue, rgblight_config.sat, rgblight_config.val);
+            }
+        }
+    }
+    frame_t frame(RGBLED_NUM);
+    for (int i = 0; i < RGBLED_NUM; i++) {
+        frame[i] = preled[(i + RGBLIGHT_EFFECT_KNIGHT_OFFSET) % RGBLED_NUM];
+    }
+    return frame;
+}
+
+class Rgblight : public testing::Test {
+public:
+    Rgblight() {
+        rgblight_config.enable = 1;
+        rgblight_config.mode = 1;
+        rgblight_config.hue = 30;
+        rgblight_config.sat = 255;
+        rgblight_config.val = 255;
+        sent_frames.clear();
+    }
+
+    // Runs an effect for one frame, the effects keep their position in
+    // statics, so the tests look for it in the frame
+    template<typename Effect>
+    frame_t step(Effect effect) {
+        fake_time += 1000;
+        effect();
+        return current_frame();
+    }
+};
+
+TEST_F(Rgblight, hsv_matches_the_division_formula) {
+    for (uint16_t hue = 0; hue < 360; hue++) {
+        for (int sat = 0; sat < 256; sat++) {
+            for (int val = 0; val < 256; val++) {
+                LED_TYPE result;
+                sethsv(hue, sat, val, &result);
+                ASSERT_EQ(result, reference_hsv(hue, sat, val)) << hue << " " << sat << " " << val;
+            }
+        }
+    }
+}
+
+TEST_F(Rgblight, rainbow_swirl_matches_the_reference) {
+    rgblight_config.sat = 200;
+    rgblight_config.val = 180;
+    for (uint8_t interval : {0, 1}) {
+        int last_hue = -1;
+        for (int f = 0; f < 400; f++) {
+            frame_t frame = step([=] { rgblight_effect_rainbow_swirl(interval); });
+            int hue = 0;
+            while (hue < 360 && !(reference_swirl(hue) == frame)) {
+                hue++;
+            }
+            ASSERT_LT(hue, 360) << "frame " << f;
+            if (last_hue >= 0) {
+                EXPECT_EQ(hue, (last_hue + (interval ? 1 : 359)) % 360);
+            }
+            last_hue = hue;
+        }
+    }
+}
+
+TEST_F(Rgblight, snake_matches_the_reference) {
+    rgblight_config.val = 200;
+    for (uint8_t interval : {0, 1}) {
+        int increment = interval ? -1 : 1;
+        for (int f = 0; f < 2 * RGBLED_NUM; f++) {
+            frame_t frame = step([=] { rgblight_effect_snake(interval); });
+            int pos = 0;
+            while (pos < RGBLED_NUM && !(reference_snake(pos, increment) == frame)) {
+                pos++;
+            }
+            ASSERT_LT(pos, RGBLED_NUM) << "frame " << f;
+        }
+    }
+}
+
+TEST_F(Rgblight, knight_matches_the_reference) {
+    const int length = RGBLIGHT_EFFECT_KNIGHT_LENGTH;
+    for (int f = 0; f < 3 * RGBLED_NUM; f++) {
+        frame_t frame = step([] { rgblight_effect_knight(0); });
+        bool found = false;
+        for (int pos = -length; pos <= RGBLED_NUM + length && !found; pos++) {
+            found = reference_knight(pos, 1) == frame || reference_knight(pos, -1) == frame;
+        }
+        ASSERT_TRUE(found) << "frame " << f;
+    }
+}
+
+TEST_F(Rgblight, christmas_alternates_red_and_green) {
+    frame_t first = step([] { rgblight_effect_christmas(); });
+    frame_t second = step([] { rgblight_effect_christmas(); });
+    for (int i = 0; i < RGBLED_NUM; i++) {
+        EXPECT_EQ(first[i], reference_hsv(((RGBLED_NUM * (i + 1)) % 2) * 80, 255, 255));
+        EXPECT_EQ(second[i], reference_hsv(((RGBLED_NUM * i) % 2) * 80, 255, 255));
+    }
+}
+
+#ifdef RGBLIGHT_FRAME_CACHE
+TEST_F(Rgblight, sends_a_frame_only_once) {
+    rgblight_setrgb(1, 2, 3);
+    rgblight_setrgb(1, 2, 3);
+    ASSERT_EQ(sent_frames.size(), 1);
+    EXPECT_EQ(sent_frames[0], current_frame());
+    led[RGBLED_NUM - 1].b = 4;
+    rgblight_set();
+    ASSERT_EQ(sent_frames.size(), 2);
+    EXPECT_EQ(sent_frames[1][RGBLED_NUM - 1].b, 4);
+}
+#else
+TEST_F(Rgblight, sends_every_frame) {
+    rgblight_setrgb(1, 2, 3);
+    rgblight_setrgb(1, 2, 3);
+    ASSERT_EQ(sent_frames.size(), 2);
+    EXPECT_EQ(sent_frames[1], current_frame());
+}
+#endif
+
+TEST_F(Rgblight, sends_black_when_disabled) {
+    rgblight_setrgb(10, 20, 30);
+    rgblight_config.enable = 0;
+    rgblight_set();
+    ASSERT_FALSE(sent_frames.empty());
+    for (LED_TYPE& l : sent_frames.back()) {
+        EXPECT_EQ(l.r + l.g + l.b, 0);
+    }
+}
+
+#ifdef RGBLIGHT_FRAME_CACHE
+TEST_F(Rgblight, breathing_skips_unchanged_frames) {
+    rgblight_config.val = 80;
+    std::vector<frame_t> changes;
+    for (int f = 0; f < 256; f++) {
+        frame_t frame = step([] { rgblight_effect_breathing(0); });
+        if (changes.empty() || !(changes.back() == frame)) {
+            changes.push_back(frame);
+        }
+    }
+    EXPECT_LT(sent_frames.size(), 256);
+    // The first frame may match what the last test left on the strip
+    ASSERT_GE(sent_frames.size(), changes.size() - 1);
+    EXPECT_TRUE(std::equal(sent_frames.rbegin(), sent_frames.rend(), changes.rbegin()));
+}
+#endif
+
+TEST_F(Rgblight, benchmark_cycles_per_frame) {
+    const int frames = 2000;
+    struct {
+        const char* name;
+        void (*effect)(void);
+    } effects[] = {
+        { "breathing", [] { rgblight_effect_breathing(0); } },
+        { "rainbow mood", [] { rgblight_effect_rainbow_mood(0); } },
+        { "rainbow swirl", [] { rgblight_effect_rainbow_swirl(0); } },
+        { "snake", [] { rgblight_effect_snake(0); } },
+        { "knight", [] { rgblight_effect_knight(0); } },
+        { "christmas", [] { rgblight_effect_christmas(); } },
+    };
+    rgblight_config.val = 128;
+    for (auto& effect : effects) {
+        sent_frames.clear();
+        uint64_t total = 0;
+        for (int f = 0; f < frames; f++) {
+            fake_time += 1000;
+            uint64_t start = read_cycles();
+            effect.effect();
+            total += read_cycles() - start;
+        }
+        printf("RGBLED_NUM %3d %-14s %7llu %s/frame, %4d of %d frames sent\n", RGBLED_NUM, effect.name,
+            (unsigned long long)(total / frames), CYCLES_UNIT, (int)sent_frames.size(), frames);
+    }
+    uint64_t start = read_cycles();
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < RGBLED_NUM; i++) {
+            led[i] = reference_hsv((360 / RGBLED_NUM * i + f) % 360, rgblight_config.sat, rgblight_config.val);
+        }
+    }
+    printf("RGBLED_NUM %3d %-14s %7llu %s/frame, with a division per LED\n", RGBLED_NUM, "rainbow swirl",
+        (unsigned long long)((read_cycles() - start) / frames), CYCLES_UNIT);
+}
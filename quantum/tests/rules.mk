@@ -0,0 +1,76 @@
+QUANTUM_TEST_INC := $(TMK_PATH)/common
+
+quantum_matrix_col2row_SRC := \
+	$(QUANTUM_PATH)/tests/matrix_tests.cpp \
+	$(QUANTUM_PATH)/matrix.c \
+	$(QUANTUM_PATH)/debounce/sym_g.c \
+	$(TMK_PATH)/common/util.c
+quantum_matrix_col2row_INC := $(QUANTUM_TEST_INC)
+quantum_matrix_col2row_CONFIG := $(QUANTUM_PATH)/tests/matrix_config.h
+quantum_matrix_col2row_DEFS := -DDIODE_DIRECTION=COL2ROW
+
+quantum_matrix_row2col_SRC := $(quantum_matrix_col2row_SRC)
+quantum_matrix_row2col_INC := $(QUANTUM_TEST_INC)
+quantum_matrix_row2col_CONFIG := $(QUANTUM_PATH)/tests/matrix_config.h
+quantum_matrix_row2col_DEFS := -DDIODE_DIRECTION=ROW2COL
+
+quantum_matrix_pipeline_SRC := $(quantum_matrix_col2row_SRC)
+quantum_matrix_pipeline_INC := $(QUANTUM_TEST_INC)
+quantum_matrix_pipeline_CONFIG := $(QUANTUM_PATH)/tests/matrix_config.h
+quantum_matrix_pipeline_DEFS := -DDIODE_DIRECTION=COL2ROW -DMATRIX_SELECT_PIPELINE
+
+quantum_keyboard_SRC := \
+	$(QUANTUM_PATH)/tests/keyboard/keyboard_tests.cpp \
+	$(QUANTUM_PATH)/tests/keyboard/test_keyboard.cpp \
+	$(QUANTUM_PATH)/tests/keyboard/keymap.c \
+	$(QUANTUM_PATH)/quantum.c \
+	$(QUANTUM_PATH)/keymap_common.c \
+	$(QUANTUM_PATH)/keycode_config.c \
+	$(QUANTUM_PATH)/process_keycode/process_leader.c \
+	$(QUANTUM_PATH)/process_keycode/process_tap_dance.c \
+	$(TMK_PATH)/common/action.c \
+	$(TMK_PATH)/common/action_layer.c \
+	$(TMK_PATH)/common/action_macro.c \
+	$(TMK_PATH)/common/action_tapping.c \
+	$(TMK_PATH)/common/action_util.c \
+	$(TMK_PATH)/common/debug.c \
+	$(TMK_PATH)/common/eeconfig.c \
+	$(TMK_PATH)/common/host.c \
+	$(TMK_PATH)/common/keyboard.c \
+	$(TMK_PATH)/common/magic.c \
+	$(TMK_PATH)/common/util.c
+quantum_keyboard_INC := \
+	$(QUANTUM_PATH)/tests/keyboard \
+	$(QUANTUM_PATH)/process_keycode \
+	$(QUANTUM_PATH)/keymap_extras \
+	$(TMK_PATH)/common
+quantum_keyboard_CONFIG := $(QUANTUM_PATH)/tests/keyboard/config.h
+# keymap_common.c indexes its empty weak fn_actions, the real keymaps
+# replace it with their own
+quantum_keyboard_DEFS := -DTAP_DANCE_ENABLE -Wno-array-bounds
+
+quantum_keyboard_keys_per_scan_SRC := $(quantum_keyboard_SRC)
+quantum_keyboard_keys_per_scan_INC := $(quantum_keyboard_INC)
+quantum_keyboard_keys_per_scan_CONFIG := $(quantum_keyboard_CONFIG)
+quantum_keyboard_keys_per_scan_DEFS := $(quantum_keyboard_DEFS) -DQMK_KEYS_PER_SCAN=4
+
+quantum_rgblight_SRC := \
+	$(QUANTUM_PATH)/tests/rgblight/rgblight_tests.cpp \
+	$(QUANTUM_PATH)/rgblight.c \
+	$(TMK_PATH)/common/debug.c
+quantum_rgblight_INC := \
+	$(QUANTUM_PATH)/tests/rgblight \
+	$(QUANTUM_PATH) \
+	$(TMK_PATH)/common
+quantum_rgblight_CONFIG := $(QUANTUM_PATH)/tests/rgblight/config.h
+quantum_rgblight_DEFS := -DRGBLIGHT_FRAME_CACHE
+
+quantum_rgblight_64_SRC := $(quantum_rgblight_SRC)
+quantum_rgblight_64_INC := $(quantum_rgblight_INC)
+quantum_rgblight_64_CONFIG := $(quantum_rgblight_CONFIG)
+quantum_rgblight_64_DEFS := -DRGBLED_NUM=64
+
+quantum_rgblight_128_SRC := $(quantum_rgblight_SRC)
+quantum_rgblight_128_INC := $(quantum_rgblight_INC)
+quantum_rgblight_128_CONFIG := $(quantum_rgblight_CONFIG)
+quantum_rgblight_128_DEFS := -DRGBLED_NUM=128
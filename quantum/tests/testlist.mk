@@ -0,0 +1,9 @@
+TEST_LIST +=\
+	quantum_matrix_col2row\
+	quantum_matrix_row2col\
+	quantum_matrix_pipeline\
+	quantum_keyboard\
+	quantum_keyboard_keys_per_scan\
+	quantum_rgblight\
+	quantum_rgblight_64\
+	quantum_rgblight_128
@@ -0,0 +1,226 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "keyframe_scheduler.h"
+
+//#define DEBUG_VISUALIZER
+
+#ifdef DEBUG_VISUALIZER
+#include "debug.h"
+#else
+#include "nodebug.h"
+#endif
+
+// heap_position is 1 based, so that 0 in a statically initialized
+// animation means it isn't running
+static keyframe_animation_t* heap[MAX_SIMULTANEOUS_ANIMATIONS];
+static uint8_t heap_size = 0;
+// The time of the last run, animations started after it are due at once
+static systemticks_t scheduler_time = 0;
+
+static bool due_before(keyframe_animation_t* a, keyframe_animation_t* b) {
+    // The tick counter wraps around
+    return (int32_t)(a->deadline - b->deadline) < 0;
+}
+
+static void heap_set(uint8_t index, keyframe_animation_t* animation) {
+    heap[index] = animation;
+    animation->heap_position = index + 1;
+}
+
+static void sift_up(uint8_t index) {
+    keyframe_animation_t* animation = heap[index];
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!due_before(animation, heap[parent])) {
+            break;
+        }
+        heap_set(index, heap[parent]);
+        index = parent;
+    }
+    heap_set(index, animation);
+}
+
+static void sift_down(uint8_t index) {
+    keyframe_animation_t* animation = heap[index];
+    while (true) {
+        uint8_t child = 2 * index + 1;
+        if (child >= heap_size) {
+            break;
+        }
+        if (child + 1 < heap_size && due_before(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!due_before(heap[child], animation)) {
+            break;
+        }
+        heap_set(index, heap[child]);
+        index = child;
+    }
+    heap_set(index, animation);
+}
+
+static void schedule(keyframe_animation_t* animation, systemticks_t deadline) {
+    animation->deadline = deadline;
+    if (animation->heap_position == 0) {
+        if (heap_size == MAX_SIMULTANEOUS_ANIMATIONS) {
+            return;
+        }
+        heap_set(heap_size++, animation);
+        sift_up(heap_size - 1);
+    }
+    else {
+        sift_up(animation->heap_position - 1);
+        sift_down(animation->heap_position - 1);
+    }
+}
+
+static void unschedule(keyframe_animation_t* animation) {
+    if (animation->heap_position == 0) {
+        return;
+    }
+    uint8_t index = animation->heap_position - 1;
+    animation->heap_position = 0;
+    heap_size--;
+    if (index != heap_size) {
+        // the last one takes its place, and moves whichever way it has to
+        keyframe_animation_t* moved = heap[heap_size];
+        heap_set(index, moved);
+        sift_down(index);
+        sift_up(moved->heap_position - 1);
+    }
+}
+
+void start_keyframe_animation(keyframe_animation_t* animation) {
+    animation->current_frame = -1;
+    animation->time_left_in_frame = 0;
+    animation->need_update = true;
+    animation->last_update = scheduler_time;
+    schedule(animation, scheduler_time);
+}
+
+static void reset_stopped_animation(keyframe_animation_t* animation) {
+    animation->current_frame = animation->num_frames;
+    animation->time_left_in_frame = 0;
+    animation->need_update = true;
+    animation->first_update_of_frame = false;
+    animation->last_update_of_frame = false;
+}
+
+void stop_keyframe_animation(keyframe_animation_t* animation) {
+    reset_stopped_animation(animation);
+    unschedule(animation);
+}
+
+void stop_all_keyframe_animations(void) {
+    while (heap_size) {
+        stop_keyframe_animation(heap[heap_size - 1]);
+    }
+}
+
+static void enter_frame(keyframe_animation_t* animation, int frame, int overshoot) {
+    animation->current_frame = frame;
+    animation->time_left_in_frame = animation->frame_lengths[frame] - overshoot;
+    animation->need_update = true;
+    animation->first_update_of_frame = true;
+}
+
+// Moves the animation delta ticks forward, giving every frame it leaves a last
+// update, then updates the current frame if it asks for it.
+// Returns false when the animation has ended.
+static bool update_keyframe_animation(keyframe_animation_t* animation, visualizer_state_t* state, systemticks_t delta, systemticks_t* sleep_time) {
+    dprintf("Animation frame%d, left %d, delta %d\n", animation->current_frame,
+            animation->time_left_in_frame, delta);
+    if (animation->current_frame == animation->num_frames) {
+        animation->need_update = false;
+        return false;
+    }
+    if (animation->current_frame == -1) {
+        enter_frame(animation, 0, 0);
+    } else {
+        animation->time_left_in_frame -= delta;
+        while (animation->time_left_in_frame <= 0) {
+            int overshoot = -animation->time_left_in_frame;
+            if (animation->need_update) {
+                animation->time_left_in_frame = 0;
+                animation->last_update_of_frame = true;
+                (*animation->frame_functions[animation->current_frame])(animation, state);
+                animation->last_update_of_frame = false;
+            }
+            int next = animation->current_frame + 1;
+            if (next == animation->num_frames) {
+                if (!animation->loop) {
+                    stop_keyframe_animation(animation);
+                    return false;
+                }
+                next = 0;
+            }
+            enter_frame(animation, next, overshoot);
+        }
+    }
+    if (animation->need_update) {
+        animation->need_update = (*animation->frame_functions[animation->current_frame])(animation, state);
+        animation->first_update_of_frame = false;
+    }
+
+    *sleep_time = animation->need_update ? gfxMillisecondsToTicks(10) : (unsigned)animation->time_left_in_frame;
+    return true;
+}
+
+bool run_keyframe_animations(visualizer_state_t* state, systemticks_t now) {
+    scheduler_time = now;
+    // Only the animations that are due now run, the ones they schedule
+    // for now, or that frame functions start, wait for the next run
+    keyframe_animation_t* due[MAX_SIMULTANEOUS_ANIMATIONS];
+    uint8_t num_due = 0;
+    while (heap_size && (int32_t)(heap[0]->deadline - now) <= 0) {
+        due[num_due++] = heap[0];
+        unschedule(heap[0]);
+    }
+    for (uint8_t i = 0; i < num_due; i++) {
+        keyframe_animation_t* animation = due[i];
+        if (animation->heap_position) {
+            // restarted by an earlier frame function in this run
+            continue;
+        }
+        systemticks_t delta = now - animation->last_update;
+        animation->last_update = now;
+        systemticks_t sleep_time;
+        if (update_keyframe_animation(animation, state, delta, &sleep_time)) {
+            // a frame function might have stopped or restarted it
+            if (animation->current_frame != animation->num_frames && animation->heap_position == 0) {
+                schedule(animation, now + sleep_time);
+            }
+        }
+    }
+    return num_due > 0;
+}
+
+bool next_keyframe_deadline(systemticks_t* deadline) {
+    if (heap_size == 0) {
+        return false;
+    }
+    *deadline = heap[0]->deadline;
+    return true;
+}
@@ -0,0 +1,44 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef KEYFRAME_SCHEDULER_H
+#define KEYFRAME_SCHEDULER_H
+
+#include "visualizer.h"
+
+/* The running keyframe animations, in a min-heap ordered by when each of
+ * them next needs an update. That is the end of the current frame, or 10 ms
+ * ahead for frame functions that asked for continuous updates. Starting and
+ * stopping an animation is O(log n), and only the animations that are due
+ * are updated.
+ */
+
+// Updates the animations that are due at now, returns true if any was
+bool run_keyframe_animations(visualizer_state_t* state, systemticks_t now);
+// Returns false if no animation is running, otherwise sets deadline to
+// when the next one is due, which can be in the past
+bool next_keyframe_deadline(systemticks_t* deadline);
+void stop_all_keyframe_animations(void);
+
+#endif
@@ -0,0 +1,95 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "led_autoplay.h"
+#include "config.h"
+#ifdef PROTOCOL_CHIBIOS
+#include "ch.h"
+#endif
+
+#ifndef LED_FRAME_BANKS
+#define LED_FRAME_BANKS 0
+#endif
+
+static bool playing = false;
+
+static uint16_t ticks_to_ms(int ticks) {
+#ifdef PROTOCOL_CHIBIOS
+    // Like in the visualizer thread, there's no generic ugfx conversion
+    return ST2MS(ticks);
+#else
+    return ticks;
+#endif
+}
+
+static bool fits_in_banks(keyframe_animation_t* animation) {
+    if (animation->num_frames < 1 || animation->num_frames > LED_FRAME_BANKS) {
+        return false;
+    }
+    // The controller shows every frame for the same time
+    for (int i = 1; i < animation->num_frames; i++) {
+        if (animation->frame_lengths[i] != animation->frame_lengths[0]) {
+            return false;
+        }
+    }
+    return animation->frame_lengths[0] > 0;
+}
+
+bool start_led_autoplay(keyframe_animation_t* animation, visualizer_state_t* state, uint16_t breathe_time) {
+    if (!fits_in_banks(animation)) {
+        start_keyframe_animation(animation);
+        return false;
+    }
+    stop_keyframe_animation(animation);
+
+    for (int i = 0; i < animation->num_frames; i++) {
+        keyframe_animation_t temp_animation = *animation;
+        temp_animation.current_frame = i;
+        temp_animation.time_left_in_frame = animation->frame_lengths[i];
+        temp_animation.first_update_of_frame = true;
+        temp_animation.last_update_of_frame = false;
+        temp_animation.need_update = false;
+        visualizer_state_t temp_state = *state;
+        (*animation->frame_functions[i])(&temp_animation, &temp_state);
+        gdispGControl(LED_DISPLAY, GDISP_CONTROL_LED_STORE_FRAME, (void*)(size_t)i);
+    }
+
+    led_autoplay_t autoplay = {
+        .first_bank = 0,
+        .num_frames = animation->num_frames,
+        .loops = animation->loop ? 0 : 1,
+        .frame_time = ticks_to_ms(animation->frame_lengths[0]),
+        .breathe_time = breathe_time,
+    };
+    gdispGControl(LED_DISPLAY, GDISP_CONTROL_LED_AUTOPLAY, &autoplay);
+    playing = true;
+    return true;
+}
+
+void stop_led_autoplay(void) {
+    if (playing) {
+        gdispGControl(LED_DISPLAY, GDISP_CONTROL_LED_AUTOPLAY, NULL);
+        playing = false;
+    }
+}
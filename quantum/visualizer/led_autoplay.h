@@ -0,0 +1,70 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef TMK_VISUALIZER_LED_AUTOPLAY_H_
+#define TMK_VISUALIZER_LED_AUTOPLAY_H_
+
+#include "visualizer.h"
+
+/* Hardware playback of LED animations
+ *
+ * Some LED controllers, like the IS31FL3731C, have frame banks that they
+ * can play on their own. An animation of still frames of the same length
+ * can be rendered into the banks once, and is then played by the
+ * controller. The visualizer thread does nothing and the bus stays quiet
+ * until something else is drawn on the LED display, which stops the
+ * playback.
+ *
+ * The keyboard tells how many banks its LED display has for this with
+ * LED_FRAME_BANKS in config.h. Without it, or when an animation doesn't
+ * fit, the animation is run as a normal keyframe animation instead.
+ */
+
+// Control codes of the LED display driver, for gdispGControl
+// Copies what is drawn on the display to the bank in value
+#define GDISP_CONTROL_LED_STORE_FRAME   (GDISP_CONTROL_LLD + 0)
+// Starts playing the led_autoplay_t in value, or stops playing if it's NULL
+#define GDISP_CONTROL_LED_AUTOPLAY      (GDISP_CONTROL_LLD + 1)
+
+typedef struct {
+    uint8_t first_bank;
+    uint8_t num_frames;
+    // 0 plays the frames until stopped
+    uint8_t loops;
+    uint16_t frame_time;
+    // Fades each frame in and out, 0 shows the frames steadily
+    uint16_t breathe_time;
+} led_autoplay_t;
+
+// Renders the frames of the animation into the frame banks and lets the
+// LED controller play them, with the length of the first frame for all of
+// them. Every frame function is called once, as if at the start of its
+// frame. Returns false if the animation was started as a keyframe
+// animation instead. All times are in milliseconds.
+bool start_led_autoplay(keyframe_animation_t* animation, visualizer_state_t* state, uint16_t breathe_time);
+// Stops the playback, the LEDs show the last frame of the animation, or
+// what was drawn after starting it
+void stop_led_autoplay(void);
+
+#endif /* TMK_VISUALIZER_LED_AUTOPLAY_H_ */
@@ -0,0 +1,7 @@
+/* Config for running the visualizer on the host */
+#ifndef VISUALIZER_TEST_CONFIG_H
+#define VISUALIZER_TEST_CONFIG_H
+
+#define LED_FRAME_BANKS 6
+
+#endif
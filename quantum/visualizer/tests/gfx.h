@@ -0,0 +1,19 @@
+/* The parts of ugfx the visualizer tests need, for running on the host */
+#ifndef VISUALIZER_TEST_GFX_H
+#define VISUALIZER_TEST_GFX_H
+
+#include <stdint.h>
+
+typedef uint32_t systemticks_t;
+typedef struct GDisplay GDisplay;
+typedef void* font_t;
+
+#define TIME_INFINITE ((systemticks_t)-1)
+// One tick is one millisecond
+#define gfxMillisecondsToTicks(ms) ((systemticks_t)(ms))
+
+#define GDISP_CONTROL_LLD 1000
+// Implemented by the tests
+void gdispGControl(GDisplay* g, unsigned what, void* value);
+
+#endif
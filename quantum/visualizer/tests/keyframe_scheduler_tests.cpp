@@ -0,0 +1,242 @@
+#include "gtest/gtest.h"
+#include <vector>
+extern "C" {
+#include "keyframe_scheduler.h"
+}
+
+struct FrameCall {
+    keyframe_animation_t* animation;
+    int frame;
+    systemticks_t time;
+    bool first;
+    bool last;
+};
+
+static std::vector<FrameCall> calls;
+static systemticks_t current_time;
+
+static void record(keyframe_animation_t* animation) {
+    calls.push_back({animation, animation->current_frame, current_time,
+                     animation->first_update_of_frame, animation->last_update_of_frame});
+}
+
+static bool once(keyframe_animation_t* animation, visualizer_state_t* state) {
+    (void)state;
+    record(animation);
+    return false;
+}
+
+static bool continuous(keyframe_animation_t* animation, visualizer_state_t* state) {
+    (void)state;
+    record(animation);
+    return true;
+}
+
+class KeyframeScheduler : public testing::Test {
+public:
+    KeyframeScheduler() {
+        calls.clear();
+        state = {};
+        num_animations = 0;
+        run_at(0);
+    }
+
+    ~KeyframeScheduler() {
+        stop_all_keyframe_animations();
+    }
+
+    // The scheduler keeps pointers to the running animations, so they live
+    // as long as the fixture does
+    keyframe_animation_t* make_animation(std::initializer_list<int> lengths,
+                                         frame_func function = once) {
+        keyframe_animation_t* animation = &animations[num_animations++];
+        *animation = {};
+        for (int length : lengths) {
+            animation->frame_lengths[animation->num_frames] = length;
+            animation->frame_functions[animation->num_frames] = function;
+            animation->num_frames++;
+        }
+        return animation;
+    }
+
+    bool run_at(systemticks_t time) {
+        current_time = time;
+        return run_keyframe_animations(&state, time);
+    }
+
+    // Runs the scheduler the way the visualizer thread does, waking up only
+    // at the deadlines it asks for
+    void run_until(systemticks_t end) {
+        systemticks_t deadline;
+        while (next_keyframe_deadline(&deadline) && (int32_t)(deadline - end) <= 0) {
+            EXPECT_TRUE(run_at(deadline));
+        }
+    }
+
+    std::vector<systemticks_t> call_times(keyframe_animation_t* animation) {
+        std::vector<systemticks_t> times;
+        for (auto& call : calls) {
+            if (call.animation == animation) {
+                times.push_back(call.time);
+            }
+        }
+        return times;
+    }
+
+    visualizer_state_t state;
+    keyframe_animation_t animations[MAX_SIMULTANEOUS_ANIMATIONS + 1];
+    int num_animations;
+};
+
+TEST_F(KeyframeScheduler, frames_are_run_at_their_boundaries) {
+    keyframe_animation_t* animation = make_animation({100, 200, 300});
+    start_keyframe_animation(animation);
+    run_until(10000);
+    ASSERT_EQ(calls.size(), 3);
+    EXPECT_EQ(calls[0].frame, 0);
+    EXPECT_EQ(calls[0].time, 0);
+    EXPECT_EQ(calls[1].frame, 1);
+    EXPECT_EQ(calls[1].time, 100);
+    EXPECT_EQ(calls[2].frame, 2);
+    EXPECT_EQ(calls[2].time, 300);
+    for (auto& call : calls) {
+        EXPECT_TRUE(call.first);
+        EXPECT_FALSE(call.last);
+    }
+    systemticks_t deadline;
+    EXPECT_FALSE(next_keyframe_deadline(&deadline));
+    EXPECT_EQ(animation->current_frame, animation->num_frames);
+}
+
+TEST_F(KeyframeScheduler, deadline_is_the_end_of_the_frame) {
+    keyframe_animation_t* animation = make_animation({100, 200});
+    start_keyframe_animation(animation);
+    systemticks_t deadline;
+    ASSERT_TRUE(next_keyframe_deadline(&deadline));
+    EXPECT_EQ(deadline, 0);
+    EXPECT_TRUE(run_at(0));
+    ASSERT_TRUE(next_keyframe_deadline(&deadline));
+    EXPECT_EQ(deadline, 100);
+}
+
+TEST_F(KeyframeScheduler, late_runs_do_not_shift_the_frames) {
+    keyframe_animation_t* animation = make_animation({100, 200, 300});
+    start_keyframe_animation(animation);
+    EXPECT_TRUE(run_at(0));
+    EXPECT_TRUE(run_at(130));
+    systemticks_t deadline;
+    ASSERT_TRUE(next_keyframe_deadline(&deadline));
+    EXPECT_EQ(deadline, 300);
+}
+
+TEST_F(KeyframeScheduler, nothing_runs_before_the_deadline) {
+    keyframe_animation_t* animation = make_animation({100, 200});
+    start_keyframe_animation(animation);
+    EXPECT_TRUE(run_at(0));
+    EXPECT_FALSE(run_at(50));
+    EXPECT_FALSE(run_at(99));
+    EXPECT_EQ(calls.size(), 1);
+    EXPECT_TRUE(run_at(100));
+    EXPECT_EQ(calls.size(), 2);
+}
+
+TEST_F(KeyframeScheduler, continuous_frames_are_updated_every_10_ms) {
+    keyframe_animation_t* animation = make_animation({50}, continuous);
+    start_keyframe_animation(animation);
+    run_until(10000);
+    std::vector<systemticks_t> expected = {0, 10, 20, 30, 40, 50};
+    EXPECT_EQ(call_times(animation), expected);
+    EXPECT_TRUE(calls.front().first);
+    EXPECT_TRUE(calls.back().last);
+    for (size_t i = 1; i < calls.size() - 1; i++) {
+        EXPECT_FALSE(calls[i].first);
+        EXPECT_FALSE(calls[i].last);
+    }
+}
+
+TEST_F(KeyframeScheduler, only_the_due_animations_are_updated) {
+    keyframe_animation_t* fast = make_animation({100, 100, 100});
+    keyframe_animation_t* slow = make_animation({1000, 1000});
+    start_keyframe_animation(fast);
+    start_keyframe_animation(slow);
+    run_until(1000);
+    std::vector<systemticks_t> fast_times = {0, 100, 200};
+    std::vector<systemticks_t> slow_times = {0, 1000};
+    EXPECT_EQ(call_times(fast), fast_times);
+    EXPECT_EQ(call_times(slow), slow_times);
+}
+
+TEST_F(KeyframeScheduler, stopped_animations_are_not_run) {
+    keyframe_animation_t* first = make_animation({100, 100});
+    keyframe_animation_t* second = make_animation({100, 100});
+    start_keyframe_animation(first);
+    start_keyframe_animation(second);
+    EXPECT_TRUE(run_at(0));
+    stop_keyframe_animation(first);
+    EXPECT_EQ(first->current_frame, first->num_frames);
+    run_until(10000);
+    EXPECT_EQ(call_times(first).size(), 1);
+    EXPECT_EQ(call_times(second).size(), 2);
+}
+
+TEST_F(KeyframeScheduler, restarted_animations_start_over) {
+    keyframe_animation_t* animation = make_animation({100, 100});
+    start_keyframe_animation(animation);
+    EXPECT_TRUE(run_at(0));
+    EXPECT_TRUE(run_at(100));
+    EXPECT_EQ(calls.back().frame, 1);
+    EXPECT_FALSE(run_at(150));
+    start_keyframe_animation(animation);
+    EXPECT_TRUE(run_at(160));
+    EXPECT_EQ(calls.back().frame, 0);
+    systemticks_t deadline;
+    ASSERT_TRUE(next_keyframe_deadline(&deadline));
+    EXPECT_EQ(deadline, 260);
+}
+
+TEST_F(KeyframeScheduler, looping_animations_keep_running) {
+    keyframe_animation_t* animation = make_animation({100, 50});
+    animation->loop = true;
+    start_keyframe_animation(animation);
+    run_until(300);
+    std::vector<systemticks_t> expected = {0, 100, 150, 250, 300};
+    EXPECT_EQ(call_times(animation), expected);
+    EXPECT_EQ(animation->current_frame, 0);
+}
+
+TEST_F(KeyframeScheduler, runs_the_configured_number_of_animations) {
+    for (int i = 0; i < MAX_SIMULTANEOUS_ANIMATIONS + 1; i++) {
+        start_keyframe_animation(make_animation({100 * (MAX_SIMULTANEOUS_ANIMATIONS - i)}));
+    }
+    EXPECT_TRUE(run_at(0));
+    EXPECT_EQ(calls.size(), MAX_SIMULTANEOUS_ANIMATIONS);
+    // the one that didn't fit is never run
+    EXPECT_EQ(animations[MAX_SIMULTANEOUS_ANIMATIONS].current_frame, -1);
+    for (int i = MAX_SIMULTANEOUS_ANIMATIONS - 1; i >= 0; i--) {
+        systemticks_t deadline;
+        ASSERT_TRUE(next_keyframe_deadline(&deadline));
+        EXPECT_EQ(deadline, 100 * (MAX_SIMULTANEOUS_ANIMATIONS - i));
+        EXPECT_TRUE(run_at(deadline));
+        EXPECT_EQ(animations[i].current_frame, animations[i].num_frames);
+    }
+    systemticks_t deadline;
+    EXPECT_FALSE(next_keyframe_deadline(&deadline));
+}
+
+TEST_F(KeyframeScheduler, deadlines_survive_the_tick_counter_wrapping) {
+    const systemticks_t start = 0xFFFFFFFF - 50;
+    run_at(start);
+    keyframe_animation_t* animation = make_animation({100, 100});
+    start_keyframe_animation(animation);
+    keyframe_animation_t* later = make_animation({500});
+    start_keyframe_animation(later);
+    EXPECT_TRUE(run_at(start));
+    systemticks_t deadline;
+    ASSERT_TRUE(next_keyframe_deadline(&deadline));
+    EXPECT_EQ(deadline, start + 100);
+    EXPECT_LT(deadline, start);
+    EXPECT_FALSE(run_at(start + 20));
+    EXPECT_TRUE(run_at(start + 100));
+    EXPECT_EQ(calls.back().animation, animation);
+    EXPECT_EQ(calls.back().frame, 1);
+}
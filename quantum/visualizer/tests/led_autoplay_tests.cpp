@@ -0,0 +1,155 @@
+#include "gtest/gtest.h"
+#include <vector>
+extern "C" {
+#include "config.h"
+#include "led_autoplay.h"
+#include "keyframe_scheduler.h"
+}
+
+GDisplay* LED_DISPLAY = reinterpret_cast<GDisplay*>(0x1ED);
+GDisplay* LCD_DISPLAY = nullptr;
+
+struct Control {
+    unsigned what;
+    size_t bank;
+    // what the frame functions drew last
+    int drawn;
+    bool autoplay;
+    led_autoplay_t config;
+};
+
+static std::vector<Control> controls;
+static int drawn;
+
+extern "C" void gdispGControl(GDisplay* g, unsigned what, void* value) {
+    EXPECT_EQ(g, LED_DISPLAY);
+    Control control = {what, 0, drawn, false, {}};
+    if (what == GDISP_CONTROL_LED_STORE_FRAME) {
+        control.bank = (size_t)value;
+    }
+    else if (value) {
+        control.autoplay = true;
+        control.config = *(led_autoplay_t*)value;
+    }
+    controls.push_back(control);
+}
+
+static bool draw_frame(keyframe_animation_t* animation, visualizer_state_t* state) {
+    // Frames are rendered as they look at their start
+    EXPECT_TRUE(animation->first_update_of_frame);
+    EXPECT_EQ(animation->time_left_in_frame, animation->frame_lengths[animation->current_frame]);
+    state->layer_text = "changed";
+    drawn = animation->current_frame + 1;
+    return false;
+}
+
+class LedAutoplay : public testing::Test {
+public:
+    LedAutoplay() {
+        controls.clear();
+        drawn = 0;
+        state = {};
+        animation = {};
+        run_keyframe_animations(&state, 0);
+    }
+
+    ~LedAutoplay() {
+        stop_led_autoplay();
+        stop_all_keyframe_animations();
+    }
+
+    void make_animation(std::initializer_list<int> lengths, bool loop) {
+        animation = {};
+        animation.loop = loop;
+        for (int length : lengths) {
+            animation.frame_lengths[animation.num_frames] = length;
+            animation.frame_functions[animation.num_frames] = draw_frame;
+            animation.num_frames++;
+        }
+    }
+
+    bool software_animation_running() {
+        systemticks_t deadline;
+        return next_keyframe_deadline(&deadline);
+    }
+
+    keyframe_animation_t animation;
+    visualizer_state_t state;
+};
+
+TEST_F(LedAutoplay, stores_every_frame_and_starts_playing) {
+    make_animation({110, 110, 110}, true);
+    EXPECT_TRUE(start_led_autoplay(&animation, &state, 0));
+    ASSERT_EQ(controls.size(), 4);
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_EQ(controls[i].what, GDISP_CONTROL_LED_STORE_FRAME);
+        EXPECT_EQ(controls[i].bank, i);
+        EXPECT_EQ(controls[i].drawn, i + 1);
+    }
+    EXPECT_EQ(controls[3].what, GDISP_CONTROL_LED_AUTOPLAY);
+    ASSERT_TRUE(controls[3].autoplay);
+    EXPECT_EQ(controls[3].config.first_bank, 0);
+    EXPECT_EQ(controls[3].config.num_frames, 3);
+    EXPECT_EQ(controls[3].config.loops, 0);
+    EXPECT_EQ(controls[3].config.frame_time, 110);
+    EXPECT_EQ(controls[3].config.breathe_time, 0);
+    EXPECT_FALSE(software_animation_running());
+    // the frame functions draw on a copy of the state
+    EXPECT_EQ(state.layer_text, nullptr);
+}
+
+TEST_F(LedAutoplay, plays_animations_that_do_not_loop_once) {
+    make_animation({500, 500}, false);
+    EXPECT_TRUE(start_led_autoplay(&animation, &state, 400));
+    ASSERT_EQ(controls.size(), 3);
+    EXPECT_EQ(controls[2].config.loops, 1);
+    EXPECT_EQ(controls[2].config.breathe_time, 400);
+}
+
+TEST_F(LedAutoplay, fills_all_banks) {
+    make_animation({50, 50, 50, 50, 50, 50}, true);
+    EXPECT_TRUE(start_led_autoplay(&animation, &state, 0));
+    ASSERT_EQ(controls.size(), LED_FRAME_BANKS + 1);
+    EXPECT_EQ(controls[LED_FRAME_BANKS - 1].bank, LED_FRAME_BANKS - 1);
+}
+
+TEST_F(LedAutoplay, too_many_frames_run_as_keyframe_animation) {
+    make_animation({50, 50, 50, 50, 50, 50, 50}, true);
+    EXPECT_FALSE(start_led_autoplay(&animation, &state, 0));
+    EXPECT_TRUE(controls.empty());
+    EXPECT_TRUE(software_animation_running());
+}
+
+TEST_F(LedAutoplay, frames_of_different_lengths_run_as_keyframe_animation) {
+    make_animation({100, 200}, true);
+    EXPECT_FALSE(start_led_autoplay(&animation, &state, 0));
+    EXPECT_TRUE(controls.empty());
+    EXPECT_TRUE(software_animation_running());
+}
+
+TEST_F(LedAutoplay, empty_frames_run_as_keyframe_animation) {
+    make_animation({0, 0}, false);
+    EXPECT_FALSE(start_led_autoplay(&animation, &state, 0));
+    EXPECT_TRUE(controls.empty());
+}
+
+TEST_F(LedAutoplay, replaces_the_keyframe_animation) {
+    make_animation({100, 100}, true);
+    start_keyframe_animation(&animation);
+    EXPECT_TRUE(start_led_autoplay(&animation, &state, 0));
+    EXPECT_FALSE(software_animation_running());
+}
+
+TEST_F(LedAutoplay, stop_is_only_sent_while_playing) {
+    stop_led_autoplay();
+    EXPECT_TRUE(controls.empty());
+    make_animation({100}, true);
+    EXPECT_TRUE(start_led_autoplay(&animation, &state, 0));
+    controls.clear();
+    stop_led_autoplay();
+    ASSERT_EQ(controls.size(), 1);
+    EXPECT_EQ(controls[0].what, GDISP_CONTROL_LED_AUTOPLAY);
+    EXPECT_FALSE(controls[0].autoplay);
+    stop_led_autoplay();
+    EXPECT_EQ(controls.size(), 1);
+}
@@ -0,0 +1,13 @@
+visualizer_keyframe_scheduler_SRC := \
+	$(QUANTUM_PATH)/visualizer/tests/keyframe_scheduler_tests.cpp \
+	$(QUANTUM_PATH)/visualizer/keyframe_scheduler.c
+visualizer_keyframe_scheduler_INC := \
+	$(QUANTUM_PATH)/visualizer/tests \
+	$(QUANTUM_PATH)/visualizer
+visualizer_keyframe_scheduler_DEFS := -DMAX_SIMULTANEOUS_ANIMATIONS=8
+
+visualizer_led_autoplay_SRC := \
+	$(QUANTUM_PATH)/visualizer/tests/led_autoplay_tests.cpp \
+	$(QUANTUM_PATH)/visualizer/led_autoplay.c \
+	$(QUANTUM_PATH)/visualizer/keyframe_scheduler.c
+visualizer_led_autoplay_INC := $(visualizer_keyframe_scheduler_INC)
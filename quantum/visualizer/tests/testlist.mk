@@ -0,0 +1,3 @@
+TEST_LIST +=\
+	visualizer_keyframe_scheduler\
+	visualizer_led_autoplay
@@ -23,6 +23,7 @@ SOFTWARE.
 */
 
 #include "visualizer.h"
+#include "keyframe_scheduler.h"
 #include "config.h"
 #include <string.h>
 #ifdef PROTOCOL_CHIBIOS
@@ -35,6 +36,10 @@ SOFTWARE.
 #include "lcd_backlight.h"
 #endif
 
+#ifdef LED_ENABLE
+#include "led_autoplay.h"
+#endif
+
 //#define DEBUG_VISUALIZER
 
 #ifdef DEBUG_VISUALIZER
@@ -70,8 +75,6 @@ static bool same_status(visualizer_keyboard_status_t* status1, visualizer_keyboa
 
 static bool visualizer_enabled = false;
 
-#define MAX_SIMULTANEOUS_ANIMATIONS 4
-static keyframe_animation_t* animations[MAX_SIMULTANEOUS_ANIMATIONS] = {};
 
 #ifdef SERIAL_LINK_ENABLE
 MASTER_TO_ALL_SLAVES_OBJECT(current_status, visualizer_keyboard_status_t);
@@ -95,104 +98,6 @@ GDisplay* get_led_display(void) {
     return gdispGetDisplay(1);
 }
 
-void start_keyframe_animation(keyframe_animation_t* animation) {
-    animation->current_frame = -1;
-    animation->time_left_in_frame = 0;
-    animation->need_update = true;
-    int free_index = -1;
-    for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
-        if (animations[i] == animation) {
-            return;
-        }
-        if (free_index == -1 && animations[i] == NULL) {
-           free_index=i;
-        }
-    }
-    if (free_index!=-1) {
-        animations[free_index] = animation;
-    }
-}
-
-void stop_keyframe_animation(keyframe_animation_t* animation) {
-    animation->current_frame = animation->num_frames;
-    animation->time_left_in_frame = 0;
-    animation->need_update = true;
-    animation->first_update_of_frame = false;
-    animation->last_update_of_frame = false;
-    for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
-        if (animations[i] == animation) {
-            animations[i] = NULL;
-            return;
-        }
-    }
-}
-
-void stop_all_keyframe_animations(void) {
-    for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
-        if (animations[i]) {
-            animations[i]->current_frame = animations[i]->num_frames;
-            animations[i]->time_left_in_frame = 0;
-            animations[i]->need_update = true;
-            animations[i]->first_update_of_frame = false;
-            animations[i]->last_update_of_frame = false;
-            animations[i] = NULL;
-        }
-    }
-}
-
-static bool update_keyframe_animation(keyframe_animation_t* animation, visualizer_state_t* state, systemticks_t delta, systemticks_t* sleep_time) {
-    // TODO: Clean up this messy code
-    dprintf("Animation frame%d, left %d, delta %d\n", animation->current_frame,
-            animation->time_left_in_frame, delta);
-    if (animation->current_frame == animation->num_frames) {
-        animation->need_update = false;
-        return false;
-    }
-    if (animation->current_frame == -1) {
-       animation->current_frame = 0;
-       animation->time_left_in_frame = animation->frame_lengths[0];
-       animation->need_update = true;
-       animation->first_update_of_frame = true;
-    } else {
-        animation->time_left_in_frame -= delta;
-        while (animation->time_left_in_frame <= 0) {
-            int left = animation->time_left_in_frame;
-            if (animation->need_update) {
-                animation->time_left_in_frame = 0;
-                animation->last_update_of_frame = true;
-                (*animation->frame_functions[animation->current_frame])(animation, state);
-                animation->last_update_of_frame = false;
-            }
-            animation->current_frame++;
-            animation->need_update = true;
-            animation->first_update_of_frame = true;
-            if (animation->current_frame == animation->num_frames) {
-                if (animation->loop) {
-                    animation->current_frame = 0;
-                }
-                else {
-                    stop_keyframe_animation(animation);
-                    return false;
-                }
-            }
-            delta = -left;
-            animation->time_left_in_frame = animation->frame_lengths[animation->current_frame];
-            animation->time_left_in_frame -= delta;
-        }
-    }
-    if (animation->need_update) {
-        animation->need_update = (*animation->frame_functions[animation->current_frame])(animation, state);
-        animation->first_update_of_frame = false;
-    }
-
-    systemticks_t wanted_sleep = animation->need_update ? gfxMillisecondsToTicks(10) : (unsigned)animation->time_left_in_frame;
-    if (wanted_sleep < *sleep_time) {
-        *sleep_time = wanted_sleep;
-    }
-
-    return true;
-}
-
 void run_next_keyframe(keyframe_animation_t* animation, visualizer_state_t* state) {
     int next_frame = animation->current_frame + 1;
     if (next_frame == animation->num_frames) {
@@ -374,16 +279,24 @@ static DECLARE_THREAD_FUNCTION(visualizerThread, arg) {
 
     systemticks_t sleep_time = TIME_INFINITE;
     systemticks_t current_time = gfxSystemTicks();
+    visualizer_keyboard_status_t flushed_status = state.status;
+    // initialize_user_visualizer might have drawn something
+    bool need_flush = true;
 
     while(true) {
         systemticks_t new_time = gfxSystemTicks();
+#ifdef DEBUG_VISUALIZER
         systemticks_t delta = new_time - current_time;
+#endif
         current_time = new_time;
         bool enabled = visualizer_enabled;
         if (!same_status(&state.status, &current_status)) {
             if (visualizer_enabled) {
                 if (current_status.suspended) {
                     stop_all_keyframe_animations();
+#ifdef LED_ENABLE
+                    stop_led_autoplay();
+#endif
                     visualizer_enabled = false;
                     state.status = current_status;
                     user_visualizer_suspend(&state);
@@ -401,40 +314,44 @@ static DECLARE_THREAD_FUNCTION(visualizerThread, arg) {
             state.status = initial_status;
             state.status.suspended = false;
             stop_all_keyframe_animations();
+#ifdef LED_ENABLE
+            stop_led_autoplay();
+#endif
             user_visualizer_resume(&state);
             state.prev_lcd_color = state.current_lcd_color;
         }
-        sleep_time = TIME_INFINITE;
-        for (int i=0;i<MAX_SIMULTANEOUS_ANIMATIONS;i++) {
-            if (animations[i]) {
-                update_keyframe_animation(animations[i], &state, delta, &sleep_time);
-            }
-        }
+        need_flush |= !same_status(&state.status, &flushed_status);
+        need_flush |= run_keyframe_animations(&state, current_time);
+        // Nothing is drawn unless an animation ran or the state changed,
+        // and the driver only sends the pixels that changed anyway
+        if (need_flush) {
 #ifdef LED_ENABLE
-        gdispGFlush(LED_DISPLAY);
+            gdispGFlush(LED_DISPLAY);
 #endif
+            flushed_status = state.status;
+            need_flush = false;
+        }
 
 #ifdef EMULATOR
         draw_emulator();
 #endif
+        // Sleep until the next frame is due, or until the status changes
+        systemticks_t after_update = gfxSystemTicks();
+        systemticks_t deadline;
+        sleep_time = TIME_INFINITE;
+        if (next_keyframe_deadline(&deadline)) {
+            int32_t left = deadline - after_update;
+            sleep_time = left > 0 ? (systemticks_t)left : 0;
+        }
         // The animation can enable the visualizer
         // And we might need to update the state when that happens
         // so don't sleep
         if (enabled != visualizer_enabled) {
             sleep_time = 0;
         }
-
-        systemticks_t after_update = gfxSystemTicks();
-        unsigned update_delta = after_update - current_time;
-        if (sleep_time != TIME_INFINITE) {
-            if (sleep_time > update_delta) {
-                sleep_time -= update_delta;
-            }
-            else {
-                sleep_time = 0;
-            }
-        }
-        dprintf("Update took %d, last delta %d, sleep_time %d\n", update_delta, delta, sleep_time);
+#ifdef DEBUG_VISUALIZER
+        dprintf("Update took %d, last delta %d, sleep_time %d\n", after_update - current_time, delta, sleep_time);
+#endif
 #ifdef PROTOCOL_CHIBIOS
         // The gEventWait function really takes milliseconds, even if the documentation says ticks.
         // Unfortunately there's no generic ugfx conversion from system time to milliseconds,
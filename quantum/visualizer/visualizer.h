@@ -56,6 +56,11 @@ void draw_emulator(void);
 // If you need support for more than 16 keyframes per animation, you can change this
 #define MAX_VISUALIZER_KEY_FRAMES 16
 
+// How many animations can run at the same time, can be set in config.h
+#ifndef MAX_SIMULTANEOUS_ANIMATIONS
+#define MAX_SIMULTANEOUS_ANIMATIONS 4
+#endif
+
 struct keyframe_animation_t;
 
 typedef struct {
@@ -107,6 +112,10 @@ typedef struct keyframe_animation_t {
     bool last_update_of_frame;
     bool need_update;
 
+    // Used by the scheduler
+    systemticks_t deadline;
+    systemticks_t last_update;
+    uint8_t heap_position;
 } keyframe_animation_t;
 
 extern GDisplay* LCD_DISPLAY;
@@ -21,6 +21,7 @@
 # SOFTWARE.
 
 SRC += $(VISUALIZER_DIR)/visualizer.c
+SRC += $(VISUALIZER_DIR)/keyframe_scheduler.c
 EXTRAINCDIRS += $(GFXINC) $(VISUALIZER_DIR)
 GFXLIB = $(LIB_PATH)/ugfx
 VPATH += $(VISUALIZER_PATH)
@@ -39,6 +40,7 @@ endif
 
 ifdef LED_ENABLE
 SRC += $(VISUALIZER_DIR)/led_test.c
+SRC += $(VISUALIZER_DIR)/led_autoplay.c
 OPT_DEFS += -DLED_ENABLE
 endif
 
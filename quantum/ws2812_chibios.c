@@ -0,0 +1,132 @@
+/*
+ * WS2812 driver for ChibiOS, with the same interface as light_ws2812.c.
+ *
+ * The data goes out on the MOSI pin of a SPI peripheral, which the HAL
+ * feeds from DMA, so the interrupts stay on while the strip updates. Every
+ * WS2812 bit is sent as three SPI bits, 100 for a 0 and 110 for a 1, which
+ * needs a SPI clock between about 2.4 and 3 MHz.
+ *
+ * The keyboard enables HAL_USE_SPI, routes MOSI to the strip and sets in
+ * config.h
+ *   WS2812_SPI         the SPI driver, SPID1 by default
+ *   WS2812_SPI_CONFIG  the SPIConfig fields after end_cb, for example
+ *                      NULL, 0, SPI_CR1_BR_1 | SPI_CR1_BR_0
+ *                      for 3 MHz on a STM32F072 running at 48 MHz
+ */
+
+#include <string.h>
+#include "ch.h"
+#include "hal.h"
+#include "light_ws2812.h"
+#include "print.h"
+
+#ifndef WS2812_SPI
+  #define WS2812_SPI SPID1
+#endif
+#ifndef WS2812_SPI_CONFIG
+  #error "Set WS2812_SPI_CONFIG to the SPI settings for the strip"
+#endif
+
+#ifdef RGBW
+  #define WS2812_BYTES_PER_LED 4
+#else
+  #define WS2812_BYTES_PER_LED 3
+#endif
+
+// Zeros after the data, that keep the line low until the strip latches.
+// 24 bytes are 64us at 3 MHz.
+#ifndef WS2812_RESET_BYTES
+  #define WS2812_RESET_BYTES 24
+#endif
+
+// The three SPI bits of every bit of a nibble
+static const uint16_t nibble_bits[16] = {
+  0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+  0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6,
+};
+
+static uint8_t spi_buffer[RGBLED_NUM * WS2812_BYTES_PER_LED * 3 + WS2812_RESET_BYTES];
+// Taken while the DMA sends spi_buffer
+static binary_semaphore_t spi_idle;
+static bool spi_started = false;
+
+static ws2812_stats_t stats;
+
+static void ws2812_spi_end(SPIDriver *spip)
+{
+  (void)spip;
+  osalSysLockFromISR();
+  chBSemSignalI(&spi_idle);
+  osalSysUnlockFromISR();
+}
+
+static const SPIConfig ws2812_spi_config = {
+  ws2812_spi_end,
+  WS2812_SPI_CONFIG
+};
+
+void ws2812_setleds(LED_TYPE *ledarray, uint16_t leds)
+{
+  ws2812_sendarray_mask((uint8_t*)ledarray, leds * 3, 0);
+}
+
+void ws2812_setleds_pin(LED_TYPE *ledarray, uint16_t leds, uint8_t pinmask)
+{
+  ws2812_sendarray_mask((uint8_t*)ledarray, leds * 3, pinmask);
+}
+
+void ws2812_setleds_rgbw(LED_TYPE *ledarray, uint16_t leds)
+{
+  ws2812_sendarray_mask((uint8_t*)ledarray, leds << 2, 0);
+}
+
+void ws2812_sendarray(uint8_t *data, uint16_t datlen)
+{
+  ws2812_sendarray_mask(data, datlen, 0);
+}
+
+// The pin mask is ignored, the data always goes out on MOSI
+void ws2812_sendarray_mask(uint8_t *data, uint16_t datlen, uint8_t pinmask)
+{
+  uint8_t *out = spi_buffer;
+  uint32_t bits;
+
+  (void)pinmask;
+  if (!spi_started) {
+    chBSemObjectInit(&spi_idle, false);
+    spiStart(&WS2812_SPI, &ws2812_spi_config);
+    spi_started = true;
+  }
+  if (datlen > RGBLED_NUM * WS2812_BYTES_PER_LED) {
+    datlen = RGBLED_NUM * WS2812_BYTES_PER_LED;
+  }
+
+  // The last frame takes about 30us per LED, and is normally long gone
+  chBSemWait(&spi_idle);
+  while (datlen--) {
+    bits = ((uint32_t)nibble_bits[*data >> 4] << 12) | nibble_bits[*data & 0xF];
+    data++;
+    *out++ = bits >> 16;
+    *out++ = bits >> 8;
+    *out++ = bits;
+  }
+  memset(out, 0, WS2812_RESET_BYTES);
+  out += WS2812_RESET_BYTES;
+  spiStartSend(&WS2812_SPI, out - spi_buffer, spi_buffer);
+
+  stats.frames++;
+}
+
+ws2812_stats_t ws2812_stats(void)
+{
+  return stats;
+}
+
+void ws2812_print_stats(void)
+{
+  print("ws2812: frames "); print_dec(stats.frames);
+  print(" restarts "); print_dec(stats.restarts);
+  print(" irq off "); print_dec(stats.last_irq_off_us);
+  print(" us max "); print_dec(stats.max_irq_off_us);
+  print(" us\n");
+}
@@ -1,4 +1,9 @@
+include $(ROOT_DIR)/quantum/debounce/tests/testlist.mk
 include $(ROOT_DIR)/quantum/serial_link/tests/testlist.mk
+include $(ROOT_DIR)/quantum/split/tests/testlist.mk
+include $(ROOT_DIR)/quantum/visualizer/tests/testlist.mk
+include $(ROOT_DIR)/quantum/tests/testlist.mk
+include $(ROOT_DIR)/tmk_core/common/tests/testlist.mk
 
 define VALIDATE_TEST_LIST
     ifneq ($1,)
@@ -6,6 +6,7 @@ else ifeq ($(PLATFORM),CHIBIOS)
 endif
 
 TMK_COMMON_SRC +=	$(COMMON_DIR)/host.c \
+	$(COMMON_DIR)/report.c \
 	$(COMMON_DIR)/keyboard.c \
 	$(COMMON_DIR)/action.c \
 	$(COMMON_DIR)/action_tapping.c \
@@ -93,6 +94,11 @@ ifeq ($(strip $(BLUETOOTH_ENABLE)), yes)
     TMK_COMMON_DEFS += -DBLUETOOTH_ENABLE
 endif
 
+ifeq ($(strip $(ASYNC_SCAN_ENABLE)), yes)
+    TMK_COMMON_SRC += $(COMMON_DIR)/key_event_queue.c
+    TMK_COMMON_DEFS += -DASYNC_SCAN_ENABLE
+endif
+
 ifeq ($(strip $(ONEHAND_ENABLE)), yes)
     TMK_COMMON_DEFS += -DONEHAND_ENABLE
 endif
@@ -100,14 +100,26 @@ bool process_record_quantum(keyrecord_t *record) {
     return true;
 }
 
+void resolve_record(keyrecord_t *record)
+{
+    if (record->resolved) { return; }
+
+    record->layer = store_or_get_layer(record->event.pressed, record->event.key);
+    record->keycode = keymap_key_to_keycode(record->layer, record->event.key);
+    record->action = action_for_keycode(record->keycode);
+    record->resolved = true;
+}
+
 void process_record(keyrecord_t *record) 
 {
     if (IS_NOEVENT(record->event)) { return; }
 
+    resolve_record(record);
+
     if(!process_record_quantum(record))
         return;
 
-    action_t action = store_or_get_action(record->event.pressed, record->event.key);
+    action_t action = record->action;
     dprint("ACTION: "); debug_action(action);
 #ifndef NO_ACTION_LAYER
     dprint(" layer_state: "); layer_debug();
@@ -711,9 +723,10 @@ void clear_keyboard_but_mods(void)
 #endif
 }
 
-bool is_tap_key(keypos_t key)
+bool is_tap_key(keyrecord_t *record)
 {
-    action_t action = layer_switch_get_action(key);
+    resolve_record(record);
+    action_t action = record->action;
 
     switch (action.kind.id) {
         case ACT_LMODS_TAP:
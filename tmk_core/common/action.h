@@ -38,19 +38,33 @@ typedef struct {
     uint8_t count       :4;
 } tap_t;
 
-/* Key event container for recording */
+/* Key event container for recording
+ * layer, keycode and action are looked up once by resolve_record() when the
+ * record is first processed and travel with it from then on.
+ */
 typedef struct {
     keyevent_t  event;
 #ifndef NO_ACTION_TAPPING
     tap_t tap;
 #endif
+    bool        resolved;
+    uint8_t     layer;
+    uint16_t    keycode;
+    action_t    action;
 } keyrecord_t;
 
 /* Execute action per keyevent */
 void action_exec(keyevent_t event);
 
+/* keycode for key, see quantum/keymap_common.c */
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key);
+
 /* action for key */
 action_t action_for_key(uint8_t layer, keypos_t key);
+action_t action_for_keycode(uint16_t keycode);
+
+/* fill in layer, keycode and action of record unless already done */
+void resolve_record(keyrecord_t *record);
 
 /* macro */
 const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt);
@@ -94,7 +108,7 @@ void unregister_mods(uint8_t mods);
 void clear_keyboard(void);
 void clear_keyboard_but_mods(void);
 void layer_switch(uint8_t new_layer);
-bool is_tap_key(keypos_t key);
+bool is_tap_key(keyrecord_t *record);
 
 /* debug */
 void debug_event(keyevent_t event);
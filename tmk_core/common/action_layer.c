@@ -111,6 +111,58 @@ void layer_debug(void)
 #endif
 
 #if !defined(NO_ACTION_LAYER) && defined(PREVENT_STUCK_MODIFIERS)
+/*
+ * Source Layers Cache
+ *
+ * The layer each key was pressed on, in one of three layouts:
+ *   SOURCE_LAYERS_CACHE_BYTES      one byte per key
+ *   SOURCE_LAYERS_CACHE_NIBBLES    half a byte per key, keymaps up to 16 layers,
+ *                                  higher layers are stored as 15
+ *   default                        MAX_LAYER_BITS bits per key, in bit planes
+ */
+#if defined(SOURCE_LAYERS_CACHE_BYTES)
+uint8_t source_layers_cache[MATRIX_ROWS * MATRIX_COLS] = {0};
+
+void update_source_layers_cache(keypos_t key, uint8_t layer)
+{
+    source_layers_cache[key.col + (key.row * MATRIX_COLS)] = layer;
+}
+
+uint8_t read_source_layers_cache(keypos_t key)
+{
+    return source_layers_cache[key.col + (key.row * MATRIX_COLS)];
+}
+#elif defined(SOURCE_LAYERS_CACHE_NIBBLES)
+#if MAX_LAYER_BITS > 4
+#error "SOURCE_LAYERS_CACHE_NIBBLES holds 16 layers, use SOURCE_LAYERS_CACHE_BYTES for more"
+#endif
+uint8_t source_layers_cache[(MATRIX_ROWS * MATRIX_COLS + 1) / 2] = {0};
+
+void update_source_layers_cache(keypos_t key, uint8_t layer)
+{
+    const uint8_t key_number = key.col + (key.row * MATRIX_COLS);
+    uint8_t *storage = &source_layers_cache[key_number / 2];
+
+    // MAX_LAYER_BITS doesn't limit the keymap, so higher layers get here
+    if (layer > 0x0F) {
+        dprintf("source layer %u doesn't fit the nibble cache\n", layer);
+        layer = 0x0F;
+    }
+    if (key_number & 1) {
+        *storage = (*storage & 0x0F) | (layer << 4);
+    } else {
+        *storage = (*storage & 0xF0) | layer;
+    }
+}
+
+uint8_t read_source_layers_cache(keypos_t key)
+{
+    const uint8_t key_number = key.col + (key.row * MATRIX_COLS);
+    const uint8_t storage = source_layers_cache[key_number / 2];
+
+    return (key_number & 1) ? (storage >> 4) : (storage & 0x0F);
+}
+#else
 uint8_t source_layers_cache[(MATRIX_ROWS * MATRIX_COLS + 7) / 8][MAX_LAYER_BITS] = {{0}};
 
 void update_source_layers_cache(keypos_t key, uint8_t layer)
@@ -144,6 +196,7 @@ uint8_t read_source_layers_cache(keypos_t key)
     return layer;
 }
 #endif
+#endif
 
 /*
  * Make sure the action triggered when the key is released is the same
@@ -151,11 +204,11 @@ uint8_t read_source_layers_cache(keypos_t key)
  * when the layer is switched after the down event but before the up
  * event as they may get stuck otherwise.
  */
-action_t store_or_get_action(bool pressed, keypos_t key)
+uint8_t store_or_get_layer(bool pressed, keypos_t key)
 {
 #if !defined(NO_ACTION_LAYER) && defined(PREVENT_STUCK_MODIFIERS)
     if (disable_action_cache) {
-        return layer_switch_get_action(key);
+        return layer_switch_get_layer(key);
     }
 
     uint8_t layer;
@@ -167,12 +220,72 @@ action_t store_or_get_action(bool pressed, keypos_t key)
     else {
         layer = read_source_layers_cache(key);
     }
-    return action_for_key(layer, key);
+    return layer;
+#else
+    return layer_switch_get_layer(key);
+#endif
+}
+
+action_t store_or_get_action(bool pressed, keypos_t key)
+{
+    return action_for_key(store_or_get_layer(pressed, key), key);
+}
+
+
+#if !defined(NO_ACTION_LAYER) && defined(LAYER_OPAQUE_CACHE)
+/*
+ * Opaque Layer Cache
+ *
+ * One bit per key and layer, set when the key is not transparent on that
+ * layer. A layer is read from the keymap the first time it is active, after
+ * that the topmost non-transparent layer of a key is found without touching
+ * flash. Layers above LAYER_OPAQUE_CACHE_LAYERS are looked up as before.
+ */
+#ifndef LAYER_OPAQUE_CACHE_LAYERS
+#define LAYER_OPAQUE_CACHE_LAYERS 8
+#endif
+
+#if (LAYER_OPAQUE_CACHE_LAYERS <= 8)
+typedef uint8_t layer_opaque_t;
+#elif (LAYER_OPAQUE_CACHE_LAYERS <= 16)
+typedef uint16_t layer_opaque_t;
+#elif (LAYER_OPAQUE_CACHE_LAYERS <= 32)
+typedef uint32_t layer_opaque_t;
+#else
+#error "LAYER_OPAQUE_CACHE_LAYERS: invalid value"
+#endif
+
+#if (LAYER_OPAQUE_CACHE_LAYERS == 32)
+#define LAYER_OPAQUE_CACHE_MASK 0xFFFFFFFFUL
 #else
-    return layer_switch_get_action(key);
+#define LAYER_OPAQUE_CACHE_MASK ((1UL << LAYER_OPAQUE_CACHE_LAYERS) - 1)
 #endif
+
+static layer_opaque_t layer_opaque_cache[MATRIX_ROWS][MATRIX_COLS];
+static uint32_t layer_opaque_cached = 0;
+
+void layer_opaque_cache_clear(void)
+{
+    layer_opaque_cached = 0;
 }
 
+static void layer_opaque_cache_fill(uint8_t layer)
+{
+    const layer_opaque_t layer_bit = (layer_opaque_t)1 << layer;
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            keypos_t key = { .col = col, .row = row };
+            if (action_for_key(layer, key).code != ACTION_TRANSPARENT) {
+                layer_opaque_cache[row][col] |= layer_bit;
+            } else {
+                layer_opaque_cache[row][col] &= ~layer_bit;
+            }
+        }
+    }
+    layer_opaque_cached |= layer_bit;
+}
+#endif
 
 int8_t layer_switch_get_layer(keypos_t key)
 {
@@ -181,6 +294,30 @@ int8_t layer_switch_get_layer(keypos_t key)
 
 #ifndef NO_ACTION_LAYER
     uint32_t layers = layer_state | default_layer_state;
+#ifdef LAYER_OPAQUE_CACHE
+    uint32_t uncached = layers & LAYER_OPAQUE_CACHE_MASK & ~layer_opaque_cached;
+    while (uncached) {
+        uint8_t i = biton32(uncached);
+        layer_opaque_cache_fill(i);
+        uncached &= ~(1UL<<i);
+    }
+
+    /* drop the cached layers on which key is transparent */
+    layers &= layer_opaque_cache[key.row][key.col] | ~LAYER_OPAQUE_CACHE_MASK;
+    while (layers) {
+        uint8_t i = biton32(layers);
+        if (i < LAYER_OPAQUE_CACHE_LAYERS) {
+            return i;
+        }
+        action = action_for_key(i, key);
+        if (action.code != ACTION_TRANSPARENT) {
+            return i;
+        }
+        layers &= ~(1UL<<i);
+    }
+    /* fall back to layer 0 */
+    return 0;
+#else
     /* check top layer first */
     for (int8_t i = 31; i >= 0; i--) {
         if (layers & (1UL<<i)) {
@@ -192,6 +329,7 @@ int8_t layer_switch_get_layer(keypos_t key)
     }
     /* fall back to layer 0 */
     return 0;
+#endif
 #else
     return biton32(default_layer_state);
 #endif
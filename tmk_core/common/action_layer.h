@@ -71,13 +71,28 @@ void layer_xor(uint32_t state);
 
 #endif
 
+/* opaque layer cache, clear it when the keymap is changed at runtime */
+#if !defined(NO_ACTION_LAYER) && defined(LAYER_OPAQUE_CACHE)
+void layer_opaque_cache_clear(void);
+#else
+#define layer_opaque_cache_clear()
+#endif
+
 /* pressed actions cache */
 #if !defined(NO_ACTION_LAYER) && defined(PREVENT_STUCK_MODIFIERS)
-/* The number of bits needed to represent the layer number: log2(32). */
+/* The number of bits needed to represent the layer number: log2(32).
+ * The nibble cache only has room for 16 layers. */
+#ifndef MAX_LAYER_BITS
+#ifdef SOURCE_LAYERS_CACHE_NIBBLES
+#define MAX_LAYER_BITS 4
+#else
 #define MAX_LAYER_BITS 5
+#endif
+#endif
 void update_source_layers_cache(keypos_t key, uint8_t layer);
 uint8_t read_source_layers_cache(keypos_t key);
 #endif
+uint8_t store_or_get_layer(bool pressed, keypos_t key);
 action_t store_or_get_action(bool pressed, keypos_t key);
 
 /* return the topmost non-transparent layer currently associated with key */
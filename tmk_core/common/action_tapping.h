@@ -29,7 +29,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define TAPPING_TOGGLE  5
 #endif
 
+/* number of key events held back while a tap is being resolved;
+ * raise it together with QMK_KEYS_PER_SCAN for large chords */
+#ifndef WAITING_BUFFER_SIZE
 #define WAITING_BUFFER_SIZE 8
+#endif
 
 
 #ifndef NO_ACTION_TAPPING
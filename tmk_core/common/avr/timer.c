@@ -21,6 +21,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdint.h>
 #include "timer_avr.h"
 #include "timer.h"
+#ifdef ASYNC_SCAN_ENABLE
+#include "keyboard.h"
+#endif
 
 
 // counter resolution 1ms
@@ -110,4 +113,18 @@ uint32_t timer_elapsed32(uint32_t last)
 ISR(TIMER0_COMPA_vect)
 {
     timer_count++;
+#ifdef ASYNC_SCAN_ENABLE
+    static bool scanning = false;
+
+    // The scan runs with interrupts on, so USB doesn't wait for it. A scan
+    // that takes longer than a tick makes the next tick skip its own.
+    if (scanning || keyboard_scan_paused) {
+        return;
+    }
+    scanning = true;
+    sei();
+    keyboard_scan_task();
+    cli();
+    scanning = false;
+#endif
 }
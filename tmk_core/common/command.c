@@ -35,6 +35,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "backlight.h"
 #include "quantum.h"
 #include "version.h"
+#ifdef ASYNC_SCAN_ENABLE
+#include "key_event_queue.h"
+#endif
 
 #ifdef MOUSEKEY_ENABLE
 #include "mousekey.h"
@@ -51,6 +54,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 	#include "usbdrv.h"
 #endif
 
+#ifdef PROTOCOL_CHIBIOS
+	#include "usb_main.h"
+#endif
+
+#ifdef PROTOCOL_LUFA
+	#include "lufa.h"
+#endif
+
 #ifdef AUDIO_ENABLE
     #include "audio.h"
 #endif /* AUDIO_ENABLE */
@@ -254,6 +265,17 @@ static void print_status(void)
 #   if USB_COUNT_SOF
     print_val_hex8(usbSofCount);
 #   endif
+#endif
+
+#ifdef PROTOCOL_CHIBIOS
+    keyboard_report_queue_print_stats();
+#endif
+#ifdef PROTOCOL_LUFA
+    usb_report_queue_print_stats();
+#endif
+
+#ifdef ASYNC_SCAN_ENABLE
+    key_event_queue_print_stats();
 #endif
 	return;
 }
@@ -19,6 +19,9 @@ void eeconfig_init(void)
 #ifdef RGBLIGHT_ENABLE
     eeprom_update_dword(EECONFIG_RGBLIGHT,      0);
 #endif
+#ifdef MATRIX_SETTLE_CALIBRATION
+    eeprom_update_byte(EECONFIG_MATRIX_SETTLE,  0); // Calibrate on next boot
+#endif
 }
 
 void eeconfig_enable(void)
@@ -54,3 +57,8 @@ void eeconfig_update_backlight(uint8_t val) { eeprom_update_byte(EECONFIG_BACKLI
 uint8_t eeconfig_read_audio(void)      { return eeprom_read_byte(EECONFIG_AUDIO); }
 void eeconfig_update_audio(uint8_t val) { eeprom_update_byte(EECONFIG_AUDIO, val); }
 #endif
+
+#ifdef MATRIX_SETTLE_CALIBRATION
+uint8_t eeconfig_read_matrix_settle(void)      { return eeprom_read_byte(EECONFIG_MATRIX_SETTLE); }
+void eeconfig_update_matrix_settle(uint8_t val) { eeprom_update_byte(EECONFIG_MATRIX_SETTLE, val); }
+#endif
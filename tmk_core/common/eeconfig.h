@@ -33,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EECONFIG_BACKLIGHT                          (uint8_t *)6
 #define EECONFIG_AUDIO                              (uint8_t *)7
 #define EECONFIG_RGBLIGHT                           (uint32_t *)8
+#define EECONFIG_MATRIX_SETTLE                      (uint8_t *)12
 
 
 /* debug bit */
@@ -79,4 +80,9 @@ uint8_t eeconfig_read_audio(void);
 void eeconfig_update_audio(uint8_t val);
 #endif
 
+#ifdef MATRIX_SETTLE_CALIBRATION
+uint8_t eeconfig_read_matrix_settle(void);
+void eeconfig_update_matrix_settle(uint8_t val);
+#endif
+
 #endif
@@ -0,0 +1,70 @@
+#include "key_event_queue.h"
+#include "print.h"
+
+#define QUEUE_MASK (KEY_EVENT_QUEUE_SIZE - 1)
+
+/* head and tail run freely and wrap at 256, head - tail is the depth.
+ * head is only written by the producer, tail only by the consumer. Both are
+ * single bytes, so loads and stores are atomic on every supported MCU.
+ */
+static keyevent_t queue[KEY_EVENT_QUEUE_SIZE];
+static uint8_t queue_head;
+static uint8_t queue_tail;
+static volatile key_event_queue_stats_t stats;
+
+void key_event_queue_init(void)
+{
+    __atomic_store_n(&queue_head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&queue_tail, 0, __ATOMIC_RELAXED);
+    stats.overflows = 0;
+    stats.max_depth = 0;
+}
+
+bool key_event_queue_put(keyevent_t event)
+{
+    uint8_t head = __atomic_load_n(&queue_head, __ATOMIC_RELAXED);
+    uint8_t depth = (uint8_t)(head - __atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE));
+    if (depth >= KEY_EVENT_QUEUE_SIZE) {
+        stats.overflows++;
+        return false;
+    }
+    queue[head & QUEUE_MASK] = event;
+    // publish the event only after it has been written
+    __atomic_store_n(&queue_head, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+    if (depth + 1 > stats.max_depth) {
+        stats.max_depth = depth + 1;
+    }
+    return true;
+}
+
+bool key_event_queue_get(keyevent_t *event)
+{
+    uint8_t tail = __atomic_load_n(&queue_tail, __ATOMIC_RELAXED);
+    if (tail == __atomic_load_n(&queue_head, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *event = queue[tail & QUEUE_MASK];
+    // hand the slot back only after it has been read
+    __atomic_store_n(&queue_tail, (uint8_t)(tail + 1), __ATOMIC_RELEASE);
+    return true;
+}
+
+uint8_t key_event_queue_depth(void)
+{
+    return (uint8_t)(__atomic_load_n(&queue_head, __ATOMIC_ACQUIRE) -
+                     __atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE));
+}
+
+key_event_queue_stats_t key_event_queue_stats(void)
+{
+    return stats;
+}
+
+void key_event_queue_print_stats(void)
+{
+    print("key event queue: ");
+    print("depth "); print_dec(key_event_queue_depth());
+    print(" max "); print_dec(stats.max_depth);
+    print(" overflows "); print_dec(stats.overflows);
+    print("\n");
+}
@@ -0,0 +1,54 @@
+#ifndef KEY_EVENT_QUEUE_H
+#define KEY_EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "keyboard.h"
+
+/* Single producer, single consumer queue of key events
+ *
+ * With ASYNC_SCAN_ENABLE the matrix is scanned by keyboard_scan_task() from a
+ * scanning thread (ChibiOS) or a timer interrupt, which puts the events here.
+ * keyboard_task() takes them out in the main loop, so a slow
+ * process_record_user() or a busy USB endpoint no longer delays scanning.
+ *
+ * matrix_scan_kb() and matrix_scan_user() run in the scanning context too.
+ * ChibiOS boards get a scanning thread from main.c, on AVR the timer 0
+ * interrupt scans every millisecond with interrupts enabled.
+ *
+ * Exactly one context may put and exactly one may get. No locks are taken,
+ * each side only ever writes its own index.
+ */
+
+/* must be a power of two, 128 at most */
+#ifndef KEY_EVENT_QUEUE_SIZE
+#define KEY_EVENT_QUEUE_SIZE 16
+#endif
+
+#if (KEY_EVENT_QUEUE_SIZE & (KEY_EVENT_QUEUE_SIZE - 1)) || KEY_EVENT_QUEUE_SIZE > 128
+#error "KEY_EVENT_QUEUE_SIZE must be a power of two, 128 at most"
+#endif
+
+typedef struct {
+    uint16_t overflows;     // events that didn't fit and had to be retried
+    uint8_t  max_depth;     // high-water mark of queued events
+} key_event_queue_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void key_event_queue_init(void);
+/* producer side, false when the queue is full */
+bool key_event_queue_put(keyevent_t event);
+/* consumer side, false when the queue is empty */
+bool key_event_queue_get(keyevent_t *event);
+uint8_t key_event_queue_depth(void);
+key_event_queue_stats_t key_event_queue_stats(void);
+void key_event_queue_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -56,6 +56,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifdef VISUALIZER_ENABLE
 #   include "visualizer/visualizer.h"
 #endif
+#ifdef ASYNC_SCAN_ENABLE
+#   include "key_event_queue.h"
+#endif
 
 
 
@@ -86,6 +89,9 @@ void keyboard_setup(void) {
 
 void keyboard_init(void) {
     timer_init();
+#ifdef ASYNC_SCAN_ENABLE
+    key_event_queue_init();
+#endif
     matrix_init();
 #ifdef PS2_MOUSE_ENABLE
     ps2_mouse_init();
@@ -112,21 +118,83 @@ void keyboard_init(void) {
 #endif
 }
 
+#ifdef ASYNC_SCAN_ENABLE
+#ifdef __AVR__
+volatile bool keyboard_scan_paused = false;
+#endif
+
+/*
+ * Scan the matrix and queue every key change, stamped with the scan time.
+ * This runs in the scanning context (a ChibiOS thread or a timer interrupt),
+ * keyboard_task() processes the queued events. A change that doesn't fit
+ * into the queue stays pending and is queued by a later scan.
+ */
+void keyboard_scan_task(void)
+{
+    static matrix_row_t matrix_prev[MATRIX_ROWS];
+
+    matrix_scan();
+    const uint16_t scan_time = timer_read() | 1; /* time should not be 0 */
+
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        matrix_row_t matrix_row = matrix_get_row(r);
+        matrix_row_t matrix_change = matrix_row ^ matrix_prev[r];
+        if (!matrix_change) continue;
+#ifdef MATRIX_HAS_GHOST
+        // don't update matrix_prev until un-ghosted
+        if (has_ghost_in_row(r)) continue;
+#endif
+        for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+            if (matrix_change & ((matrix_row_t)1<<c)) {
+                if (!key_event_queue_put((keyevent_t){
+                    .key = (keypos_t){ .row = r, .col = c },
+                    .pressed = (matrix_row & ((matrix_row_t)1<<c)),
+                    .time = scan_time
+                })) {
+                    return;
+                }
+                matrix_prev[r] ^= ((matrix_row_t)1<<c);
+            }
+        }
+    }
+}
+#endif
+
 /*
  * Do keyboard routine jobs: scan mantrix, light LEDs, ...
  * This is repeatedly called as fast as possible.
  */
 void keyboard_task(void)
 {
+    static uint8_t led_status = 0;
+#ifdef ASYNC_SCAN_ENABLE
+    keyevent_t event;
+
+    // the matrix is scanned elsewhere, process what it found
+    if (key_event_queue_get(&event)) {
+        do {
+            action_exec(event);
+        } while (key_event_queue_get(&event));
+    } else {
+        // call with pseudo tick event when no real key event.
+        action_exec(TICK);
+    }
+#else
     static matrix_row_t matrix_prev[MATRIX_ROWS];
 #ifdef MATRIX_HAS_GHOST
     static matrix_row_t matrix_ghost[MATRIX_ROWS];
 #endif
-    static uint8_t led_status = 0;
     matrix_row_t matrix_row = 0;
     matrix_row_t matrix_change = 0;
+#if QMK_KEYS_PER_SCAN
+    uint8_t keys_processed = 0;
+#endif
 
     matrix_scan();
+#if QMK_KEYS_PER_SCAN
+    /* All changes found in this scan share its timestamp */
+    const uint16_t scan_time = timer_read() | 1; /* time should not be 0 */
+#endif
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
         matrix_row = matrix_get_row(r);
         matrix_change = matrix_row ^ matrix_prev[r];
@@ -151,10 +219,18 @@ void keyboard_task(void)
                     action_exec((keyevent_t){
                         .key = (keypos_t){ .row = r, .col = c },
                         .pressed = (matrix_row & ((matrix_row_t)1<<c)),
+#if QMK_KEYS_PER_SCAN
+                        .time = scan_time
+#else
                         .time = (timer_read() | 1) /* time should not be 0 */
+#endif
                     });
                     // record a processed key
                     matrix_prev[r] ^= ((matrix_row_t)1<<c);
+#if QMK_KEYS_PER_SCAN
+                    // only jump out once enough keys of this scan are processed
+                    if (++keys_processed >= QMK_KEYS_PER_SCAN)
+#endif
                     // process a key per task call
                     goto MATRIX_LOOP_END;
                 }
@@ -162,9 +238,14 @@ void keyboard_task(void)
         }
     }
     // call with pseudo tick event when no real key event.
+#if QMK_KEYS_PER_SCAN
+    // some keys of this scan may have been processed already
+    if (!keys_processed)
+#endif
     action_exec(TICK);
 
 MATRIX_LOOP_END:
+#endif
 
 #ifdef MOUSEKEY_ENABLE
     // mousekey repeat & acceleration
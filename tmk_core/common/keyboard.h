@@ -64,6 +64,12 @@ void keyboard_setup(void);
 void keyboard_init(void);
 /* it runs repeatedly in main loop */
 void keyboard_task(void);
+/* with ASYNC_SCAN_ENABLE it runs periodically in a scanning thread or timer interrupt */
+void keyboard_scan_task(void);
+#if defined(ASYNC_SCAN_ENABLE) && defined(__AVR__)
+/* set while the main loop scans the matrix itself, the timer interrupt skips its scan */
+extern volatile bool keyboard_scan_paused;
+#endif
 /* it runs when host LED status is updated */
 void keyboard_set_leds(uint8_t leds);
 
@@ -0,0 +1,62 @@
+#include "report.h"
+
+bool keyboard_report_has_key(const report_keyboard_t *report, uint8_t key)
+{
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (report->keys[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* true when b presses a key or modifier that a doesn't */
+static bool keyboard_report_adds_press(const report_keyboard_t *a, const report_keyboard_t *b, bool nkro)
+{
+    if (nkro) {
+        for (uint8_t i = 0; i < KEYBOARD_REPORT_SIZE; i++) {
+            if (b->raw[i] & ~a->raw[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (b->mods & ~a->mods) {
+        return true;
+    }
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (b->keys[i] && !keyboard_report_has_key(a, b->keys[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* true when a key or modifier goes down from a to b and up again from b to c,
+ * i.e. b is the only report the host would see that key pressed in */
+static bool keyboard_report_taps(const report_keyboard_t *a, const report_keyboard_t *b, const report_keyboard_t *c, bool nkro)
+{
+    if (nkro) {
+        for (uint8_t i = 0; i < KEYBOARD_REPORT_SIZE; i++) {
+            if (b->raw[i] & ~a->raw[i] & ~c->raw[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (b->mods & ~a->mods & ~c->mods) {
+        return true;
+    }
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        uint8_t key = b->keys[i];
+        if (key && !keyboard_report_has_key(a, key) && !keyboard_report_has_key(c, key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool keyboard_report_can_merge(const report_keyboard_t *a, const report_keyboard_t *b, const report_keyboard_t *c, bool nkro)
+{
+    return !keyboard_report_adds_press(b, c, nkro) && !keyboard_report_taps(a, b, c, nkro);
+}
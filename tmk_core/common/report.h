@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define REPORT_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "keycode.h"
 
 
@@ -181,6 +182,13 @@ typedef struct {
     (key == KC_WWW_REFRESH      ?  AC_REFRESH : \
     (key == KC_WWW_FAVORITES    ?  AC_BOOKMARKS : 0)))))))))))))))))))))
 
+bool keyboard_report_has_key(const report_keyboard_t *report, uint8_t key);
+/* true when report c can replace b, the last report queued after a, without
+ * the host missing a press or seeing presses in a different order: c presses
+ * nothing b doesn't, and releases nothing that only b shows pressed */
+bool keyboard_report_can_merge(const report_keyboard_t *a, const report_keyboard_t *b,
+                               const report_keyboard_t *c, bool nkro);
+
 #ifdef __cplusplus
 }
 #endif
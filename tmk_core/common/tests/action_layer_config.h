@@ -0,0 +1,16 @@
+/* Config for running action_layer.c on the host against a keymap held in RAM,
+ * see action_layer_tests.cpp
+ */
+#ifndef ACTION_LAYER_TEST_CONFIG_H
+#define ACTION_LAYER_TEST_CONFIG_H
+
+#define MATRIX_ROWS 5
+#define MATRIX_COLS 14
+
+#define LAYER_OPAQUE_CACHE
+#define LAYER_OPAQUE_CACHE_LAYERS 8
+
+#define NO_PRINT
+#define NO_DEBUG
+
+#endif
@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <random>
+extern "C" {
+#include "action_layer.h"
+}
+
+#define TEST_LAYERS 12
+
+/* The keymap lives in RAM and every lookup is counted, each one stands for a
+ * pgm_read_word() of the real keymap.
+ */
+static uint16_t test_keymap[TEST_LAYERS][MATRIX_ROWS][MATRIX_COLS];
+static uint32_t keymap_reads;
+
+extern "C" action_t action_for_key(uint8_t layer, keypos_t key) {
+    action_t action;
+    keymap_reads++;
+    action.code = test_keymap[layer][key.row][key.col] ? ACTION_KEY(test_keymap[layer][key.row][key.col]) : ACTION_TRANSPARENT;
+    return action;
+}
+
+extern "C" void clear_keyboard_but_mods(void) {
+}
+
+/* layer_switch_get_layer() as it was before the opaque layer cache */
+static int8_t reference_get_layer(keypos_t key) {
+    uint32_t layers = layer_state | default_layer_state;
+    for (int8_t i = 31; i >= 0; i--) {
+        if (layers & (1UL << i)) {
+            if (action_for_key(i, key).code != ACTION_TRANSPARENT) {
+                return i;
+            }
+        }
+    }
+    return 0;
+}
+
+static keypos_t make_key(uint8_t row, uint8_t col) {
+    keypos_t key;
+    key.row = row;
+    key.col = col;
+    return key;
+}
+
+class ActionLayer : public testing::Test {
+public:
+    ActionLayer() {
+        std::mt19937 rng(4321);
+        std::bernoulli_distribution transparent(0.7);
+        for (uint8_t layer = 0; layer < TEST_LAYERS; layer++) {
+            for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+                for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                    test_keymap[layer][row][col] = (layer == 0 || !transparent(rng)) ? KC_A + layer : KC_TRNS;
+                }
+            }
+        }
+        layer_clear();
+        default_layer_set(1);
+        layer_opaque_cache_clear();
+        keymap_reads = 0;
+    }
+
+    void expect_same_layers() {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                EXPECT_EQ(layer_switch_get_layer(make_key(row, col)), reference_get_layer(make_key(row, col)))
+                    << "layer_state " << std::hex << layer_state << " key " << std::dec << (int)row << "," << (int)col;
+            }
+        }
+    }
+};
+
+TEST_F(ActionLayer, resolves_default_layer) {
+    expect_same_layers();
+}
+
+TEST_F(ActionLayer, resolves_every_layer_combination) {
+    for (uint32_t state = 0; state < (1UL << TEST_LAYERS); state += 7) {
+        layer_state = state;
+        expect_same_layers();
+    }
+}
+
+TEST_F(ActionLayer, resolves_transparent_keys_to_layer_0) {
+    test_keymap[0][2][3] = KC_TRNS;
+    layer_opaque_cache_clear();
+    layer_on(5);
+    layer_on(10);
+    expect_same_layers();
+}
+
+TEST_F(ActionLayer, follows_keymap_after_cache_clear) {
+    layer_on(3);
+    keypos_t key = make_key(1, 1);
+    test_keymap[3][1][1] = KC_B;
+    layer_opaque_cache_clear();
+    EXPECT_EQ(layer_switch_get_layer(key), 3);
+    test_keymap[3][1][1] = KC_TRNS;
+    layer_opaque_cache_clear();
+    EXPECT_EQ(layer_switch_get_layer(key), reference_get_layer(key));
+}
+
+TEST_F(ActionLayer, benchmark_keymap_reads_per_event) {
+    const int events = 10000;
+    std::mt19937 rng(8765);
+    std::uniform_int_distribution<uint8_t> row(0, MATRIX_ROWS - 1);
+    std::uniform_int_distribution<uint8_t> col(0, MATRIX_COLS - 1);
+    std::uniform_int_distribution<uint32_t> state(0, (1UL << TEST_LAYERS) - 1);
+    uint32_t states[events];
+    keypos_t keys[events];
+    for (int i = 0; i < events; i++) {
+        states[i] = state(rng);
+        keys[i] = make_key(row(rng), col(rng));
+    }
+
+    keymap_reads = 0;
+    for (int i = 0; i < events; i++) {
+        layer_state = states[i];
+        reference_get_layer(keys[i]);
+    }
+    uint32_t reference_reads = keymap_reads;
+
+    keymap_reads = 0;
+    for (int i = 0; i < events; i++) {
+        layer_state = states[i];
+        layer_switch_get_layer(keys[i]);
+    }
+    uint32_t cached_reads = keymap_reads;
+
+    printf("per layer: %.2f keymap reads/event\n", (double)reference_reads / events);
+    printf("cached:    %.2f keymap reads/event (%u to fill the cache)\n",
+        (double)cached_reads / events, LAYER_OPAQUE_CACHE_LAYERS * MATRIX_ROWS * MATRIX_COLS);
+
+    EXPECT_LT(cached_reads, reference_reads);
+}
@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+#include <thread>
+extern "C" {
+#include "key_event_queue.h"
+}
+
+static keyevent_t make_event(uint8_t row, uint8_t col, bool pressed, uint16_t time) {
+    keyevent_t event;
+    event.key.row = row;
+    event.key.col = col;
+    event.pressed = pressed;
+    event.time = time;
+    return event;
+}
+
+class KeyEventQueue : public testing::Test {
+public:
+    KeyEventQueue() {
+        key_event_queue_init();
+    }
+};
+
+TEST_F(KeyEventQueue, is_empty_after_init) {
+    keyevent_t event;
+    EXPECT_EQ(key_event_queue_depth(), 0);
+    EXPECT_FALSE(key_event_queue_get(&event));
+}
+
+TEST_F(KeyEventQueue, returns_events_in_order) {
+    EXPECT_TRUE(key_event_queue_put(make_event(1, 2, true, 100)));
+    EXPECT_TRUE(key_event_queue_put(make_event(3, 4, false, 101)));
+    EXPECT_EQ(key_event_queue_depth(), 2);
+
+    keyevent_t event;
+    EXPECT_TRUE(key_event_queue_get(&event));
+    EXPECT_EQ(event.key.row, 1);
+    EXPECT_EQ(event.key.col, 2);
+    EXPECT_TRUE(event.pressed);
+    EXPECT_EQ(event.time, 100);
+    EXPECT_TRUE(key_event_queue_get(&event));
+    EXPECT_EQ(event.key.row, 3);
+    EXPECT_EQ(event.key.col, 4);
+    EXPECT_FALSE(event.pressed);
+    EXPECT_EQ(event.time, 101);
+    EXPECT_FALSE(key_event_queue_get(&event));
+}
+
+TEST_F(KeyEventQueue, counts_overflows_and_max_depth) {
+    for (int i = 0; i < KEY_EVENT_QUEUE_SIZE; i++) {
+        EXPECT_TRUE(key_event_queue_put(make_event(0, i, true, i + 1)));
+    }
+    EXPECT_FALSE(key_event_queue_put(make_event(0, 0, false, 1)));
+    EXPECT_FALSE(key_event_queue_put(make_event(0, 0, false, 1)));
+
+    key_event_queue_stats_t stats = key_event_queue_stats();
+    EXPECT_EQ(stats.overflows, 2);
+    EXPECT_EQ(stats.max_depth, KEY_EVENT_QUEUE_SIZE);
+
+    keyevent_t event;
+    EXPECT_TRUE(key_event_queue_get(&event));
+    EXPECT_EQ(event.key.col, 0);
+    EXPECT_TRUE(key_event_queue_put(make_event(0, 0, false, 1)));
+}
+
+TEST_F(KeyEventQueue, wraps_around_many_times) {
+    keyevent_t event;
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_TRUE(key_event_queue_put(make_event(i % 7, i % 13, i & 1, i | 1)));
+        EXPECT_TRUE(key_event_queue_get(&event));
+        EXPECT_EQ(event.key.row, i % 7);
+        EXPECT_EQ(event.key.col, i % 13);
+        EXPECT_EQ(event.time, i | 1);
+    }
+    EXPECT_EQ(key_event_queue_depth(), 0);
+}
+
+TEST_F(KeyEventQueue, passes_events_between_threads_without_loss) {
+    const uint16_t count = 50000;
+    std::thread producer([count]() {
+        for (uint16_t i = 1; i <= count; i++) {
+            while (!key_event_queue_put(make_event(i & 0xFF, i >> 8, i & 1, i))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint16_t expected = 1;
+    keyevent_t event;
+    while (expected <= count) {
+        if (key_event_queue_get(&event)) {
+            ASSERT_EQ(event.time, expected);
+            ASSERT_EQ(event.key.row, expected & 0xFF);
+            ASSERT_EQ(event.key.col, expected >> 8);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_FALSE(key_event_queue_get(&event));
+}
@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+#include <initializer_list>
+extern "C" {
+#include "report.h"
+}
+
+static report_keyboard_t keys(uint8_t mods, std::initializer_list<uint8_t> pressed) {
+    report_keyboard_t report = {};
+    report.mods = mods;
+    uint8_t i = 0;
+    for (uint8_t key : pressed) {
+        report.keys[i++] = key;
+    }
+    return report;
+}
+
+// The NKRO layout: mods, then one bit per key
+static report_keyboard_t bits(uint8_t mods, std::initializer_list<uint8_t> pressed) {
+    report_keyboard_t report = {};
+    report.raw[0] = mods;
+    for (uint8_t key : pressed) {
+        report.raw[1 + key / 8] |= 1 << (key % 8);
+    }
+    return report;
+}
+
+// Runs every test for both layouts, the parameter is nkro
+class KeyboardReport : public testing::TestWithParam<bool> {
+public:
+    bool can_merge(report_keyboard_t a, report_keyboard_t b, report_keyboard_t c) {
+        return keyboard_report_can_merge(&a, &b, &c, GetParam());
+    }
+    report_keyboard_t (*make)(uint8_t, std::initializer_list<uint8_t>) = GetParam() ? bits : keys;
+};
+
+TEST_P(KeyboardReport, keeps_the_order_of_a_roll) {
+    EXPECT_FALSE(can_merge(make(0, {}), make(0, {KC_S}), make(0, {KC_S, KC_A})));
+    EXPECT_FALSE(can_merge(make(0, {KC_A}), make(0, {KC_A, KC_S}), make(0, {KC_A, KC_S, KC_D})));
+}
+
+TEST_P(KeyboardReport, keeps_a_modifier_ahead_of_the_key) {
+    EXPECT_FALSE(can_merge(make(0, {}), make(MOD_BIT(KC_LSFT), {}), make(MOD_BIT(KC_LSFT), {KC_A})));
+}
+
+TEST_P(KeyboardReport, keeps_a_tap) {
+    EXPECT_FALSE(can_merge(make(0, {}), make(0, {KC_A}), make(0, {})));
+    EXPECT_FALSE(can_merge(make(0, {}), make(MOD_BIT(KC_LCTL), {}), make(0, {})));
+}
+
+TEST_P(KeyboardReport, keeps_a_press_after_a_release) {
+    EXPECT_FALSE(can_merge(make(0, {KC_A}), make(0, {}), make(0, {KC_A})));
+    EXPECT_FALSE(can_merge(make(0, {KC_A}), make(0, {}), make(0, {KC_B})));
+}
+
+TEST_P(KeyboardReport, merges_releases) {
+    EXPECT_TRUE(can_merge(make(0, {KC_A, KC_B}), make(0, {KC_B}), make(0, {})));
+    EXPECT_TRUE(can_merge(make(MOD_BIT(KC_LSFT), {KC_A}), make(0, {KC_A}), make(0, {})));
+}
+
+TEST_P(KeyboardReport, merges_a_release_after_a_press) {
+    EXPECT_TRUE(can_merge(make(0, {KC_A}), make(0, {KC_A, KC_B}), make(0, {KC_B})));
+}
+
+INSTANTIATE_TEST_CASE_P(SixKeyAndNkro, KeyboardReport, testing::Bool());
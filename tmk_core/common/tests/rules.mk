@@ -0,0 +1,29 @@
+tmk_common_key_event_queue_SRC := \
+	$(TMK_PATH)/common/tests/key_event_queue_tests.cpp \
+	$(TMK_PATH)/common/key_event_queue.c
+tmk_common_key_event_queue_DEFS := -DNO_PRINT -DKEY_EVENT_QUEUE_SIZE=8
+
+tmk_common_report_SRC := \
+	$(TMK_PATH)/common/tests/report_tests.cpp \
+	$(TMK_PATH)/common/report.c
+
+tmk_common_action_layer_SRC := \
+	$(TMK_PATH)/common/tests/action_layer_tests.cpp \
+	$(TMK_PATH)/common/action_layer.c \
+	$(TMK_PATH)/common/util.c
+tmk_common_action_layer_CONFIG := $(TMK_PATH)/common/tests/action_layer_config.h
+
+tmk_common_source_layers_packed_SRC := \
+	$(TMK_PATH)/common/tests/source_layers_cache_tests.cpp \
+	$(TMK_PATH)/common/action_layer.c \
+	$(TMK_PATH)/common/util.c
+tmk_common_source_layers_packed_CONFIG := $(TMK_PATH)/common/tests/action_layer_config.h
+tmk_common_source_layers_packed_DEFS := -DPREVENT_STUCK_MODIFIERS
+
+tmk_common_source_layers_nibbles_SRC := $(tmk_common_source_layers_packed_SRC)
+tmk_common_source_layers_nibbles_CONFIG := $(TMK_PATH)/common/tests/action_layer_config.h
+tmk_common_source_layers_nibbles_DEFS := -DPREVENT_STUCK_MODIFIERS -DSOURCE_LAYERS_CACHE_NIBBLES
+
+tmk_common_source_layers_bytes_SRC := $(tmk_common_source_layers_packed_SRC)
+tmk_common_source_layers_bytes_CONFIG := $(TMK_PATH)/common/tests/action_layer_config.h
+tmk_common_source_layers_bytes_DEFS := -DPREVENT_STUCK_MODIFIERS -DSOURCE_LAYERS_CACHE_BYTES
@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+extern "C" {
+#include "action_layer.h"
+}
+
+#if defined(SOURCE_LAYERS_CACHE_BYTES)
+#define TEST_LAYERS 32
+#define TEST_LAYOUT "bytes"
+#elif defined(SOURCE_LAYERS_CACHE_NIBBLES)
+#define TEST_LAYERS 16
+#define TEST_LAYOUT "nibbles"
+#else
+#define TEST_LAYERS 32
+#define TEST_LAYOUT "packed"
+#endif
+
+extern "C" {
+bool disable_action_cache = false;
+
+action_t action_for_key(uint8_t layer, keypos_t key) {
+    action_t action;
+    action.code = ACTION_TRANSPARENT;
+    return action;
+}
+
+void clear_keyboard_but_mods(void) {
+}
+}
+
+static keypos_t make_key(uint8_t row, uint8_t col) {
+    keypos_t key;
+    key.row = row;
+    key.col = col;
+    return key;
+}
+
+/* Every layout is checked against this plain array, so they all agree. */
+class SourceLayersCache : public testing::Test {
+public:
+    SourceLayersCache() {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                update(row, col, 0);
+            }
+        }
+    }
+
+    void update(uint8_t row, uint8_t col, uint8_t layer) {
+        update_source_layers_cache(make_key(row, col), layer);
+        expected[row][col] = layer;
+    }
+
+    void expect_cache_matches() {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                EXPECT_EQ(read_source_layers_cache(make_key(row, col)), expected[row][col])
+                    << "key " << (int)row << "," << (int)col;
+            }
+        }
+    }
+
+    uint8_t expected[MATRIX_ROWS][MATRIX_COLS];
+};
+
+TEST_F(SourceLayersCache, starts_on_layer_0) {
+    expect_cache_matches();
+}
+
+TEST_F(SourceLayersCache, stores_every_layer_on_every_key) {
+    for (uint8_t layer = 0; layer < TEST_LAYERS; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                update(row, col, layer);
+                EXPECT_EQ(read_source_layers_cache(make_key(row, col)), layer);
+            }
+        }
+        expect_cache_matches();
+    }
+}
+
+TEST_F(SourceLayersCache, keeps_neighbouring_keys) {
+    std::mt19937 rng(1357);
+    std::uniform_int_distribution<uint8_t> row(0, MATRIX_ROWS - 1);
+    std::uniform_int_distribution<uint8_t> col(0, MATRIX_COLS - 1);
+    std::uniform_int_distribution<uint8_t> layer(0, TEST_LAYERS - 1);
+    for (int i = 0; i < 5000; i++) {
+        update(row(rng), col(rng), layer(rng));
+    }
+    expect_cache_matches();
+}
+
+#if defined(SOURCE_LAYERS_CACHE_NIBBLES)
+TEST_F(SourceLayersCache, clamps_layers_above_15) {
+    update(0, 0, 3);
+    update(0, 1, 5);
+    update_source_layers_cache(make_key(0, 0), 17);
+    update_source_layers_cache(make_key(0, 1), 31);
+    expected[0][0] = 15;
+    expected[0][1] = 15;
+    expect_cache_matches();
+}
+
+#endif
+TEST_F(SourceLayersCache, benchmark_update_and_read) {
+    const int events = 200000;
+    uint32_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < events; i++) {
+        keypos_t key = make_key(i % MATRIX_ROWS, (i / MATRIX_ROWS) % MATRIX_COLS);
+        update_source_layers_cache(key, i % TEST_LAYERS);
+        sum += read_source_layers_cache(key);
+    }
+    auto time = std::chrono::steady_clock::now() - start;
+    printf("%s: %lld ns per update and read\n", TEST_LAYOUT,
+        (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / events);
+    EXPECT_GT(sum, 0u);
+}
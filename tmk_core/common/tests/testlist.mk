@@ -0,0 +1,7 @@
+TEST_LIST +=\
+	tmk_common_key_event_queue \
+	tmk_common_report \
+	tmk_common_action_layer \
+	tmk_common_source_layers_packed \
+	tmk_common_source_layers_nibbles \
+	tmk_common_source_layers_bytes
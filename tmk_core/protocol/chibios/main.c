@@ -88,6 +88,32 @@ host_driver_t chibios_driver = {
 
 
 
+#ifdef ASYNC_SCAN_ENABLE
+/* Matrix scanning thread
+ * Fills the key event queue that keyboard_task() drains, so scanning keeps
+ * its pace while the main thread waits on USB or runs slow user code.
+ */
+#ifndef ASYNC_SCAN_PERIOD_US
+#define ASYNC_SCAN_PERIOD_US 1000
+#endif
+/* Held by whoever scans the matrix, the main thread takes it while it
+ * scans for the remote wakeup */
+static MUTEX_DECL(scan_mutex);
+static THD_WORKING_AREA(waScanThread, 256);
+static THD_FUNCTION(scanThread, arg) {
+  (void)arg;
+  chRegSetThreadName("matrix_scan");
+  while(true) {
+    chMtxLock(&scan_mutex);
+    if(USB_DRIVER.state != USB_SUSPENDED) {
+      keyboard_scan_task();
+    }
+    chMtxUnlock(&scan_mutex);
+    chThdSleepMicroseconds(ASYNC_SCAN_PERIOD_US);
+  }
+}
+#endif
+
 /* Main thread
  */
 int main(void) {
@@ -144,6 +170,10 @@ int main(void) {
   keyboard_init();
   host_set_driver(driver);
 
+#ifdef ASYNC_SCAN_ENABLE
+  chThdCreateStatic(waScanThread, sizeof(waScanThread), NORMALPRIO + 1, scanThread, NULL);
+#endif
+
 #ifdef SLEEP_LED_ENABLE
   sleep_led_init();
 #endif
@@ -157,6 +187,9 @@ int main(void) {
       print("[s]");
 #ifdef VISUALIZER_ENABLE
       visualizer_suspend();
+#endif
+#ifdef ASYNC_SCAN_ENABLE
+      chMtxLock(&scan_mutex);
 #endif
       while(USB_DRIVER.state == USB_SUSPENDED) {
         /* Do this in the suspended state */
@@ -169,6 +202,9 @@ int main(void) {
           send_remote_wakeup(&USB_DRIVER);
         }
       }
+#ifdef ASYNC_SCAN_ENABLE
+      chMtxUnlock(&scan_mutex);
+#endif
       /* Woken up */
       // variables has been already cleared by the wakeup hook
       send_keyboard_report();
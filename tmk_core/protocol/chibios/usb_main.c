@@ -15,6 +15,7 @@
  * GPL v2 or later.
  */
 
+#include <string.h>
 #include "ch.h"
 #include "hal.h"
 
@@ -47,6 +48,17 @@ static virtual_timer_t keyboard_idle_timer;
 static void keyboard_idle_timer_cb(void *arg);
 
 report_keyboard_t keyboard_report_sent = {{0}};
+
+/* Snapshots of the reports passed to send_keyboard(), waiting to be sent.
+ * Only touched with the system locked. keyboard_report_sent is what the
+ * endpoint is reading and is only replaced while the endpoint is idle. */
+#if (KEYBOARD_REPORT_QUEUE_SIZE & (KEYBOARD_REPORT_QUEUE_SIZE - 1)) != 0 || KEYBOARD_REPORT_QUEUE_SIZE > 128
+#error "KEYBOARD_REPORT_QUEUE_SIZE must be a power of two, at most 128"
+#endif
+static report_keyboard_t keyboard_report_queue[KEYBOARD_REPORT_QUEUE_SIZE];
+static uint8_t keyboard_report_queue_head = 0;
+static uint8_t keyboard_report_queue_tail = 0;
+static keyboard_report_queue_stats_t keyboard_report_stats = {0};
 #ifdef MOUSE_ENABLE
 report_mouse_t mouse_report_blank = {0};
 #endif /* MOUSE_ENABLE */
@@ -771,6 +783,11 @@ static void usb_event_cb(USBDriver *usbp, usbevent_t event) {
   switch(event) {
   case USB_EVENT_RESET:
     //TODO: from ISR! print("[R]");
+    osalSysLockFromISR();
+    /* the host doesn't want old reports after a reset */
+    keyboard_report_queue_head = keyboard_report_queue_tail;
+    memset(&keyboard_report_sent, 0, sizeof(keyboard_report_sent));
+    osalSysUnlockFromISR();
     return;
 
   case USB_EVENT_ADDRESS:
@@ -1054,27 +1071,84 @@ void send_remote_wakeup(USBDriver *usbp) {
  * ---------------------------------------------------------
  */
 
+#define KEYBOARD_REPORT_QUEUE_MASK (KEYBOARD_REPORT_QUEUE_SIZE - 1)
+
+#ifdef NKRO_ENABLE
+#define KEYBOARD_REPORT_NKRO keymap_config.nkro
+#else
+#define KEYBOARD_REPORT_NKRO false
+#endif
+
+static inline uint8_t keyboard_report_queue_depth(void) {
+  return (uint8_t)(keyboard_report_queue_head - keyboard_report_queue_tail);
+}
+
+/* start sending the oldest queued report if the endpoint is free
+ * called with the system locked, from ISR or thread */
+static void keyboard_report_queue_drain_i(USBDriver *usbp) {
+  if(keyboard_report_queue_depth() == 0 || usbGetDriverStateI(usbp) != USB_ACTIVE) {
+    return;
+  }
+#ifdef NKRO_ENABLE
+  if(keymap_config.nkro) {
+    if(usbGetTransmitStatusI(usbp, NKRO_ENDPOINT)) {
+      return;
+    }
+    keyboard_report_sent = keyboard_report_queue[keyboard_report_queue_tail++ & KEYBOARD_REPORT_QUEUE_MASK];
+    usbStartTransmitI(usbp, NKRO_ENDPOINT, (uint8_t *)&keyboard_report_sent, sizeof(report_keyboard_t));
+  } else
+#endif /* NKRO_ENABLE */
+  {
+    if(usbGetTransmitStatusI(usbp, KBD_ENDPOINT)) {
+      return;
+    }
+    keyboard_report_sent = keyboard_report_queue[keyboard_report_queue_tail++ & KEYBOARD_REPORT_QUEUE_MASK];
+    usbStartTransmitI(usbp, KBD_ENDPOINT, (uint8_t *)&keyboard_report_sent, KBD_EPSIZE);
+  }
+}
+
 /* keyboard IN callback hander (a kbd report has made it IN) */
 void kbd_in_cb(USBDriver *usbp, usbep_t ep) {
-  /* STUB */
-  (void)usbp;
   (void)ep;
+  osalSysLockFromISR();
+  keyboard_report_queue_drain_i(usbp);
+  osalSysUnlockFromISR();
 }
 
 #ifdef NKRO_ENABLE
 /* nkro IN callback hander (a nkro report has made it IN) */
 void nkro_in_cb(USBDriver *usbp, usbep_t ep) {
-  /* STUB */
-  (void)usbp;
   (void)ep;
+  osalSysLockFromISR();
+  keyboard_report_queue_drain_i(usbp);
+  osalSysUnlockFromISR();
 }
 #endif /* NKRO_ENABLE */
 
 /* start-of-frame handler
- * TODO: i guess it would be better to re-implement using timers,
- *  so that this is not going to have to be checked every 1ms */
+ * sends what the IN callbacks could not, e.g. after an idle report */
 void kbd_sof_cb(USBDriver *usbp) {
-  (void)usbp;
+  osalSysLockFromISR();
+  keyboard_report_queue_drain_i(usbp);
+  osalSysUnlockFromISR();
+}
+
+keyboard_report_queue_stats_t keyboard_report_queue_stats(void) {
+  osalSysLock();
+  keyboard_report_queue_stats_t stats = keyboard_report_stats;
+  stats.depth = keyboard_report_queue_depth();
+  osalSysUnlock();
+  return stats;
+}
+
+void keyboard_report_queue_print_stats(void) {
+  keyboard_report_queue_stats_t stats = keyboard_report_queue_stats();
+  print("keyboard report queue: ");
+  print("depth "); print_dec(stats.depth);
+  print(" max "); print_dec(stats.max_depth);
+  print(" coalesced "); print_dec(stats.coalesced);
+  print(" dropped "); print_dec(stats.dropped);
+  print("\n");
 }
 
 /* Idle requests timer code
@@ -1114,7 +1188,8 @@ uint8_t keyboard_leds(void) {
   return (uint8_t)(keyboard_led_stats & 0xFF);
 }
 
-/* prepare and start sending a report IN
+/* queue a snapshot of the report and start sending it if the endpoint is free
+ * never waits for the endpoint
  * not callable from ISR or locked state */
 void send_keyboard(report_keyboard_t *report) {
   osalSysLock();
@@ -1122,42 +1197,36 @@ void send_keyboard(report_keyboard_t *report) {
     osalSysUnlock();
     return;
   }
-  osalSysUnlock();
 
-#ifdef NKRO_ENABLE
-  if(keymap_config.nkro) {  /* NKRO protocol */
-    /* need to wait until the previous packet has made it through */
-    /* can rewrite this using the synchronous API, then would wait
-     * until *after* the packet has been transmitted. I think
-     * this is more efficient */
-    /* busy wait, should be short and not very common */
-    osalSysLock();
-    if(usbGetTransmitStatusI(&USB_DRIVER, NKRO_ENDPOINT)) {
-      /* Need to either suspend, or loop and call unlock/lock during
-       * every iteration - otherwise the system will remain locked,
-       * no interrupts served, so USB not going through as well.
-       * Note: for suspend, need USB_USE_WAIT == TRUE in halconf.h */
-      osalThreadSuspendS(&(&USB_DRIVER)->epc[NKRO_ENDPOINT]->in_state->thread);
-    }
-    usbStartTransmitI(&USB_DRIVER, NKRO_ENDPOINT, (uint8_t *)report, sizeof(report_keyboard_t));
-    osalSysUnlock();
-  } else
-#endif /* NKRO_ENABLE */
-  { /* boot protocol */
-    /* need to wait until the previous packet has made it through */
-    /* busy wait, should be short and not very common */
-    osalSysLock();
-    if(usbGetTransmitStatusI(&USB_DRIVER, KBD_ENDPOINT)) {
-      /* Need to either suspend, or loop and call unlock/lock during
-       * every iteration - otherwise the system will remain locked,
-       * no interrupts served, so USB not going through as well.
-       * Note: for suspend, need USB_USE_WAIT == TRUE in halconf.h */
-      osalThreadSuspendS(&(&USB_DRIVER)->epc[KBD_ENDPOINT]->in_state->thread);
+  uint8_t depth = keyboard_report_queue_depth();
+  report_keyboard_t *last = depth ? &keyboard_report_queue[(keyboard_report_queue_head - 1) & KEYBOARD_REPORT_QUEUE_MASK] : &keyboard_report_sent;
+  if(memcmp(last, report, sizeof(report_keyboard_t)) == 0) {
+    /* nothing the host could see */
+    keyboard_report_stats.coalesced++;
+  } else if(depth) {
+    /* the last queued report can be replaced as long as the host still sees
+     * every press, in the order they happened */
+    report_keyboard_t *before = depth > 1 ? &keyboard_report_queue[(keyboard_report_queue_head - 2) & KEYBOARD_REPORT_QUEUE_MASK] : &keyboard_report_sent;
+    if(keyboard_report_can_merge(before, last, report, KEYBOARD_REPORT_NKRO)) {
+      *last = *report;
+      keyboard_report_stats.coalesced++;
+    } else if(depth == KEYBOARD_REPORT_QUEUE_SIZE) {
+      /* full, the transition in the last queued report is lost */
+      *last = *report;
+      keyboard_report_stats.dropped++;
+    } else {
+      keyboard_report_queue[keyboard_report_queue_head++ & KEYBOARD_REPORT_QUEUE_MASK] = *report;
     }
-    usbStartTransmitI(&USB_DRIVER, KBD_ENDPOINT, (uint8_t *)report, KBD_EPSIZE);
-    osalSysUnlock();
+  } else {
+    keyboard_report_queue[keyboard_report_queue_head++ & KEYBOARD_REPORT_QUEUE_MASK] = *report;
   }
-  keyboard_report_sent = *report;
+
+  depth = keyboard_report_queue_depth();
+  if(depth > keyboard_report_stats.max_depth) {
+    keyboard_report_stats.max_depth = depth;
+  }
+  keyboard_report_queue_drain_i(&USB_DRIVER);
+  osalSysUnlock();
 }
 
 /* ---------------------------------------------------------
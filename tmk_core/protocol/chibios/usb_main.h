@@ -60,6 +60,21 @@ void send_remote_wakeup(USBDriver *usbp);
 
 /* extern report_keyboard_t keyboard_report_sent; */
 
+/* Reports waiting for the IN endpoint, a power of two up to 128 */
+#ifndef KEYBOARD_REPORT_QUEUE_SIZE
+#define KEYBOARD_REPORT_QUEUE_SIZE 8
+#endif
+
+typedef struct {
+  uint8_t depth;
+  uint8_t max_depth;
+  uint16_t coalesced;
+  uint16_t dropped;
+} keyboard_report_queue_stats_t;
+
+keyboard_report_queue_stats_t keyboard_report_queue_stats(void);
+void keyboard_report_queue_print_stats(void);
+
 /* keyboard IN request callback handler */
 void kbd_in_cb(USBDriver *usbp, usbep_t ep);
 
@@ -107,6 +107,8 @@ static void send_keyboard(report_keyboard_t *report);
 static void send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
+static void report_queues_flush(void);
+static void report_queues_clear(void);
 host_driver_t lufa_driver = {
     keyboard_leds,
     send_keyboard,
@@ -354,6 +356,7 @@ void EVENT_USB_Device_Disconnect(void)
 void EVENT_USB_Device_Reset(void)
 {
     print("[R]");
+    report_queues_clear();
 }
 
 void EVENT_USB_Device_Suspend()
@@ -385,10 +388,14 @@ static bool console_flush = false;
     console_flush = b; \
   } \
 } while (0)
+#endif
 
 // called every 1ms
 void EVENT_USB_Device_StartOfFrame(void)
 {
+    report_queues_flush();
+
+#ifdef CONSOLE_ENABLE
     static uint8_t count;
     if (++count % 50) return;
     count = 0;
@@ -396,9 +403,8 @@ void EVENT_USB_Device_StartOfFrame(void)
     if (!console_flush) return;
     Console_Task();
     console_flush = false;
-}
-
 #endif
+}
 
 /** Event handler for the USB_ConfigurationChanged event.
  * This is fired when the host sets the current configuration of the USB device after enumeration.
@@ -623,6 +629,202 @@ static inline uint8_t where_to_send(void) {
     ;
 }
 
+/*******************************************************************************
+ * Pending reports
+ *
+ * Reports are queued per IN endpoint and written once the endpoint is free,
+ * from the send functions, the main loop and every start of frame, so the
+ * host driver never waits for the host to poll. All queue state is touched
+ * with interrupts off since the start of frame event runs in the USB ISR.
+ ******************************************************************************/
+#if (USB_REPORT_QUEUE_SIZE & (USB_REPORT_QUEUE_SIZE - 1)) || USB_REPORT_QUEUE_SIZE > 128
+#   error "USB_REPORT_QUEUE_SIZE must be a power of two no bigger than 128"
+#endif
+#define USB_REPORT_QUEUE_MASK (USB_REPORT_QUEUE_SIZE - 1)
+
+typedef struct {
+    uint8_t head;
+    uint8_t tail;
+    usb_report_queue_stats_t stats;
+} report_queue_t;
+
+static report_queue_t report_queues[USB_REPORT_QUEUE_COUNT];
+static report_keyboard_t keyboard_report_queue[USB_REPORT_QUEUE_SIZE];
+#ifdef MOUSE_ENABLE
+static report_mouse_t mouse_report_queue[USB_REPORT_QUEUE_SIZE];
+#endif
+#ifdef EXTRAKEY_ENABLE
+static report_extra_t extra_report_queue[USB_REPORT_QUEUE_SIZE];
+#endif
+
+static inline uint8_t report_queue_depth(report_queue_t *queue) {
+    return (uint8_t)(queue->head - queue->tail);
+}
+
+/* slot for a new report, or the last queued one when the queue is full */
+static uint8_t report_queue_push(report_queue_t *queue) {
+    uint8_t depth = report_queue_depth(queue);
+    if (depth == USB_REPORT_QUEUE_SIZE) {
+        queue->stats.lost++;
+        return (queue->head - 1) & USB_REPORT_QUEUE_MASK;
+    }
+    if (++depth > queue->stats.max_depth) {
+        queue->stats.max_depth = depth;
+    }
+    return queue->head++ & USB_REPORT_QUEUE_MASK;
+}
+
+static inline uint8_t report_queue_last(report_queue_t *queue) {
+    return (queue->head - 1) & USB_REPORT_QUEUE_MASK;
+}
+
+static bool write_report(uint8_t epnum, void *report, uint8_t size) {
+    Endpoint_SelectEndpoint(epnum);
+    if (!Endpoint_IsReadWriteAllowed()) return false;
+    Endpoint_Write_Stream_LE(report, size, NULL);
+    Endpoint_ClearIN();
+    return true;
+}
+
+/* write as many queued reports as the endpoints take, keeping their order */
+static void report_queues_flush(void) {
+    if (USB_DeviceState != DEVICE_STATE_Configured) return;
+
+    uint8_t ep = Endpoint_GetCurrentEndpoint();
+    report_queue_t *queue = &report_queues[USB_REPORT_QUEUE_KEYBOARD];
+    while (report_queue_depth(queue)) {
+        report_keyboard_t *report = &keyboard_report_queue[queue->tail & USB_REPORT_QUEUE_MASK];
+#ifdef NKRO_ENABLE
+        if (keyboard_protocol && keymap_config.nkro) {
+            if (!write_report(NKRO_IN_EPNUM, report, NKRO_EPSIZE)) break;
+        }
+        else
+#endif
+        {
+            if (!write_report(KEYBOARD_IN_EPNUM, report, KEYBOARD_EPSIZE)) break;
+        }
+        keyboard_report_sent = *report;
+        queue->tail++;
+    }
+#ifdef MOUSE_ENABLE
+    queue = &report_queues[USB_REPORT_QUEUE_MOUSE];
+    while (report_queue_depth(queue) &&
+           write_report(MOUSE_IN_EPNUM, &mouse_report_queue[queue->tail & USB_REPORT_QUEUE_MASK], sizeof(report_mouse_t))) {
+        queue->tail++;
+    }
+#endif
+#ifdef EXTRAKEY_ENABLE
+    queue = &report_queues[USB_REPORT_QUEUE_EXTRA];
+    while (report_queue_depth(queue) &&
+           write_report(EXTRAKEY_IN_EPNUM, &extra_report_queue[queue->tail & USB_REPORT_QUEUE_MASK], sizeof(report_extra_t))) {
+        queue->tail++;
+    }
+#endif
+    Endpoint_SelectEndpoint(ep);
+}
+
+static void report_queues_clear(void) {
+    for (uint8_t i = 0; i < USB_REPORT_QUEUE_COUNT; i++) {
+        report_queues[i].tail = report_queues[i].head;
+    }
+    memset(&keyboard_report_sent, 0, sizeof(keyboard_report_sent));
+}
+
+usb_report_queue_stats_t usb_report_queue_stats(uint8_t queue) {
+    usb_report_queue_stats_t stats;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        stats = report_queues[queue].stats;
+    }
+    return stats;
+}
+
+static void report_queue_print_stats(uint8_t queue) {
+    usb_report_queue_stats_t stats = usb_report_queue_stats(queue);
+    print(" report queue: ");
+    print("max "); print_dec(stats.max_depth);
+    print(" merged "); print_dec(stats.merged);
+    print(" lost "); print_dec(stats.lost);
+    print("\n");
+}
+
+void usb_report_queue_print_stats(void) {
+    print("keyboard"); report_queue_print_stats(USB_REPORT_QUEUE_KEYBOARD);
+#ifdef MOUSE_ENABLE
+    print("mouse"); report_queue_print_stats(USB_REPORT_QUEUE_MOUSE);
+#endif
+#ifdef EXTRAKEY_ENABLE
+    print("extra"); report_queue_print_stats(USB_REPORT_QUEUE_EXTRA);
+#endif
+}
+
+#ifdef NKRO_ENABLE
+#define KEYBOARD_REPORT_NKRO keymap_config.nkro
+#else
+#define KEYBOARD_REPORT_NKRO false
+#endif
+
+static void queue_keyboard_report(report_keyboard_t *report) {
+    report_queue_t *queue = &report_queues[USB_REPORT_QUEUE_KEYBOARD];
+    uint8_t depth = report_queue_depth(queue);
+    report_keyboard_t *last = depth ? &keyboard_report_queue[report_queue_last(queue)] : &keyboard_report_sent;
+
+    if (memcmp(last, report, sizeof(report_keyboard_t)) == 0) {
+        queue->stats.merged++;
+        return;
+    }
+    if (depth) {
+        /* the last queued report can be replaced as long as the host still
+         * sees every press, in the order they happened */
+        report_keyboard_t *before = depth > 1 ? &keyboard_report_queue[(queue->head - 2) & USB_REPORT_QUEUE_MASK] : &keyboard_report_sent;
+        if (keyboard_report_can_merge(before, last, report, KEYBOARD_REPORT_NKRO)) {
+            *last = *report;
+            queue->stats.merged++;
+            return;
+        }
+    }
+    keyboard_report_queue[report_queue_push(queue)] = *report;
+}
+
+#ifdef MOUSE_ENABLE
+static inline bool mouse_axis_fits(int8_t a, int8_t b) {
+    int16_t sum = (int16_t)a + b;
+    return sum >= -127 && sum <= 127;
+}
+
+static void queue_mouse_report(report_mouse_t *report) {
+    report_queue_t *queue = &report_queues[USB_REPORT_QUEUE_MOUSE];
+    if (report_queue_depth(queue)) {
+        /* movement with the same buttons held adds up into the last report */
+        report_mouse_t *last = &mouse_report_queue[report_queue_last(queue)];
+        if (last->buttons == report->buttons &&
+            mouse_axis_fits(last->x, report->x) && mouse_axis_fits(last->y, report->y) &&
+            mouse_axis_fits(last->v, report->v) && mouse_axis_fits(last->h, report->h)) {
+            last->x += report->x;
+            last->y += report->y;
+            last->v += report->v;
+            last->h += report->h;
+            queue->stats.merged++;
+            return;
+        }
+    }
+    mouse_report_queue[report_queue_push(queue)] = *report;
+}
+#endif
+
+#ifdef EXTRAKEY_ENABLE
+static void queue_extra_report(report_extra_t *report) {
+    report_queue_t *queue = &report_queues[USB_REPORT_QUEUE_EXTRA];
+    if (report_queue_depth(queue)) {
+        report_extra_t *last = &extra_report_queue[report_queue_last(queue)];
+        if (last->report_id == report->report_id && last->usage == report->usage) {
+            queue->stats.merged++;
+            return;
+        }
+    }
+    extra_report_queue[report_queue_push(queue)] = *report;
+}
+#endif
+
 static void send_keyboard(report_keyboard_t *report)
 {
 #ifdef BLUETOOTH_ENABLE
@@ -632,7 +834,6 @@ static void send_keyboard(report_keyboard_t *report)
     }
 #endif
 
-    uint8_t timeout = 255;
     uint8_t where = where_to_send();
 
 #ifdef ADAFRUIT_BLE_ENABLE
@@ -645,37 +846,10 @@ static void send_keyboard(report_keyboard_t *report)
       return;
     }
 
-    /* Select the Keyboard Report Endpoint */
-#ifdef NKRO_ENABLE
-    if (keyboard_protocol && keymap_config.nkro) {
-        /* Report protocol - NKRO */
-        Endpoint_SelectEndpoint(NKRO_IN_EPNUM);
-
-        /* Check if write ready for a polling interval around 1ms */
-        while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(4);
-        if (!Endpoint_IsReadWriteAllowed()) return;
-
-        /* Write Keyboard Report Data */
-        Endpoint_Write_Stream_LE(report, NKRO_EPSIZE, NULL);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        queue_keyboard_report(report);
+        report_queues_flush();
     }
-    else
-#endif
-    {
-        /* Boot protocol */
-        Endpoint_SelectEndpoint(KEYBOARD_IN_EPNUM);
-
-        /* Check if write ready for a polling interval around 10ms */
-        while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-        if (!Endpoint_IsReadWriteAllowed()) return;
-
-        /* Write Keyboard Report Data */
-        Endpoint_Write_Stream_LE(report, KEYBOARD_EPSIZE, NULL);
-    }
-
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
-
-    keyboard_report_sent = *report;
 }
 
 static void send_mouse(report_mouse_t *report)
@@ -694,8 +868,6 @@ static void send_mouse(report_mouse_t *report)
     bluefruit_serial_send(0x00);
 #endif
 
-    uint8_t timeout = 255;
-
     uint8_t where = where_to_send();
 
 #ifdef ADAFRUIT_BLE_ENABLE
@@ -708,25 +880,16 @@ static void send_mouse(report_mouse_t *report)
       return;
     }
 
-    /* Select the Mouse Report Endpoint */
-    Endpoint_SelectEndpoint(MOUSE_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
-
-    /* Write Mouse Report Data */
-    Endpoint_Write_Stream_LE(report, sizeof(report_mouse_t), NULL);
-
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        queue_mouse_report(report);
+        report_queues_flush();
+    }
 #endif
 }
 
 static void send_system(uint16_t data)
 {
-    uint8_t timeout = 255;
-
+#ifdef EXTRAKEY_ENABLE
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
@@ -734,14 +897,11 @@ static void send_system(uint16_t data)
         .report_id = REPORT_ID_SYSTEM,
         .usage = data - SYSTEM_POWER_DOWN + 1
     };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
-
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        queue_extra_report(&r);
+        report_queues_flush();
+    }
+#endif
 }
 
 static void send_consumer(uint16_t data)
@@ -763,7 +923,6 @@ static void send_consumer(uint16_t data)
     bluefruit_serial_send(0x00);
 #endif
 
-    uint8_t timeout = 255;
     uint8_t where = where_to_send();
 
 #ifdef ADAFRUIT_BLE_ENABLE
@@ -775,18 +934,16 @@ static void send_consumer(uint16_t data)
       return;
     }
 
+#ifdef EXTRAKEY_ENABLE
     report_extra_t r = {
         .report_id = REPORT_ID_CONSUMER,
         .usage = data
     };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
-
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        queue_extra_report(&r);
+        report_queues_flush();
+    }
+#endif
 }
 
 
@@ -1110,7 +1267,7 @@ static void setup_usb(void)
 
     USB_Init();
 
-    // for Console_Task
+    // for Console_Task and the pending report queues
     USB_Device_EnableSOFEvents();
     print_set_sendchar(sendchar);
 }
@@ -1187,14 +1344,24 @@ int main(void)
         while (USB_DeviceState == DEVICE_STATE_Suspended) {
             print("[s]");
             suspend_power_down();
+#ifdef ASYNC_SCAN_ENABLE
+            keyboard_scan_paused = true;
+#endif
             if (USB_Device_RemoteWakeupEnabled && suspend_wakeup_condition()) {
                     USB_Device_SendRemoteWakeup();
             }
         }
+#ifdef ASYNC_SCAN_ENABLE
+        keyboard_scan_paused = false;
+#endif
         #endif
 
         keyboard_task();
 
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            report_queues_flush();
+        }
+
 #ifdef MIDI_ENABLE
         midi_device_process(&midi_device);
         // MIDI_Task();
@@ -67,6 +67,27 @@ typedef struct {
     uint16_t usage;
 } __attribute__ ((packed)) report_extra_t;
 
+/* Reports waiting for their IN endpoint, one queue per endpoint */
+#ifndef USB_REPORT_QUEUE_SIZE
+#   define USB_REPORT_QUEUE_SIZE 4
+#endif
+
+enum usb_report_queue {
+    USB_REPORT_QUEUE_KEYBOARD,
+    USB_REPORT_QUEUE_MOUSE,
+    USB_REPORT_QUEUE_EXTRA,
+    USB_REPORT_QUEUE_COUNT
+};
+
+typedef struct {
+    uint8_t  max_depth;
+    uint16_t merged;    /* folded into a report that was still queued */
+    uint16_t lost;      /* overwritten because the queue was full */
+} usb_report_queue_stats_t;
+
+usb_report_queue_stats_t usb_report_queue_stats(uint8_t queue);
+void usb_report_queue_print_stats(void);
+
 #ifdef MIDI_ENABLE
   void MIDI_Task(void);
   MidiDevice midi_device;
@@ -64,10 +64,16 @@ int main(void)
     while (1) {
         while (suspend) {
             suspend_power_down();
+#ifdef ASYNC_SCAN_ENABLE
+            keyboard_scan_paused = true;
+#endif
             if (remote_wakeup && suspend_wakeup_condition()) {
                 usb_remote_wakeup();
             }
         }
+#ifdef ASYNC_SCAN_ENABLE
+        keyboard_scan_paused = false;
+#endif
 
         keyboard_task(); 
     }